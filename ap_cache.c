@@ -0,0 +1,631 @@
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/file.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include "ap_cache.h"
+
+
+/** \brief Reads a little endian uint32.
+ *
+ * \param data const unsigned char* The four bytes.
+ * \return uint32_t The number.
+ */
+static uint32_t ap_cache_read_uint32(const unsigned char * data)
+{
+    return data[0] | ((uint32_t) data[1] << 8) | ((uint32_t) data[2] << 16) | ((uint32_t) data[3] << 24);
+}
+
+
+/** \brief Writes a little endian uint32.
+ *
+ * \param data unsigned char* Receives the four bytes.
+ * \param number uint32_t The number.
+ * \return void
+ */
+static void ap_cache_write_uint32(unsigned char * data, uint32_t number)
+{
+    data[0] = (unsigned char) number;
+    data[1] = (unsigned char) (number >> 8);
+    data[2] = (unsigned char) (number >> 16);
+    data[3] = (unsigned char) (number >> 24);
+}
+
+
+/** \brief Returns the number of bytes of a number of a record, including its length.
+ *
+ * \param data const unsigned char* The number.
+ * \return size_t The number of bytes.
+ */
+static size_t ap_cache_number_length(const unsigned char * data)
+{
+    return 2 + (data[0] | ((size_t) data[1] << 8));
+}
+
+
+/** \brief Skips a number of a record, checking that it lies inside the record.
+ *
+ * \param data const unsigned char* The number.
+ * \param end const unsigned char* The end of the record.
+ * \return const unsigned char* The data following the number, NULL if it exceeds the record.
+ */
+static const unsigned char * ap_cache_skip_number(const unsigned char * data, const unsigned char * end)
+{
+    if ( end - data < 2 || (size_t) (end - data) < ap_cache_number_length(data) )
+    {
+        return NULL;
+    }
+
+    return data + ap_cache_number_length(data);
+}
+
+
+/** \brief Checks that the contents of a record fill exactly its length.
+ *
+ * \param data const unsigned char* The record following its length.
+ * \param length size_t The length of the record.
+ * \return int 1 if the record is well-formed, 0 otherwise.
+ */
+static int ap_cache_check(const unsigned char * data, size_t length)
+{
+    const unsigned char * end = data + length;
+    uint32_t count, i;
+
+    data = ap_cache_skip_number(data, end);
+    if ( data == NULL || end - data < 4 )
+    {
+        return 0;
+    }
+
+    count = ap_cache_read_uint32(data);
+    data += 4;
+    for ( i = 0; i < count; i++ )
+    {
+        data = ap_cache_skip_number(data, end);
+        if ( data == NULL || end - data < 4 )
+        {
+            return 0;
+        }
+        data += 4;
+    }
+
+    if ( end - data < 4 )
+    {
+        return 0;
+    }
+
+    count = ap_cache_read_uint32(data);
+    data += 4;
+    for ( i = 0; count != AP_CACHE_NO_APS && i < count; i++ )
+    {
+        data = ap_cache_skip_number(data, end);
+        if ( data == NULL )
+        {
+            return 0;
+        }
+    }
+
+    return data == end;
+}
+
+
+/** \brief Hashes a number of a record (FNV-1a).
+ *
+ * \param data const unsigned char* The number.
+ * \return uint64_t The hash.
+ */
+static uint64_t ap_cache_hash(const unsigned char * data)
+{
+    uint64_t hash = 14695981039346656037ULL;
+    size_t length = ap_cache_number_length(data);
+    size_t i;
+
+    for ( i = 0; i < length; i++ )
+    {
+        hash = (hash ^ data[i]) * 1099511628211ULL;
+    }
+
+    return hash;
+}
+
+
+/** \brief Looks up the slot of a key, either its record or the empty slot to take it.
+ *
+ * \param cache const ap_cache_t* The cache.
+ * \param key const unsigned char* The number n5 as stored in a record.
+ * \return size_t The slot.
+ */
+static size_t ap_cache_slot(const ap_cache_t * cache, const unsigned char * key)
+{
+    size_t mask = cache->slotsLength - 1;
+    size_t slot = (size_t) ap_cache_hash(key) & mask;
+    size_t length = ap_cache_number_length(key);
+
+    while ( cache->slots[slot] != 0 )
+    {
+        // The key of a record follows its length.
+        if ( memcmp(cache->map + cache->slots[slot] - 1 + 4, key, length) == 0 )
+        {
+            break;
+        }
+        slot = (slot + 1) & mask;
+    }
+
+    return slot;
+}
+
+
+/** \brief Indexes the records of the mapping.
+ *
+ * The records end with the first one cut short or malformed, everything
+ * behind it is ignored.
+ *
+ * \param cache ap_cache_t* The cache.
+ * \return size_t The offset behind the last record indexed.
+ */
+static size_t ap_cache_index(ap_cache_t * cache)
+{
+    size_t offset, length;
+    size_t count = 0;
+
+    for ( offset = AP_CACHE_HEADER_LENGTH; offset + 4 <= cache->mapLength; offset += 4 + length )
+    {
+        length = ap_cache_read_uint32(cache->map + offset);
+        if ( length > cache->mapLength - offset - 4 || ap_cache_check(cache->map + offset + 4, length) == 0 )
+        {
+            // A record cut short (by a crash) or damaged.
+            break;
+        }
+        count++;
+    }
+
+    cache->slotsLength = 16;
+    while ( cache->slotsLength < 2 * count )
+    {
+        cache->slotsLength *= 2;
+    }
+    cache->slots = calloc(cache->slotsLength, sizeof(uint64_t));
+    cache->records = count;
+
+    for ( offset = AP_CACHE_HEADER_LENGTH; count > 0; offset += 4 + length, count-- )
+    {
+        length = ap_cache_read_uint32(cache->map + offset);
+        cache->slots[ap_cache_slot(cache, cache->map + offset + 4)] = offset + 1;
+    }
+
+    return offset;
+}
+
+
+int ap_cache_open(ap_cache_t * cache, const char * path, int readOnly)
+{
+    unsigned char header[AP_CACHE_HEADER_LENGTH];
+    struct stat status;
+    size_t end;
+    void * map;
+    int fd;
+
+    cache->fd = -1;
+    cache->map = NULL;
+    cache->mapLength = 0;
+    cache->slots = NULL;
+    cache->slotsLength = 0;
+    cache->records = 0;
+
+    /// ///
+    /// The file is locked while it is read, so no record being appended by
+    /// another process is seen half written. It is locked exclusively while
+    /// it is written, see ap_cache_buffer_flush().
+    /// ///
+    fd = open(path, readOnly ? O_RDONLY : (O_RDWR | O_CREAT | O_APPEND), 0644);
+    if ( fd < 0 || flock(fd, readOnly ? LOCK_SH : LOCK_EX) != 0 || fstat(fd, &status) != 0 )
+    {
+        // ERROR: The cache could not be opened.
+        if ( fd >= 0 )
+        {
+            close(fd);
+        }
+        return 1;
+    }
+
+    if ( status.st_size == 0 && readOnly == 0 )
+    {
+        memset(header, 0, sizeof header);
+        memcpy(header, AP_CACHE_MAGIC, AP_CACHE_MAGIC_LENGTH);
+        ap_cache_write_uint32(header + AP_CACHE_MAGIC_LENGTH, AP_CACHE_VERSION);
+        if ( write(fd, header, sizeof header) != sizeof header )
+        {
+            close(fd);
+            return 1;
+        }
+    }
+    else if ( status.st_size > 0 )
+    {
+        // Only use and append to a cache of this version, never to any other file.
+        if ( pread(fd, header, sizeof header, 0) != sizeof header
+                || memcmp(header, AP_CACHE_MAGIC, AP_CACHE_MAGIC_LENGTH) != 0
+                || ap_cache_read_uint32(header + AP_CACHE_MAGIC_LENGTH) != AP_CACHE_VERSION )
+        {
+            close(fd);
+            return 2;
+        }
+
+        if ( status.st_size > AP_CACHE_HEADER_LENGTH )
+        {
+            map = mmap(NULL, (size_t) status.st_size, PROT_READ, MAP_SHARED, fd, 0);
+            if ( map == MAP_FAILED )
+            {
+                close(fd);
+                return 1;
+            }
+            cache->map = map;
+            cache->mapLength = (size_t) status.st_size;
+        }
+    }
+
+    end = ap_cache_index(cache);
+    if ( end < cache->mapLength && readOnly == 0 && ftruncate(fd, (off_t) end) != 0 )
+    {
+        // ERROR: New records must not follow a record cut short, they would be lost.
+        if ( cache->map != NULL )
+        {
+            munmap((void *) cache->map, cache->mapLength);
+        }
+        free(cache->slots);
+        close(fd);
+        return 1;
+    }
+    flock(fd, LOCK_UN);
+
+    if ( readOnly )
+    {
+        close(fd);
+    }
+    else
+    {
+        cache->fd = fd;
+    }
+    pthread_mutex_init(&cache->mutex, NULL);
+
+    return 0;
+}
+
+
+void ap_cache_close(ap_cache_t * cache)
+{
+    if ( cache->map != NULL )
+    {
+        munmap((void *) cache->map, cache->mapLength);
+    }
+    if ( cache->fd >= 0 )
+    {
+        close(cache->fd);
+    }
+    free(cache->slots);
+    pthread_mutex_destroy(&cache->mutex);
+}
+
+
+int ap_cache_find(const ap_cache_t * cache, mpz_t number, ap_cache_entry_t * entry)
+{
+    unsigned char key[2 + (mpz_sizeinbase(number, 2) + 7) / 8];
+    const unsigned char * data;
+    size_t length = 0;
+    size_t slot;
+    uint32_t i;
+
+    if ( cache->records == 0 || sizeof key > AP_CACHE_NUMBER_MAX + 2 )
+    {
+        return 0;
+    }
+
+    mpz_export(key + 2, &length, -1, 1, 0, 0, number);
+    key[0] = (unsigned char) length;
+    key[1] = (unsigned char) (length >> 8);
+
+    slot = ap_cache_slot(cache, key);
+    if ( cache->slots[slot] == 0 )
+    {
+        return 0;
+    }
+
+    data = cache->map + cache->slots[slot] - 1 + 4;
+    data += ap_cache_number_length(data);
+
+    // The record has been checked by ap_cache_index().
+    entry->primes = ap_cache_read_uint32(data);
+    entry->factors = data + 4;
+    data += 4;
+    for ( i = 0; i < entry->primes; i++ )
+    {
+        data += ap_cache_number_length(data) + 4;
+    }
+
+    entry->aps = ap_cache_read_uint32(data);
+    entry->distances = data + 4;
+
+    return 1;
+}
+
+
+const unsigned char * ap_cache_read_number(const unsigned char * data, mpz_t number)
+{
+    size_t length = ap_cache_number_length(data);
+
+    mpz_import(number, length - 2, -1, 1, 0, 0, data + 2);
+
+    return data + length;
+}
+
+
+const unsigned char * ap_cache_read_factor(const unsigned char * data, mpz_t prime, unsigned long * exponent)
+{
+    data = ap_cache_read_number(data, prime);
+    *exponent = ap_cache_read_uint32(data);
+
+    return data + 4;
+}
+
+
+const unsigned char * ap_cache_read_uint128(const unsigned char * data, uint128_t * number)
+{
+    size_t length = ap_cache_number_length(data);
+    size_t i;
+
+    if ( length > 2 + 16 )
+    {
+        return NULL;
+    }
+
+    *number = 0;
+    for ( i = length; i > 2; i-- )
+    {
+        *number = (*number << 8) | data[i - 1];
+    }
+
+    return data + length;
+}
+
+
+void ap_cache_buffer_init(ap_cache_buffer_t * buffer, ap_cache_t * cache)
+{
+    buffer->cache = cache != NULL && cache->fd >= 0 ? cache : NULL;
+    buffer->data = NULL;
+    buffer->length = 0;
+    buffer->capacity = 0;
+    buffer->start = 0;
+    buffer->dropped = 0;
+}
+
+
+void ap_cache_buffer_clear(ap_cache_buffer_t * buffer)
+{
+    ap_cache_buffer_flush(buffer);
+    free(buffer->data);
+    ap_cache_buffer_init(buffer, NULL);
+}
+
+
+/** \brief Makes sure that the given buffer can take that many more bytes.
+ *
+ * \param buffer ap_cache_buffer_t* The buffer.
+ * \param length size_t The number of bytes.
+ * \return void
+ */
+static void ap_cache_buffer_reserve(ap_cache_buffer_t * buffer, size_t length)
+{
+    if ( buffer->length + length <= buffer->capacity )
+    {
+        return;
+    }
+
+    while ( buffer->length + length > buffer->capacity )
+    {
+        buffer->capacity = buffer->capacity > 0 ? 2 * buffer->capacity : 2 * AP_CACHE_BUFFER_FLUSH;
+    }
+    buffer->data = realloc(buffer->data, buffer->capacity);
+}
+
+
+/** \brief Appends a number to the given buffer.
+ *
+ * \param buffer ap_cache_buffer_t* The buffer.
+ * \param number mpz_t The number, not negative.
+ * \return void
+ */
+static void ap_cache_buffer_add_number(ap_cache_buffer_t * buffer, mpz_t number)
+{
+    unsigned char * header;
+    size_t length = 0;
+
+    if ( (mpz_sizeinbase(number, 2) + 7) / 8 > AP_CACHE_NUMBER_MAX )
+    {
+        // The length would not fit, the record is dropped by ap_cache_buffer_end().
+        buffer->dropped = 1;
+        return;
+    }
+
+    ap_cache_buffer_reserve(buffer, 2 + (mpz_sizeinbase(number, 2) + 7) / 8);
+
+    header = buffer->data + buffer->length;
+    mpz_export(header + 2, &length, -1, 1, 0, 0, number);
+    header[0] = (unsigned char) length;
+    header[1] = (unsigned char) (length >> 8);
+
+    buffer->length += 2 + length;
+}
+
+
+/** \brief Appends a native number to the given buffer.
+ *
+ * \param buffer ap_cache_buffer_t* The buffer.
+ * \param number uint128_t The number.
+ * \return void
+ */
+static void ap_cache_buffer_add_uint128(ap_cache_buffer_t * buffer, uint128_t number)
+{
+    unsigned char * header;
+    size_t length = 0;
+
+    ap_cache_buffer_reserve(buffer, 2 + 16);
+
+    header = buffer->data + buffer->length;
+    while ( number > 0 )
+    {
+        header[2 + length++] = (unsigned char) number;
+        number >>= 8;
+    }
+    header[0] = (unsigned char) length;
+    header[1] = 0;
+
+    buffer->length += 2 + length;
+}
+
+
+void ap_cache_buffer_begin(ap_cache_buffer_t * buffer, mpz_t number, int primes)
+{
+    if ( buffer->cache == NULL )
+    {
+        return;
+    }
+
+    buffer->start = buffer->length;
+    buffer->dropped = 0;
+    ap_cache_buffer_reserve(buffer, 4);
+    buffer->length += 4;
+
+    ap_cache_buffer_add_number(buffer, number);
+
+    ap_cache_buffer_reserve(buffer, 4);
+    ap_cache_write_uint32(buffer->data + buffer->length, (uint32_t) primes);
+    buffer->length += 4;
+}
+
+
+void ap_cache_buffer_add_factor(ap_cache_buffer_t * buffer, mpz_t prime, unsigned long exponent)
+{
+    if ( buffer->cache == NULL )
+    {
+        return;
+    }
+
+    ap_cache_buffer_add_number(buffer, prime);
+    ap_cache_buffer_reserve(buffer, 4);
+    ap_cache_write_uint32(buffer->data + buffer->length, (uint32_t) exponent);
+    buffer->length += 4;
+}
+
+
+void ap_cache_buffer_add_factor_ui(ap_cache_buffer_t * buffer, uint64_t prime, unsigned long exponent)
+{
+    if ( buffer->cache == NULL )
+    {
+        return;
+    }
+
+    ap_cache_buffer_add_uint128(buffer, prime);
+    ap_cache_buffer_reserve(buffer, 4);
+    ap_cache_write_uint32(buffer->data + buffer->length, (uint32_t) exponent);
+    buffer->length += 4;
+}
+
+
+void ap_cache_buffer_add_aps(ap_cache_buffer_t * buffer, unsigned long aps)
+{
+    if ( buffer->cache == NULL )
+    {
+        return;
+    }
+
+    ap_cache_buffer_reserve(buffer, 4);
+    ap_cache_write_uint32(buffer->data + buffer->length, (uint32_t) aps);
+    buffer->length += 4;
+}
+
+
+void ap_cache_buffer_add_distance(ap_cache_buffer_t * buffer, mpz_t distance)
+{
+    if ( buffer->cache == NULL )
+    {
+        return;
+    }
+
+    ap_cache_buffer_add_number(buffer, distance);
+}
+
+
+void ap_cache_buffer_add_distance_uint128(ap_cache_buffer_t * buffer, uint128_t distance)
+{
+    if ( buffer->cache == NULL )
+    {
+        return;
+    }
+
+    ap_cache_buffer_add_uint128(buffer, distance);
+}
+
+
+void ap_cache_buffer_end(ap_cache_buffer_t * buffer)
+{
+    if ( buffer->cache == NULL )
+    {
+        return;
+    }
+
+    if ( buffer->dropped || buffer->length - buffer->start - 4 > UINT32_MAX )
+    {
+        // A record too big for its fields is not written at all.
+        buffer->length = buffer->start;
+        return;
+    }
+
+    ap_cache_write_uint32(buffer->data + buffer->start, (uint32_t) (buffer->length - buffer->start - 4));
+
+    if ( buffer->length >= AP_CACHE_BUFFER_FLUSH )
+    {
+        ap_cache_buffer_flush(buffer);
+    }
+}
+
+
+void ap_cache_buffer_flush(ap_cache_buffer_t * buffer)
+{
+    ap_cache_t * cache;
+    off_t size;
+
+    if ( buffer->length == 0 || buffer->cache == NULL )
+    {
+        buffer->length = 0;
+        return;
+    }
+
+    cache = buffer->cache;
+    pthread_mutex_lock(&cache->mutex);
+    if ( cache->fd >= 0 )
+    {
+        flock(cache->fd, LOCK_EX);
+        size = lseek(cache->fd, 0, SEEK_END);
+        if ( write(cache->fd, buffer->data, buffer->length) != (ssize_t) buffer->length )
+        {
+            // ERROR: The disk is full. Cut the records written in part, or the
+            // next record appended would be read as their rest.
+            fprintf(stderr, "Cannot append to the cache, it is not written any further.\n");
+            if ( size < 0 || ftruncate(cache->fd, size) != 0 )
+            {
+                fprintf(stderr, "Cannot cut the cache back, it will be cut when opened next.\n");
+            }
+            flock(cache->fd, LOCK_UN);
+            close(cache->fd);
+            cache->fd = -1;
+        }
+        else
+        {
+            flock(cache->fd, LOCK_UN);
+        }
+    }
+    pthread_mutex_unlock(&cache->mutex);
+
+    buffer->length = 0;
+}
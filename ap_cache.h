@@ -0,0 +1,271 @@
+#ifndef AP_CACHE_H_INCLUDED
+#define AP_CACHE_H_INCLUDED
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <pthread.h>
+#include <gmp.h>
+
+#include "uint128.h"
+
+
+/** \brief The first bytes of every cache file. */
+#define AP_CACHE_MAGIC "PMSoSAPC"
+
+/** \brief The length of AP_CACHE_MAGIC. */
+#define AP_CACHE_MAGIC_LENGTH 8
+
+/** \brief The version of the records, a cache of another version is refused. */
+#define AP_CACHE_VERSION 2
+
+/** \brief The length of the header, the magic followed by the uint32 version and a reserved uint32. */
+#define AP_CACHE_HEADER_LENGTH 16
+
+/** \brief The number of arithmetic progressions of a record holding the prime factors only. */
+#define AP_CACHE_NO_APS 0xffffffffUL
+
+/** \brief The most bytes of a number of a record, a record with a bigger number is not written. */
+#define AP_CACHE_NUMBER_MAX 65535
+
+/** \brief A buffer is appended to the cache as soon as it holds that many bytes. */
+#define AP_CACHE_BUFFER_FLUSH 65536
+
+
+/** \brief An append-only cache of the prime factors and arithmetic progressions of n5.
+ *
+ * A cache file starts with its header and holds one record per n5:
+ *
+ *     uint32 length     the number of bytes following
+ *     number n5
+ *     uint32 primes     the number of distinct prime factors
+ *     primes times
+ *         number prime
+ *         uint32 exponent
+ *     uint32 aps        the number of distances following, AP_CACHE_NO_APS if none
+ *     aps times
+ *         number d      the distances of the arithmetic progressions, ascending
+ *
+ * where a number is a uint16 n followed by n bytes, least significant first.
+ * All integers are little endian. The progression with the distance d is
+ * (n5^2 - d, n5^2, n5^2 + d).
+ *
+ * The records present when the cache is opened are mapped read-only and
+ * indexed by n5, a later record of the same n5 replaces an earlier one. The
+ * records of a run are appended only, so the mapping can be shared by many
+ * threads and by other processes reading the same cache. A record cut short
+ * (by a crash) or not filling exactly its length ends the records read, and
+ * it is cut off when the cache is opened for appending.
+ *
+ * Only the layout of a record is checked. The user of a record has to check
+ * its numbers, e.g. that the distances are ascending and below n5^2.
+ */
+typedef struct ap_cache
+{
+    /** \brief The file descriptor the records are appended to, -1 if read-only or after a failed write. */
+    int fd;
+    /** \brief The mapped records, NULL if there are none. */
+    const unsigned char * map;
+    /** \brief The number of bytes mapped. */
+    size_t mapLength;
+    /** \brief The hash table of the records, the offset of a record plus one, 0 for an empty slot. */
+    uint64_t * slots;
+    /** \brief The number of slots, a power of two. */
+    size_t slotsLength;
+    /** \brief The number of records indexed. */
+    size_t records;
+    /** \brief Protects the appending. */
+    pthread_mutex_t mutex;
+} ap_cache_t;
+
+
+/** \brief A record found in the cache, pointing into the mapping. */
+typedef struct ap_cache_entry
+{
+    /** \brief The number of distinct prime factors. */
+    uint32_t primes;
+    /** \brief The first prime factor. */
+    const unsigned char * factors;
+    /** \brief The number of distances, AP_CACHE_NO_APS if none. */
+    unsigned long aps;
+    /** \brief The first distance. */
+    const unsigned char * distances;
+} ap_cache_entry_t;
+
+
+/** \brief Collects the records of one thread, see result_buffer_t. */
+typedef struct ap_cache_buffer
+{
+    /** \brief The cache, NULL to drop the records. */
+    ap_cache_t * cache;
+    /** \brief The records. */
+    unsigned char * data;
+    /** \brief The number of bytes of the records. */
+    size_t length;
+    /** \brief The number of bytes allocated. */
+    size_t capacity;
+    /** \brief The offset of the record begun last. */
+    size_t start;
+    /** \brief Whether the record begun last has a number too big and is not written. */
+    int dropped;
+} ap_cache_buffer_t;
+
+
+/** \brief Opens the given cache and indexes its records, creates it if needed.
+ *
+ * A cache opened for appending is cut back behind its last record indexed.
+ *
+ * \param cache ap_cache_t* The cache.
+ * \param path const char* The path of the cache file.
+ * \param readOnly int 1 to use the records only, 0 to append new records as well.
+ * \return int 0 on success, 1 if the file could not be opened, 2 if it is no cache of AP_CACHE_VERSION.
+ */
+int ap_cache_open(ap_cache_t * cache, const char * path, int readOnly);
+
+
+/** \brief Closes the given cache.
+ *
+ * \param cache ap_cache_t* The cache.
+ * \return void
+ */
+void ap_cache_close(ap_cache_t * cache);
+
+
+/** \brief Looks up the record of a number n5.
+ *
+ * \param cache const ap_cache_t* The cache.
+ * \param number mpz_t The number n5, positive.
+ * \param entry ap_cache_entry_t* Receives the record.
+ * \return int 1 if the record has been found, 0 otherwise.
+ */
+int ap_cache_find(const ap_cache_t * cache, mpz_t number, ap_cache_entry_t * entry);
+
+
+/** \brief Reads a number of a record.
+ *
+ * \param data const unsigned char* The number.
+ * \param number mpz_t Receives the number.
+ * \return const unsigned char* The data following the number.
+ */
+const unsigned char * ap_cache_read_number(const unsigned char * data, mpz_t number);
+
+
+/** \brief Reads a prime factor of a record.
+ *
+ * \param data const unsigned char* The prime factor.
+ * \param prime mpz_t Receives the prime factor.
+ * \param exponent unsigned long* Receives its exponent.
+ * \return const unsigned char* The data following the prime factor.
+ */
+const unsigned char * ap_cache_read_factor(const unsigned char * data, mpz_t prime, unsigned long * exponent);
+
+
+/** \brief Reads a number of a record of at most 16 bytes.
+ *
+ * \param data const unsigned char* The number.
+ * \param number uint128_t* Receives the number.
+ * \return const unsigned char* The data following the number, NULL if the number has more than 16 bytes.
+ */
+const unsigned char * ap_cache_read_uint128(const unsigned char * data, uint128_t * number);
+
+
+/** \brief Initializes the given buffer.
+ *
+ * \param buffer ap_cache_buffer_t* The buffer.
+ * \param cache ap_cache_t* The cache, NULL or a read-only cache to drop the records.
+ * \return void
+ */
+void ap_cache_buffer_init(ap_cache_buffer_t * buffer, ap_cache_t * cache);
+
+
+/** \brief Flushes the given buffer and releases its memory.
+ *
+ * \param buffer ap_cache_buffer_t* The buffer.
+ * \return void
+ */
+void ap_cache_buffer_clear(ap_cache_buffer_t * buffer);
+
+
+/** \brief Begins a record, followed by its prime factors, its distances and ap_cache_buffer_end().
+ *
+ * A record holding a number of more than AP_CACHE_NUMBER_MAX bytes is
+ * dropped by ap_cache_buffer_end().
+ *
+ * \param buffer ap_cache_buffer_t* The buffer.
+ * \param number mpz_t The number n5.
+ * \param primes int The number of distinct prime factors.
+ * \return void
+ */
+void ap_cache_buffer_begin(ap_cache_buffer_t * buffer, mpz_t number, int primes);
+
+
+/** \brief Adds a prime factor to the record begun.
+ *
+ * \param buffer ap_cache_buffer_t* The buffer.
+ * \param prime mpz_t The prime factor.
+ * \param exponent unsigned long The exponent.
+ * \return void
+ */
+void ap_cache_buffer_add_factor(ap_cache_buffer_t * buffer, mpz_t prime, unsigned long exponent);
+
+
+/** \brief Adds a native prime factor to the record begun.
+ *
+ * \param buffer ap_cache_buffer_t* The buffer.
+ * \param prime uint64_t The prime factor.
+ * \param exponent unsigned long The exponent.
+ * \return void
+ */
+void ap_cache_buffer_add_factor_ui(ap_cache_buffer_t * buffer, uint64_t prime, unsigned long exponent);
+
+
+/** \brief Adds the number of distances of the record begun, after its prime factors.
+ *
+ * \param buffer ap_cache_buffer_t* The buffer.
+ * \param aps unsigned long The number of distances, AP_CACHE_NO_APS for none.
+ * \return void
+ */
+void ap_cache_buffer_add_aps(ap_cache_buffer_t * buffer, unsigned long aps);
+
+
+/** \brief Adds a distance to the record begun.
+ *
+ * \param buffer ap_cache_buffer_t* The buffer.
+ * \param distance mpz_t The distance.
+ * \return void
+ */
+void ap_cache_buffer_add_distance(ap_cache_buffer_t * buffer, mpz_t distance);
+
+
+/** \brief Adds a native distance to the record begun.
+ *
+ * \param buffer ap_cache_buffer_t* The buffer.
+ * \param distance uint128_t The distance.
+ * \return void
+ */
+void ap_cache_buffer_add_distance_uint128(ap_cache_buffer_t * buffer, uint128_t distance);
+
+
+/** \brief Ends the record begun.
+ *
+ * \param buffer ap_cache_buffer_t* The buffer.
+ * \return void
+ */
+void ap_cache_buffer_end(ap_cache_buffer_t * buffer);
+
+
+/** \brief Appends the records of the given buffer to the cache and empties the buffer.
+ *
+ * Every flush is one write() to the file opened with O_APPEND, under the
+ * mutex and an exclusive flock(), so the records of different threads and
+ * processes are never mixed. If the write fails (e.g. the disk is full), the
+ * records written in part are cut off again and the cache is not written any
+ * further.
+ *
+ * \param buffer ap_cache_buffer_t* The buffer.
+ * \return void
+ */
+void ap_cache_buffer_flush(ap_cache_buffer_t * buffer);
+
+
+#endif // AP_CACHE_H_INCLUDED
@@ -0,0 +1,634 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <gmp.h>
+
+#include "search.h"
+#include "result_log.h"
+#include "stats.h"
+
+
+/** \brief The corpora run without arguments. */
+#define BENCH_CORPORA {"benchmark/small.txt", "benchmark/dense.txt", "benchmark/composite.txt", "benchmark/primes.txt"}
+
+/** \brief The number of default corpora. */
+#define BENCH_CORPORA_LENGTH 4
+
+
+/** \brief A range of generators of a corpus, a single generator if from = to. */
+typedef struct bench_range
+{
+    /** \brief The first generator. */
+    mpz_t from;
+    /** \brief The last generator (inclusive). */
+    mpz_t to;
+    /** \brief Bit 1 to apply 6g + 1, bit 2 to apply 6g - 1. */
+    int signs;
+} bench_range_t;
+
+
+/** \brief A corpus of generators, read from a text file.
+ *
+ * Every line of the file is empty, a comment starting with "#", a generator
+ * string as read by the stdin mode (e.g. "141-"), a range "range G0 G1
+ * [+|-|both]" or an option "min-squares N" for the whole corpus.
+ */
+typedef struct bench_corpus
+{
+    /** \brief The ranges of generators. */
+    bench_range_t * ranges;
+    /** \brief The number of ranges. */
+    int length;
+    /** \brief The number of allocated ranges. */
+    int capacity;
+    /** \brief The options of the search. */
+    search_options_t options;
+} bench_corpus_t;
+
+
+/** \brief A sorted list of hits, one line "type squares generator sign a b" each. */
+typedef struct bench_hits
+{
+    /** \brief The lines. */
+    char ** lines;
+    /** \brief The number of lines. */
+    int length;
+    /** \brief The number of allocated lines. */
+    int capacity;
+} bench_hits_t;
+
+
+/** \brief Prints the command line usage to the stderr.
+ *
+ * \param program const char* The name of the program.
+ * \return void
+ */
+void bench_usage(const char * program)
+{
+    fprintf(stderr, "Usage: %s [--repeat N] [--update] [CORPUS ...]\n", program);
+    fprintf(stderr, "\n");
+    fprintf(stderr, "Runs the corpora (default: benchmark/*.txt) through the search and prints\n");
+    fprintf(stderr, "one tab separated line per corpus. The hits are compared with CORPUS.hits.\n");
+    fprintf(stderr, "\n");
+    fprintf(stderr, "  --repeat N   Run every corpus N times and report the fastest run (default 1).\n");
+    fprintf(stderr, "  --update     Write the hits found to CORPUS.hits instead of comparing them.\n");
+}
+
+
+/** \brief Appends a range to the corpus.
+ *
+ * \param corpus bench_corpus_t* The corpus.
+ * \return bench_range_t* The range appended, its numbers are initialized.
+ */
+bench_range_t * bench_corpus_append(bench_corpus_t * corpus)
+{
+    bench_range_t * range;
+
+    if ( corpus->length == corpus->capacity )
+    {
+        corpus->capacity = corpus->capacity > 0 ? 2 * corpus->capacity : 16;
+        corpus->ranges = realloc(corpus->ranges, corpus->capacity * sizeof(bench_range_t));
+    }
+
+    range = &corpus->ranges[corpus->length++];
+    mpz_init(range->from);
+    mpz_init(range->to);
+    range->signs = 3;
+
+    return range;
+}
+
+
+/** \brief Reads a corpus file.
+ *
+ * \param corpus bench_corpus_t* Receives the corpus.
+ * \param path const char* The path of the corpus file.
+ * \return int 0 on success, 1 if the file could not be read, 2 if a line is invalid.
+ */
+int bench_corpus_read(bench_corpus_t * corpus, const char * path)
+{
+    FILE * file;
+    bench_range_t * range;
+    char line[256], from[128], to[128], sign[8];
+    size_t length;
+    int fields;
+    int status = 0;
+
+    corpus->ranges = NULL;
+    corpus->length = 0;
+    corpus->capacity = 0;
+    search_options_init(&corpus->options);
+
+    file = fopen(path, "r");
+    if ( file == NULL )
+    {
+        return 1;
+    }
+
+    while ( status == 0 && fgets(line, sizeof line, file) != NULL )
+    {
+        length = strcspn(line, "\r\n#");
+        line[length] = '\0';
+        while ( length > 0 && line[length - 1] == ' ' )
+        {
+            line[--length] = '\0';
+        }
+        if ( length == 0 )
+        {
+            continue;
+        }
+
+        if ( sscanf(line, "min-squares %d", &corpus->options.minSquares) == 1 )
+        {
+            continue;
+        }
+
+        range = bench_corpus_append(corpus);
+        fields = sscanf(line, "range %127s %127s %7s", from, to, sign);
+        if ( fields >= 2 )
+        {
+            status = mpz_set_str(range->from, from, 10) != 0 || mpz_set_str(range->to, to, 10) != 0;
+            if ( fields == 3 )
+            {
+                range->signs = strcmp(sign, "+") == 0 ? 1 : strcmp(sign, "-") == 0 ? 2 : 3;
+            }
+        }
+        else
+        {
+            // A generator string, the sign defaults to '+' as in the stdin mode.
+            range->signs = 1;
+            if ( line[length - 1] == '+' || line[length - 1] == '-' )
+            {
+                range->signs = line[length - 1] == '+' ? 1 : 2;
+                line[--length] = '\0';
+            }
+            status = mpz_set_str(range->from, line, 10) != 0;
+            mpz_set(range->to, range->from);
+        }
+        if ( status != 0 )
+        {
+            fprintf(stderr, "%s: invalid line \"%s\".\n", path, line);
+            status = 2;
+        }
+    }
+
+    fclose(file);
+
+    return status;
+}
+
+
+/** \brief Clears the given corpus and releases all memory used by it.
+ *
+ * \param corpus bench_corpus_t* The corpus.
+ * \return void
+ */
+void bench_corpus_clear(bench_corpus_t * corpus)
+{
+    int i;
+
+    for ( i = 0; i < corpus->length; i++ )
+    {
+        mpz_clear(corpus->ranges[i].from);
+        mpz_clear(corpus->ranges[i].to);
+    }
+    free(corpus->ranges);
+}
+
+
+/** \brief Appends a line to the hits.
+ *
+ * \param hits bench_hits_t* The hits.
+ * \param line const char* The line, copied.
+ * \return void
+ */
+void bench_hits_add(bench_hits_t * hits, const char * line)
+{
+    if ( hits->length == hits->capacity )
+    {
+        hits->capacity = hits->capacity > 0 ? 2 * hits->capacity : 64;
+        hits->lines = realloc(hits->lines, hits->capacity * sizeof(char *));
+    }
+
+    hits->lines[hits->length++] = strdup(line);
+}
+
+
+/** \brief Compares two lines of hits for qsort().
+ *
+ * \param a const void* The first line.
+ * \param b const void* The second line.
+ * \return int A negative number, zero or a positive number.
+ */
+int bench_hits_compare(const void * a, const void * b)
+{
+    return strcmp(*(char * const *) a, *(char * const *) b);
+}
+
+
+/** \brief Clears the given hits and releases all memory used by them.
+ *
+ * \param hits bench_hits_t* The hits.
+ * \return void
+ */
+void bench_hits_clear(bench_hits_t * hits)
+{
+    int i;
+
+    for ( i = 0; i < hits->length; i++ )
+    {
+        free(hits->lines[i]);
+    }
+    free(hits->lines);
+    hits->lines = NULL;
+    hits->length = 0;
+    hits->capacity = 0;
+}
+
+
+/** \brief Reads the hits of a log, sorted.
+ *
+ * \param hits bench_hits_t* Receives the hits.
+ * \param path const char* The path of the log.
+ * \return int 0 on success, 1 if the log is broken.
+ */
+int bench_hits_from_log(bench_hits_t * hits, const char * path)
+{
+    FILE * file;
+    result_record_t record;
+    char * line;
+    int read;
+
+    file = fopen(path, "rb");
+    if ( file == NULL || result_log_read_magic(file) != 0 )
+    {
+        if ( file != NULL )
+        {
+            fclose(file);
+        }
+        return 1;
+    }
+
+    result_record_init(&record);
+    while ( (read = result_record_read(file, &record)) > 0 )
+    {
+        gmp_asprintf(&line, "%s %d %Zd %s %Zd %Zd", result_type_name(record.type), record.squares,
+                     record.generator, record.plusMinus > 0 ? "+" : "-", record.a, record.b);
+        bench_hits_add(hits, line);
+        free(line);
+    }
+    result_record_clear(&record);
+    fclose(file);
+
+    qsort(hits->lines, hits->length, sizeof(char *), bench_hits_compare);
+
+    return read < 0;
+}
+
+
+/** \brief Reads the expected hits of a corpus.
+ *
+ * \param hits bench_hits_t* Receives the hits.
+ * \param path const char* The path of the hits file.
+ * \return int 0 on success, 1 if the file could not be read.
+ */
+int bench_hits_read(bench_hits_t * hits, const char * path)
+{
+    FILE * file;
+    char line[512];
+
+    file = fopen(path, "r");
+    if ( file == NULL )
+    {
+        return 1;
+    }
+
+    while ( fgets(line, sizeof line, file) != NULL )
+    {
+        line[strcspn(line, "\r\n")] = '\0';
+        if ( line[0] != '\0' )
+        {
+            bench_hits_add(hits, line);
+        }
+    }
+    fclose(file);
+
+    qsort(hits->lines, hits->length, sizeof(char *), bench_hits_compare);
+
+    return 0;
+}
+
+
+/** \brief Writes the hits of a corpus.
+ *
+ * \param hits bench_hits_t* The hits.
+ * \param path const char* The path of the hits file.
+ * \return int 0 on success, 1 if the file could not be written.
+ */
+int bench_hits_write(bench_hits_t * hits, const char * path)
+{
+    FILE * file;
+    int i;
+
+    file = fopen(path, "w");
+    if ( file == NULL )
+    {
+        return 1;
+    }
+
+    for ( i = 0; i < hits->length; i++ )
+    {
+        fprintf(file, "%s\n", hits->lines[i]);
+    }
+
+    return fclose(file) != 0;
+}
+
+
+/** \brief Checks whether two sorted lists of hits are the same.
+ *
+ * \param hits bench_hits_t* The hits found.
+ * \param expected bench_hits_t* The hits expected.
+ * \return int 1 if they are the same, 0 otherwise.
+ */
+int bench_hits_equal(bench_hits_t * hits, bench_hits_t * expected)
+{
+    int i;
+
+    if ( hits->length != expected->length )
+    {
+        return 0;
+    }
+
+    for ( i = 0; i < hits->length; i++ )
+    {
+        if ( strcmp(hits->lines[i], expected->lines[i]) != 0 )
+        {
+            return 0;
+        }
+    }
+
+    return 1;
+}
+
+
+/** \brief Runs a corpus once through the search.
+ *
+ * \param corpus bench_corpus_t* The corpus.
+ * \param logPath const char* The path of the log receiving the hits, truncated first.
+ * \param stats search_stats_t* Receives the counters.
+ * \param report stats_report_t* Receives the clock of the run.
+ * \return int 0 on success, 1 if the log could not be written.
+ */
+int bench_run(bench_corpus_t * corpus, const char * logPath, search_stats_t * stats, stats_report_t * report)
+{
+    search_state_t state;
+    result_log_t log;
+    mpz_t generator;
+    int i, plusMinus;
+
+    if ( result_log_truncate(logPath, 0) != 0 || result_log_open(&log, logPath) != 0 )
+    {
+        return 1;
+    }
+    corpus->options.log = &log;
+
+    mpz_init(generator);
+    search_state_init(&state, &corpus->options);
+    stats_report_init(report, stderr, 0);
+
+    for ( i = 0; i < corpus->length; i++ )
+    {
+        for ( mpz_set(generator, corpus->ranges[i].from); mpz_cmp(generator, corpus->ranges[i].to) <= 0; mpz_add_ui(generator, generator, 1) )
+        {
+            for ( plusMinus = 1; plusMinus >= -1; plusMinus -= 2 )
+            {
+                if ( corpus->ranges[i].signs & (plusMinus > 0 ? 1 : 2) )
+                {
+                    search_generator(&state, generator, plusMinus);
+                }
+            }
+        }
+    }
+
+    search_state_flush(&state);
+    *stats = state.stats;
+
+    search_state_clear(&state);
+    mpz_clear(generator);
+    result_log_close(&log);
+    corpus->options.log = NULL;
+
+    return 0;
+}
+
+
+/** \brief Returns the name of a corpus, i.e. its file name without directory and extension.
+ *
+ * \param path const char* The path of the corpus file.
+ * \param name char* Receives the name.
+ * \param size size_t The size of \p name.
+ * \return void
+ */
+void bench_corpus_name(const char * path, char * name, size_t size)
+{
+    const char * slash = strrchr(path, '/');
+    char * dot;
+
+    snprintf(name, size, "%s", slash != NULL ? slash + 1 : path);
+    dot = strrchr(name, '.');
+    if ( dot != NULL )
+    {
+        *dot = '\0';
+    }
+}
+
+
+/** \brief The main function of the benchmark.
+ *
+ * Prints a header and one tab separated line per corpus to the stdout. The
+ * keys the search prints for its hits are discarded.
+ *
+ * Exit codes: 0 on success, 1 if the hits of a corpus have changed, 2 if a
+ * file could not be read or written, 3 on invalid arguments.
+ *
+ * \param argc int Number of command line arguments given.
+ * \param argv char** Array of command line arguments given.
+ * \return int
+ */
+int main(int argc, char **argv)
+{
+    const char * defaults[BENCH_CORPORA_LENGTH] = BENCH_CORPORA;
+    const char ** paths;
+    const char * status;
+    bench_corpus_t corpus;
+    bench_hits_t hits = {NULL, 0, 0};
+    bench_hits_t expected = {NULL, 0, 0};
+    search_stats_t stats, best;
+    stats_report_t report;
+    double seconds, bestSeconds, ticksPerSecond;
+    char logPath[] = "/tmp/pmsos_bench_XXXXXX";
+    char name[64];
+    char * hitsPath;
+    FILE * out;
+    int length = 0;
+    int repeat = 1;
+    int update = 0;
+    int failed = 0;
+    int i, run, fd;
+
+    paths = malloc((argc > BENCH_CORPORA_LENGTH ? argc : BENCH_CORPORA_LENGTH) * sizeof(char *));
+    for ( i = 1; i < argc; i++ )
+    {
+        if ( strcmp(argv[i], "--repeat") == 0 && i + 1 < argc )
+        {
+            repeat = atoi(argv[++i]);
+            if ( repeat < 1 )
+            {
+                bench_usage(argv[0]);
+                exit(3);
+            }
+        }
+        else if ( strcmp(argv[i], "--update") == 0 )
+        {
+            update = 1;
+        }
+        else if ( argv[i][0] != '-' )
+        {
+            paths[length++] = argv[i];
+        }
+        else
+        {
+            bench_usage(argv[0]);
+            exit(3);
+        }
+    }
+    if ( length == 0 )
+    {
+        for ( length = 0; length < BENCH_CORPORA_LENGTH; length++ )
+        {
+            paths[length] = defaults[length];
+        }
+    }
+
+    fd = mkstemp(logPath);
+    if ( fd < 0 )
+    {
+        fprintf(stderr, "Cannot create a temporary log.\n");
+        exit(2);
+    }
+    close(fd);
+
+    // The search prints the key of every hit to the stdout, the report goes to a copy of it.
+    out = fdopen(dup(fileno(stdout)), "w");
+    if ( out == NULL || freopen("/dev/null", "w", stdout) == NULL )
+    {
+        fprintf(stderr, "Cannot redirect the stdout.\n");
+        exit(2);
+    }
+
+    fprintf(out, "corpus\tgenerators\tseconds\tgenerators_per_s\taps\taps_per_s\tpairs\tpairs_per_s"
+            "\tparse_s\tfactor_s\taps_s\tsort_s\tpairs_s\tresults_s\tsquares\texact\thits\tstatus\n");
+
+    for ( i = 0; i < length; i++ )
+    {
+        bench_corpus_name(paths[i], name, sizeof name);
+        if ( bench_corpus_read(&corpus, paths[i]) != 0 )
+        {
+            fprintf(stderr, "Cannot read the corpus %s.\n", paths[i]);
+            failed |= 2;
+            bench_corpus_clear(&corpus);
+            continue;
+        }
+
+        bestSeconds = 0;
+        ticksPerSecond = 1e9;
+        search_stats_init(&best);
+        for ( run = 0; run < repeat; run++ )
+        {
+            if ( bench_run(&corpus, logPath, &stats, &report) != 0 )
+            {
+                fprintf(stderr, "Cannot write the temporary log %s.\n", logPath);
+                exit(2);
+            }
+            ticksPerSecond = stats_report_ticks_per_second(&report);
+            seconds = (double) (stats_ticks() - report.startTicks) / ticksPerSecond;
+            if ( run == 0 || seconds < bestSeconds )
+            {
+                bestSeconds = seconds;
+                best = stats;
+            }
+        }
+
+        // Compare the hits (of the last run) with the expected ones.
+        hitsPath = malloc(strlen(paths[i]) + 6);
+        strcpy(hitsPath, paths[i]);
+        if ( strrchr(hitsPath, '.') != NULL && strrchr(hitsPath, '.') > strrchr(hitsPath, '/') )
+        {
+            *strrchr(hitsPath, '.') = '\0';
+        }
+        strcat(hitsPath, ".hits");
+
+        if ( bench_hits_from_log(&hits, logPath) != 0 )
+        {
+            status = "broken";
+            failed |= 2;
+        }
+        else if ( update )
+        {
+            status = "updated";
+            if ( bench_hits_write(&hits, hitsPath) != 0 )
+            {
+                status = "unwritable";
+                failed |= 2;
+            }
+        }
+        else if ( bench_hits_read(&expected, hitsPath) != 0 )
+        {
+            status = "missing";
+            failed |= 2;
+        }
+        else if ( bench_hits_equal(&hits, &expected) )
+        {
+            status = "ok";
+        }
+        else
+        {
+            status = "changed";
+            failed |= 1;
+        }
+
+        fprintf(out, "%s\t%llu\t%.6f\t%.1f\t%llu\t%.1f\t%llu\t%.1f\t%.6f\t%.6f\t%.6f\t%.6f\t%.6f\t%.6f\t%llu\t%llu\t%d\t%s\n",
+                name,
+                (unsigned long long) best.generators,
+                bestSeconds,
+                best.generators / bestSeconds,
+                (unsigned long long) best.progressions,
+                best.progressions / bestSeconds,
+                (unsigned long long) best.pairs,
+                best.pairs / bestSeconds,
+                best.ticks[STATS_STAGE_PARSE] / ticksPerSecond,
+                best.ticks[STATS_STAGE_FACTOR] / ticksPerSecond,
+                best.ticks[STATS_STAGE_APS] / ticksPerSecond,
+                best.ticks[STATS_STAGE_SORT] / ticksPerSecond,
+                best.ticks[STATS_STAGE_PAIRS] / ticksPerSecond,
+                best.ticks[STATS_STAGE_RESULTS] / ticksPerSecond,
+                (unsigned long long) best.squareTests,
+                (unsigned long long) best.exactTests,
+                hits.length,
+                status);
+        fflush(out);
+
+        free(hitsPath);
+        bench_hits_clear(&hits);
+        bench_hits_clear(&expected);
+        bench_corpus_clear(&corpus);
+    }
+
+    remove(logPath);
+    fclose(out);
+    free(paths);
+
+    return (failed & 2) ? 2 : failed;
+}
@@ -0,0 +1,331 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "checkpoint.h"
+
+
+void checkpoint_init(checkpoint_t * checkpoint)
+{
+    mpz_init(checkpoint->from);
+    mpz_init(checkpoint->to);
+    checkpoint->signs = 3;
+    checkpoint->minAps = 0;
+    checkpoint->minSquares = 0;
+    checkpoint->classes = 0;
+    checkpoint->primitive = 0;
+    checkpoint->generators = 0;
+    checkpoint->results = 0;
+    search_stats_init(&checkpoint->stats);
+    checkpoint->logSize = 0;
+    checkpoint->logPath = NULL;
+    checkpoint->begins = NULL;
+    checkpoint->ends = NULL;
+    checkpoint->length = 0;
+}
+
+
+void checkpoint_clear(checkpoint_t * checkpoint)
+{
+    mpz_clear(checkpoint->from);
+    mpz_clear(checkpoint->to);
+    free(checkpoint->logPath);
+    checkpoint->logPath = NULL;
+    free(checkpoint->begins);
+    free(checkpoint->ends);
+    checkpoint->begins = NULL;
+    checkpoint->ends = NULL;
+    checkpoint->length = 0;
+}
+
+
+void checkpoint_resize(checkpoint_t * checkpoint, int length)
+{
+    checkpoint->begins = realloc(checkpoint->begins, (length > 0 ? length : 1) * sizeof(uint64_t));
+    checkpoint->ends = realloc(checkpoint->ends, (length > 0 ? length : 1) * sizeof(uint64_t));
+    checkpoint->length = length;
+}
+
+
+void checkpoint_set_options(checkpoint_t * checkpoint, const search_options_t * options)
+{
+    checkpoint->minAps = options->minAps;
+    checkpoint->minSquares = options->minSquares;
+    checkpoint->classes = options->classes;
+    checkpoint->primitive = options->primitive;
+}
+
+
+int checkpoint_has_options(checkpoint_t * checkpoint, const search_options_t * options)
+{
+    return checkpoint->minAps == options->minAps
+           && checkpoint->minSquares == options->minSquares
+           && checkpoint->classes == options->classes
+           && checkpoint->primitive == options->primitive;
+}
+
+
+/** \brief Lists the counters kept by a checkpoint, in the order they are written.
+ *
+ * \param stats search_stats_t* The counters.
+ * \param counters uint64_t** Receives CHECKPOINT_COUNTERS pointers to the counters.
+ * \return void
+ */
+static void checkpoint_counters(search_stats_t * stats, uint64_t ** counters)
+{
+    int i;
+
+    *counters++ = &stats->pruned;
+    *counters++ = &stats->imprimitive;
+    *counters++ = &stats->blocked;
+    *counters++ = &stats->progressions;
+    *counters++ = &stats->squareTests;
+    for ( i = 0; i < SQUARE_FILTER_STAGES; i++ )
+    {
+        *counters++ = &stats->squarePassed[i];
+    }
+    *counters++ = &stats->exactTests;
+    *counters++ = &stats->pairs;
+    *counters++ = &stats->prunedPairs;
+    *counters++ = &stats->imprimitivePairs;
+    *counters++ = &stats->cached;
+}
+
+
+int checkpoint_write(checkpoint_t * checkpoint, const char * path)
+{
+    uint64_t * counters[CHECKPOINT_COUNTERS];
+    FILE * file;
+    char * temporary;
+    int failed;
+    int i;
+
+    temporary = malloc(strlen(path) + 5);
+    sprintf(temporary, "%s.tmp", path);
+
+    file = fopen(temporary, "w");
+    if ( file == NULL )
+    {
+        free(temporary);
+        return 1;
+    }
+
+    fprintf(file, "%s\nfrom ", CHECKPOINT_MAGIC);
+    mpz_out_str(file, 10, checkpoint->from);
+    fprintf(file, "\nto ");
+    mpz_out_str(file, 10, checkpoint->to);
+    fprintf(file, "\nsigns %d\n", checkpoint->signs);
+    fprintf(file, "min-aps %llu\n", (unsigned long long) checkpoint->minAps);
+    fprintf(file, "min-squares %d\n", checkpoint->minSquares);
+    fprintf(file, "classes %d\n", checkpoint->classes);
+    fprintf(file, "primitive %d\n", checkpoint->primitive);
+    fprintf(file, "generators %llu\n", (unsigned long long) checkpoint->generators);
+    fprintf(file, "results %llu\n", (unsigned long long) checkpoint->results);
+    fprintf(file, "counters");
+    checkpoint_counters(&checkpoint->stats, counters);
+    for ( i = 0; i < CHECKPOINT_COUNTERS; i++ )
+    {
+        fprintf(file, " %llu", (unsigned long long) *counters[i]);
+    }
+    fprintf(file, "\n");
+    fprintf(file, "log %llu\n", (unsigned long long) checkpoint->logSize);
+    fprintf(file, "log-path%s%s\n",
+            checkpoint->logPath != NULL ? " " : "",
+            checkpoint->logPath != NULL ? checkpoint->logPath : "");
+    fprintf(file, "pending %d\n", checkpoint->length);
+    for ( i = 0; i < checkpoint->length; i++ )
+    {
+        fprintf(file, "%llu %llu\n",
+                (unsigned long long) checkpoint->begins[i],
+                (unsigned long long) checkpoint->ends[i]);
+    }
+
+    // The new checkpoint has to be on the disk before it replaces the old one.
+    failed = fflush(file) != 0 || fsync(fileno(file)) != 0;
+    failed |= fclose(file) != 0;
+    if ( failed || rename(temporary, path) != 0 )
+    {
+        remove(temporary);
+        free(temporary);
+        return 1;
+    }
+
+    free(temporary);
+
+    return 0;
+}
+
+
+/** \brief Reads an unsigned number following the given key.
+ *
+ * \param file FILE* The checkpoint file.
+ * \param key const char* The key, e.g. "results".
+ * \param value uint64_t* Receives the number.
+ * \return int 1 on success, 0 otherwise.
+ */
+static int checkpoint_read_value(FILE * file, const char * key, uint64_t * value)
+{
+    char word[16];
+    unsigned long long number;
+
+    if ( fscanf(file, " %15s %llu", word, &number) != 2 || strcmp(word, key) != 0 )
+    {
+        return 0;
+    }
+
+    *value = number;
+
+    return 1;
+}
+
+
+/** \brief Reads a big number following the given key.
+ *
+ * \param file FILE* The checkpoint file.
+ * \param key const char* The key, e.g. "from".
+ * \param value mpz_t Receives the number.
+ * \return int 1 on success, 0 otherwise.
+ */
+static int checkpoint_read_number(FILE * file, const char * key, mpz_t value)
+{
+    char word[16];
+
+    if ( fscanf(file, " %15s", word) != 1 || strcmp(word, key) != 0 )
+    {
+        return 0;
+    }
+
+    return mpz_inp_str(value, file, 10) > 0;
+}
+
+
+/** \brief Reads the path of the log following its key.
+ *
+ * The path is the rest of the line, it may contain spaces.
+ *
+ * \param file FILE* The checkpoint file.
+ * \param path char** Receives the path (to be freed), NULL if the line holds none.
+ * \return int 1 on success, 0 otherwise.
+ */
+static int checkpoint_read_path(FILE * file, char ** path)
+{
+    char word[16];
+    char * line = NULL;
+    size_t capacity = 0;
+    ssize_t length;
+
+    if ( fscanf(file, " %15s", word) != 1 || strcmp(word, "log-path") != 0 )
+    {
+        return 0;
+    }
+
+    length = getline(&line, &capacity, file);
+    if ( length < 1 || line[length - 1] != '\n' || (length > 1 && line[0] != ' ') )
+    {
+        free(line);
+        return 0;
+    }
+
+    line[length - 1] = '\0';
+    if ( length > 2 )
+    {
+        memmove(line, line + 1, length - 1);
+        *path = line;
+    }
+    else
+    {
+        free(line);
+    }
+
+    return 1;
+}
+
+
+/** \brief Reads the counters following their key.
+ *
+ * \param file FILE* The checkpoint file.
+ * \param stats search_stats_t* Receives the counters.
+ * \return int 1 on success, 0 otherwise.
+ */
+static int checkpoint_read_counters(FILE * file, search_stats_t * stats)
+{
+    uint64_t * counters[CHECKPOINT_COUNTERS];
+    char word[16];
+    unsigned long long number;
+    int i;
+
+    if ( fscanf(file, " %15s", word) != 1 || strcmp(word, "counters") != 0 )
+    {
+        return 0;
+    }
+
+    checkpoint_counters(stats, counters);
+    for ( i = 0; i < CHECKPOINT_COUNTERS; i++ )
+    {
+        if ( fscanf(file, " %llu", &number) != 1 )
+        {
+            return 0;
+        }
+        *counters[i] = number;
+    }
+
+    return 1;
+}
+
+
+int checkpoint_read(checkpoint_t * checkpoint, const char * path)
+{
+    FILE * file;
+    char magic[sizeof CHECKPOINT_MAGIC + 1];
+    unsigned long long begin, end;
+    uint64_t signs, length;
+    uint64_t minSquares, classes, primitive;
+    int ok;
+    int i;
+
+    file = fopen(path, "r");
+    if ( file == NULL )
+    {
+        return 1;
+    }
+
+    ok = fgets(magic, sizeof magic, file) != NULL
+         && strncmp(magic, CHECKPOINT_MAGIC "\n", sizeof magic) == 0
+         && checkpoint_read_number(file, "from", checkpoint->from)
+         && checkpoint_read_number(file, "to", checkpoint->to)
+         && checkpoint_read_value(file, "signs", &signs)
+         && checkpoint_read_value(file, "min-aps", &checkpoint->minAps)
+         && checkpoint_read_value(file, "min-squares", &minSquares)
+         && checkpoint_read_value(file, "classes", &classes)
+         && checkpoint_read_value(file, "primitive", &primitive)
+         && checkpoint_read_value(file, "generators", &checkpoint->generators)
+         && checkpoint_read_value(file, "results", &checkpoint->results)
+         && checkpoint_read_counters(file, &checkpoint->stats)
+         && checkpoint_read_value(file, "log", &checkpoint->logSize)
+         && checkpoint_read_path(file, &checkpoint->logPath)
+         && checkpoint_read_value(file, "pending", &length)
+         && signs >= 1 && signs <= 3
+         && length <= 1 << 20;
+
+    if ( ok )
+    {
+        checkpoint->signs = (int) signs;
+        checkpoint->minSquares = (int) minSquares;
+        checkpoint->classes = (int) classes;
+        checkpoint->primitive = (int) primitive;
+        checkpoint->stats.generators = checkpoint->generators;
+        checkpoint->stats.results = checkpoint->results;
+        checkpoint_resize(checkpoint, (int) length);
+        for ( i = 0; ok && i < checkpoint->length; i++ )
+        {
+            ok = fscanf(file, " %llu %llu", &begin, &end) == 2 && begin <= end;
+            checkpoint->begins[i] = begin;
+            checkpoint->ends[i] = end;
+        }
+    }
+
+    fclose(file);
+
+    return ok ? 0 : 1;
+}
@@ -0,0 +1,144 @@
+#ifndef CHECKPOINT_H_INCLUDED
+#define CHECKPOINT_H_INCLUDED
+
+#include <stdint.h>
+#include <gmp.h>
+
+#include "search.h"
+
+
+/** \brief The first line of every checkpoint file. */
+#define CHECKPOINT_MAGIC "PMSoS checkpoint 3"
+
+/** \brief The number of counters kept by a checkpoint. */
+#define CHECKPOINT_COUNTERS (10 + SQUARE_FILTER_STAGES)
+
+
+/** \brief The state of a range search between two chunks.
+ *
+ * The generator offsets not yet searched are kept as intervals [begin, end)
+ * relative to the first generator. Everything the log holds up to logSize
+ * belongs to the generators searched, so a resumed search truncates the log
+ * to that size and searches exactly the pending intervals again. The log is
+ * kept by its absolute path, a search is only resumed with the same log (or
+ * with none if the results are written to files).
+ *
+ * The options changing the results are kept as well, a search is only
+ * resumed with the same ones. So are the counters of the final summary, the
+ * ticks, histograms and maxima only count the current run.
+ *
+ * A checkpoint is written as a text file:
+ *
+ *     PMSoS checkpoint 3
+ *     from G0
+ *     to G1
+ *     signs S
+ *     min-aps N
+ *     min-squares N
+ *     classes C
+ *     primitive P
+ *     generators N
+ *     results R
+ *     counters N ...   (CHECKPOINT_COUNTERS numbers)
+ *     log L
+ *     log-path PATH    (nothing after log-path if there is no log)
+ *     pending K
+ *     begin end        (K lines)
+ */
+typedef struct checkpoint
+{
+    /** \brief The first generator of the range. */
+    mpz_t from;
+    /** \brief The last generator of the range (inclusive). */
+    mpz_t to;
+    /** \brief Bit 1 to apply 6g + 1, bit 2 to apply 6g - 1. */
+    int signs;
+    /** \brief The options changing the results, see search_options_t. */
+    uint64_t minAps;
+    int minSquares;
+    int classes;
+    int primitive;
+    /** \brief The number of generators searched. */
+    uint64_t generators;
+    /** \brief The number of results found. */
+    uint64_t results;
+    /** \brief The counters of the generators searched, without ticks, histograms and maxima. */
+    search_stats_t stats;
+    /** \brief The size of the log in bytes, 0 if there is no log. */
+    uint64_t logSize;
+    /** \brief The absolute path of the log, NULL if there is no log. */
+    char * logPath;
+    /** \brief The first generator offsets of the pending intervals. */
+    uint64_t * begins;
+    /** \brief The ends of the pending intervals (exclusive). */
+    uint64_t * ends;
+    /** \brief The number of pending intervals. */
+    int length;
+} checkpoint_t;
+
+
+/** \brief Initializes the given checkpoint.
+ *
+ * \param checkpoint checkpoint_t* The checkpoint.
+ * \return void
+ */
+void checkpoint_init(checkpoint_t * checkpoint);
+
+
+/** \brief Clears the given checkpoint and releases all memory used by it.
+ *
+ * \param checkpoint checkpoint_t* The checkpoint.
+ * \return void
+ */
+void checkpoint_clear(checkpoint_t * checkpoint);
+
+
+/** \brief Makes room for the given number of pending intervals.
+ *
+ * \param checkpoint checkpoint_t* The checkpoint.
+ * \param length int The number of pending intervals.
+ * \return void
+ */
+void checkpoint_resize(checkpoint_t * checkpoint, int length);
+
+
+/** \brief Takes the options changing the results.
+ *
+ * \param checkpoint checkpoint_t* The checkpoint.
+ * \param options const search_options_t* The options.
+ * \return void
+ */
+void checkpoint_set_options(checkpoint_t * checkpoint, const search_options_t * options);
+
+
+/** \brief Checks whether the given options change the results of the checkpoint.
+ *
+ * \param checkpoint checkpoint_t* The checkpoint.
+ * \param options const search_options_t* The options.
+ * \return int 1 if the options are the ones of the checkpoint, 0 otherwise.
+ */
+int checkpoint_has_options(checkpoint_t * checkpoint, const search_options_t * options);
+
+
+/** \brief Writes the given checkpoint.
+ *
+ * The checkpoint is written to "<path>.tmp" first and then renamed, so the
+ * file at path is always either the previous or the new checkpoint.
+ *
+ * \param checkpoint checkpoint_t* The checkpoint.
+ * \param path const char* The path of the checkpoint file.
+ * \return int 0 on success, 1 if the file could not be written.
+ */
+int checkpoint_write(checkpoint_t * checkpoint, const char * path);
+
+
+/** \brief Reads a checkpoint.
+ *
+ * \param checkpoint checkpoint_t* Receives the checkpoint.
+ * \param path const char* The path of the checkpoint file.
+ * \return int 0 on success, 1 if the file could not be read or is no checkpoint.
+ */
+int checkpoint_read(checkpoint_t * checkpoint, const char * path);
+
+
+#endif // CHECKPOINT_H_INCLUDED
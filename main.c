@@ -1,112 +1,183 @@
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
 #include <gmp.h>
 
-#include "mpz_factor_list.h"
-#include "mpz_ap_list.h"
+#include "search.h"
+#include "range.h"
+#include "checkpoint.h"
+#include "pipeline.h"
 
 
-/** \brief Calculate arithmetic progressions via Pythagorean triples.
+/** \brief Prints the command line usage to the stderr.
  *
- * To avoid the initialization of mpz_t variables within the function, you have
- * to pass initialized mpz_t variables via parameters that then can be used
- * by the function.
- *
- * Note that the middle value of any arithmetic progression found would be
- * (p1 * p2)^2.
- *
- * \param arithmeticProgressions mpz_ap_list_t** The list of arithmetic progressions.
- * \param p1 mpz_t The first factor.
- * \param p2 mpz_t The second factor.
- * \param m mpz_t An mpz_t variable that can be used by the function.
- * \param n mpz_t An mpz_t variable that can be used by the function.
- * \param mSquared mpz_t An mpz_t variable that can be used by the function.
- * \param nSquared mpz_t An mpz_t variable that can be used by the function.
- * \param x1 mpz_t An mpz_t variable that can be used by the function.
- * \param x2 mpz_t An mpz_t variable that can be used by the function.
- * \param x3 mpz_t An mpz_t variable that can be used by the function.
- * \param a1 mpz_t An mpz_t variable that can be used by the function.
- * \param a2 mpz_t An mpz_t variable that can be used by the function.
- * \param a3 mpz_t An mpz_t variable that can be used by the function.
+ * \param program const char* The name of the program.
  * \return void
  */
-void calc(mpz_ap_list_t ** arithmeticProgressions, mpz_t p1, mpz_t p2, mpz_t m, mpz_t n, mpz_t mSquared, mpz_t nSquared, mpz_t x1, mpz_t x2, mpz_t x3, mpz_t a1, mpz_t a2, mpz_t a3)
+void usage(const char * program)
 {
-    int cmp;
-
-    // m = floor(sqrt(p1))
-    mpz_sqrt(m, p1);
-
-    // n = 1
-    mpz_set_ui(n, 1);
+    fprintf(stderr, "Usage: %s [--from G0 --to G1 [--sign +|-|both] [--progress N]\n", program);
+    fprintf(stderr, "           [--threads N] [--chunk N] [--no-sieve]] [--min-aps N] [--block-aps N]\n");
+    fprintf(stderr, "           [--min-squares N] [--classes LIST] [--primitive]\n");
+    fprintf(stderr, "           [--pipeline [--queue N]] [--stats FILE] [--stats-interval S]\n");
+    fprintf(stderr, "           [--log FILE | --files] [--checkpoint FILE [--interval S] [--resume]]\n");
+    fprintf(stderr, "           [--cache FILE [--cache-readonly]]\n");
+    fprintf(stderr, "\n");
+    fprintf(stderr, "Without arguments the program reads generator strings (e.g. \"141-\") from\n");
+    fprintf(stderr, "the stdin and prints \"_\" after each one. The input \"q\" quits.\n");
+    fprintf(stderr, "With --pipeline the generators are searched concurrently and\n");
+    fprintf(stderr, "\"_ <generator>\" (e.g. \"_ 141-\") is printed after each one, in the\n");
+    fprintf(stderr, "order they complete.\n");
+    fprintf(stderr, "\n");
+    fprintf(stderr, "  --from G0      The first generator of the range.\n");
+    fprintf(stderr, "  --to G1        The last generator of the range (inclusive).\n");
+    fprintf(stderr, "  --sign S       The generator functions to apply: + (6g + 1), - (6g - 1)\n");
+    fprintf(stderr, "                 or both (default).\n");
+    fprintf(stderr, "  --progress N   Print the progress to the stderr every N generators\n");
+    fprintf(stderr, "                 (default 0, no progress).\n");
+    fprintf(stderr, "  --threads N    The number of worker threads (default: all processors).\n");
+    fprintf(stderr, "  --chunk N      The number of generators a worker takes at once\n");
+    fprintf(stderr, "                 (default 1024).\n");
+    fprintf(stderr, "  --no-sieve     Factor every generator on its own instead of sieving\n");
+    fprintf(stderr, "                 whole chunks.\n");
+    fprintf(stderr, "  --min-aps N    Skip generators with less than N arithmetic progressions\n");
+    fprintf(stderr, "                 (default 2).\n");
+    fprintf(stderr, "  --block-aps N  Search generators with more than N arithmetic progressions\n");
+    fprintf(stderr, "                 block by block, spilling the blocks to a temporary file\n");
+    fprintf(stderr, "                 (default 262144, 0 for no limit).\n");
+    fprintf(stderr, "  --min-squares N\n");
+    fprintf(stderr, "                 Write the magic squares with at least N perfect square\n");
+    fprintf(stderr, "                 numbers as \"ps\" results, 5 to 9 (default 7).\n");
+    fprintf(stderr, "  --classes LIST The comma separated classes of results to search:\n");
+    fprintf(stderr, "                 ps, fh, sh1 and sh2 (default all).\n");
+    fprintf(stderr, "  --primitive    Skip the magic squares that are scaled copies of the magic\n");
+    fprintf(stderr, "                 squares of a smaller generator.\n");
+    fprintf(stderr, "  --pipeline     Keep reading generator strings while the previous ones are\n");
+    fprintf(stderr, "                 searched by --threads workers.\n");
+    fprintf(stderr, "  --queue N      The number of generators read ahead by --pipeline\n");
+    fprintf(stderr, "                 (default 4 per thread).\n");
+    fprintf(stderr, "  --stats FILE   Append the counters and timers of every stage to this file\n");
+    fprintf(stderr, "                 (- for the stderr).\n");
+    fprintf(stderr, "  --stats-interval S\n");
+    fprintf(stderr, "                 Report the counters every S seconds, not only at the end\n");
+    fprintf(stderr, "                 (default 0, implies --stats - if not given).\n");
+    fprintf(stderr, "  --log FILE     Append the results to this log (default results.log).\n");
+    fprintf(stderr, "  --files        Write every result to its own file instead of the log.\n");
+    fprintf(stderr, "  --checkpoint FILE\n");
+    fprintf(stderr, "                 Write the progress of a range search to this file.\n");
+    fprintf(stderr, "  --interval S   Write the checkpoint every S seconds (default 300).\n");
+    fprintf(stderr, "  --resume       Continue the range search of the checkpoint, --from and\n");
+    fprintf(stderr, "                 --to are taken from the checkpoint. --min-aps, --min-squares,\n");
+    fprintf(stderr, "                 --classes and --primitive must be the same as before.\n");
+    fprintf(stderr, "  --cache FILE   Take the prime factors and arithmetic progressions from\n");
+    fprintf(stderr, "                 this cache and append the new ones to it.\n");
+    fprintf(stderr, "  --cache-readonly\n");
+    fprintf(stderr, "                 Take them from the cache but do not append to it.\n");
+}
 
-    // mSquared = m^2
-    mpz_mul(mSquared, m, m);
 
-    // nSquared = n^2
-    mpz_mul(nSquared, n, n);
+/** \brief Parses a comma separated list of result classes, e.g. "ps,sh1".
+ *
+ * \param list const char* The list.
+ * \return int The classes, SEARCH_CLASS_*, or -1 if the list holds an unknown class.
+ */
+int parse_classes(const char * list)
+{
+    int classes = 0;
+    int type;
+    size_t length;
 
-    while ( mpz_cmp(m, n) > 0 )
+    while ( *list != '\0' )
     {
-        // x3 = m^2 + n^2
-        mpz_add(x3, mSquared, nSquared);
-
-        cmp = mpz_cmp(x3, p1);
-        if ( cmp < 0 )// if ( x3 < p1 )
+        length = strcspn(list, ",");
+        for ( type = RESULT_TYPE_PS; type <= RESULT_TYPE_SH2; type++ )
         {
-            // n = n + 1
-            mpz_add_ui(n, n, 1);
-
-            // nSquared = n^2
-            mpz_mul(nSquared, n, n);
+            if ( strlen(result_type_name(type)) == length && strncmp(list, result_type_name(type), length) == 0 )
+            {
+                break;
+            }
         }
-        else if ( cmp > 0 )// if ( x3 > p1 )
+        if ( type > RESULT_TYPE_SH2 )
         {
-            // m = m - 1
-            mpz_sub_ui(m, m, 1);
-
-            // mSquared = m^2
-            mpz_mul(mSquared, m, m);
+            return -1;
         }
-        else// if ( x3 == p1 )
-        {
-            // x1 = m^2 - n^2
-            mpz_sub(x1, mSquared, nSquared);
+        classes |= 1 << type;
 
-            // x2 = 2 * m * n
-            mpz_mul(x2, m, n);
-            mpz_mul_ui(x2, x2, 2);
+        list += length;
+        if ( *list == ',' )
+        {
+            list++;
+        }
+    }
 
-            // Scale x1, x2 and x3 by p2.
-            mpz_mul(x1, x1, p2);
-            mpz_mul(x2, x2, p2);
-            mpz_mul(x3, x3, p2);
+    return classes;
+}
 
-            // a1 = (x2 - x1)^2
-            mpz_sub(a1, x2, x1);
-            mpz_mul(a1, a1, a1);
 
-            // a2 = x3^2
-            mpz_mul(a2, x3, x3);
+/** \brief Reads generator strings from the stdin and searches them one by one.
+ *
+ * After each generator a "_" would be printed to the stdout. The function
+ * returns as soon as the quit command "q" has been read.
+ *
+ * \param state search_state_t* The search state.
+ * \param report stats_report_t* The report of the counters, NULL for none.
+ * \return void
+ */
+void run_interactive(search_state_t * state, stats_report_t * report)
+{
+    uint64_t ticks;
+    mpz_t input;
+    int plusMinus = 1;
+    int kind;
+    char buf[BUFSIZ];
 
-            // a3 = (x1 + x2)^2
-            mpz_add(a3, x1, x2);
-            mpz_mul(a3, a3, a3);
+    mpz_init(input);
 
-            // Insert the arithmetic progression [a1, a2, a3] into the list.
-            mpz_ap_list_insert(arithmeticProgressions, a1, a2, a3);
+    while ( 1 )
+    {
+        // Read from the input.
+        if ( fgets(buf, sizeof buf, stdin) == NULL )
+        {
+            buf[0] = '\0';
+        }
+        ticks = stats_ticks();
 
-            // m = m - 1
-            mpz_sub_ui(m, m, 1);
+        kind = pipeline_parse(buf, input, &plusMinus);
+        if ( kind == PIPELINE_QUIT )
+        {
+            // Quit command read > so return.
+            if ( report != NULL )
+            {
+                stats_report_begin(report);
+                search_stats_print(report, "total", &state->stats);
+                fflush(report->stream);
+            }
+            mpz_clear(input);
+            return;
+        }
+        else if ( kind == PIPELINE_INVALID )
+        {
+            // ERROR: Given input was not a valid number.
+            exit(1);
+        }
+        else if ( kind == PIPELINE_TRUNCATED )
+        {
+            // ERROR: Input was truncated or pipe stream was closed.
+            exit(2);
+        }
+        state->stats.ticks[STATS_STAGE_PARSE] += stats_ticks() - ticks;
 
-            // mSquared = m^2
-            mpz_mul(mSquared, m, m);
+        search_generator(state, input, plusMinus);
+        search_state_flush(state);
 
-            // n = n + 1
-            mpz_add_ui(n, n, 1);
+        printf("_\n");
+        fflush(stdout);
 
-            // nSquared = n^2
-            mpz_mul(nSquared, n, n);
+        if ( report != NULL && stats_report_due(report) )
+        {
+            stats_report_begin(report);
+            search_stats_print(report, "total", &state->stats);
+            fflush(report->stream);
         }
     }
 }
@@ -120,587 +191,366 @@ void calc(mpz_ap_list_t ** arithmeticProgressions, mpz_t p1, mpz_t p2, mpz_t m,
  */
 int main(int argc, char **argv)
 {
-    mpz_t input, number, numberSquared, numberSqrt, f1, f2;
-    mpz_t m, n, mSquared, nSquared, x1, x2, x3, a1, a2, a3, a7, a8, a9;
-    mpz_t a, b, c, d, e;
-
-    mpz_init(input);
-    mpz_init(number);
-    mpz_init(numberSquared);
-    mpz_init(numberSqrt);
-    mpz_init(f1);
-    mpz_init(f2);
-
-    mpz_init(m);
-    mpz_init(n);
-    mpz_init(mSquared);
-    mpz_init(nSquared);
-    mpz_init(x1);
-    mpz_init(x2);
-    mpz_init(x3);
-    mpz_init(a1);
-    mpz_init(a2);
-    mpz_init(a3);
-    mpz_init(a7);
-    mpz_init(a8);
-    mpz_init(a9);
-
-    mpz_init(a);
-    mpz_init(b);
-    mpz_init(c);
-    mpz_init(d);
-    mpz_init(e);
-
-    mpz_factor_list_t * factorPairs = NULL;
-    mpz_ap_list_t * arithmeticProgressions = NULL;
-    mpz_ap_list_t * AP1;
-    mpz_ap_list_t * AP2;
-    mpz_ap_list_t * AP3;
-
-    int factorPairsLength = 0;
-    int plusMinus = 1;
-    int read;
-    int strlength = 0;
-    long result;
-    char buf[BUFSIZ];
-
-    while ( 1 )
+    search_state_t state;
+    range_options_t options;
+    checkpoint_t checkpoint;
+    stats_report_t report;
+    result_log_t log;
+    ap_cache_t cache;
+    const char * statsPath = NULL;
+    const char * logPath = "results.log";
+    char * logRealPath = NULL;
+    const char * cachePath = NULL;
+    int cacheReadOnly = 0;
+    int pipeline = 0;
+    int queue = 0;
+    int files = 0;
+    int resume = 0;
+    int status = 0;
+    int hasFrom = 0;
+    int hasTo = 0;
+    int i;
+
+    range_options_init(&options);
+
+    for ( i = 1; i < argc; i++ )
     {
-        // Read from the input.
-        read = 1;
-        while ( read == 1 )
+        if ( strcmp(argv[i], "--from") == 0 && i + 1 < argc )
         {
-            fgets(buf, sizeof buf, stdin);
-
-            // Measure the input string length.
-            strlength = 0;
-            while (buf[strlength] != '\0')
+            if ( 0 != mpz_set_str(options.from, argv[++i], 10) )
             {
-                strlength++;
+                usage(argv[0]);
+                exit(3);
             }
-
-            if (strlength > 0 && buf[strlength - 1] == '\n')
+            hasFrom = 1;
+        }
+        else if ( strcmp(argv[i], "--to") == 0 && i + 1 < argc )
+        {
+            if ( 0 != mpz_set_str(options.to, argv[++i], 10) )
+            {
+                usage(argv[0]);
+                exit(3);
+            }
+            hasTo = 1;
+        }
+        else if ( strcmp(argv[i], "--sign") == 0 && i + 1 < argc )
+        {
+            i++;
+            if ( strcmp(argv[i], "+") == 0 )
             {
-                if ( buf[0] == 'q' )
-                {
-                    // Quit command read > so exit.
-                    exit(0);
-                }
-                else
-                {
-                    if ( buf[strlength - 2] == '+' )
-                    {
-                        // The given command ends by a '+'.
-                        plusMinus = 1;
-                        buf[strlength - 2] = '\n';
-                    }
-                    else if ( buf[strlength - 2] == '-' )
-                    {
-                        // The given command ends by a '-'.
-                        plusMinus = -1;
-                        buf[strlength - 2] = '\n';
-                    }
-                    else
-                    {
-                        // The given command does not end by '+' nor by '-'.
-                        // In this case we default to '+'.
-                        plusMinus = 1;
-                    }
-
-                    if ( 0 == mpz_set_str(input, &buf[0], 10) )
-                    {
-                        read = 0;
-                    }
-                    else
-                    {
-                        // ERROR: Given input was not a valid number.
-                        exit(1);
-                    }
-                }
+                options.signs = 1;
+            }
+            else if ( strcmp(argv[i], "-") == 0 )
+            {
+                options.signs = 2;
+            }
+            else if ( strcmp(argv[i], "both") == 0 )
+            {
+                options.signs = 3;
             }
             else
             {
-                // ERROR: Input was truncated or pipe stream was closed.
-                exit(2);
+                usage(argv[0]);
+                exit(3);
             }
         }
-
-        // number = 6 * input + plusMinus
-        mpz_mul_ui(number, input, 6);
-        if ( plusMinus > 0 )
+        else if ( strcmp(argv[i], "--progress") == 0 && i + 1 < argc )
+        {
+            options.progress = strtoul(argv[++i], NULL, 10);
+        }
+        else if ( strcmp(argv[i], "--threads") == 0 && i + 1 < argc )
+        {
+            options.threads = atoi(argv[++i]);
+            if ( options.threads < 1 )
+            {
+                usage(argv[0]);
+                exit(3);
+            }
+        }
+        else if ( strcmp(argv[i], "--chunk") == 0 && i + 1 < argc )
+        {
+            options.chunk = strtoull(argv[++i], NULL, 10);
+        }
+        else if ( strcmp(argv[i], "--no-sieve") == 0 )
+        {
+            options.sieve = 0;
+        }
+        else if ( strcmp(argv[i], "--min-aps") == 0 && i + 1 < argc )
+        {
+            options.search.minAps = strtoul(argv[++i], NULL, 10);
+        }
+        else if ( strcmp(argv[i], "--block-aps") == 0 && i + 1 < argc )
+        {
+            options.search.blockAps = atoi(argv[++i]);
+            if ( options.search.blockAps < 0 )
+            {
+                usage(argv[0]);
+                exit(3);
+            }
+        }
+        else if ( strcmp(argv[i], "--min-squares") == 0 && i + 1 < argc )
+        {
+            options.search.minSquares = atoi(argv[++i]);
+            if ( options.search.minSquares < 5 || options.search.minSquares > 9 )
+            {
+                usage(argv[0]);
+                exit(3);
+            }
+        }
+        else if ( strcmp(argv[i], "--classes") == 0 && i + 1 < argc )
+        {
+            options.search.classes = parse_classes(argv[++i]);
+            if ( options.search.classes <= 0 )
+            {
+                usage(argv[0]);
+                exit(3);
+            }
+        }
+        else if ( strcmp(argv[i], "--primitive") == 0 )
         {
-            mpz_add_ui(number, number, 1);
+            options.search.primitive = 1;
+        }
+        else if ( strcmp(argv[i], "--pipeline") == 0 )
+        {
+            pipeline = 1;
+        }
+        else if ( strcmp(argv[i], "--queue") == 0 && i + 1 < argc )
+        {
+            queue = atoi(argv[++i]);
+            if ( queue < 1 )
+            {
+                usage(argv[0]);
+                exit(3);
+            }
+        }
+        else if ( strcmp(argv[i], "--stats") == 0 && i + 1 < argc )
+        {
+            statsPath = argv[++i];
+        }
+        else if ( strcmp(argv[i], "--stats-interval") == 0 && i + 1 < argc )
+        {
+            options.statsInterval = strtoul(argv[++i], NULL, 10);
+            if ( statsPath == NULL )
+            {
+                statsPath = "-";
+            }
+        }
+        else if ( strcmp(argv[i], "--log") == 0 && i + 1 < argc )
+        {
+            logPath = argv[++i];
+        }
+        else if ( strcmp(argv[i], "--files") == 0 )
+        {
+            files = 1;
+        }
+        else if ( strcmp(argv[i], "--checkpoint") == 0 && i + 1 < argc )
+        {
+            options.checkpoint = argv[++i];
+        }
+        else if ( strcmp(argv[i], "--interval") == 0 && i + 1 < argc )
+        {
+            options.checkpointInterval = strtoul(argv[++i], NULL, 10);
+        }
+        else if ( strcmp(argv[i], "--resume") == 0 )
+        {
+            resume = 1;
+        }
+        else if ( strcmp(argv[i], "--cache") == 0 && i + 1 < argc )
+        {
+            cachePath = argv[++i];
+        }
+        else if ( strcmp(argv[i], "--cache-readonly") == 0 )
+        {
+            cacheReadOnly = 1;
         }
         else
         {
-            mpz_sub_ui(number, number, 1);
+            usage(argv[0]);
+            exit(3);
         }
+    }
 
-        // numberSquared = number^2
-        mpz_mul(numberSquared, number, number);
+    if ( hasFrom != hasTo || (resume && (hasFrom || options.checkpoint == NULL)) || (pipeline && (hasFrom || resume))
+            || (cacheReadOnly && cachePath == NULL) )
+    {
+        // ERROR: A range needs both of its bounds, a resumed one takes them from the checkpoint.
+        // The pipeline reads its generators from the stdin. A read-only cache needs its file.
+        usage(argv[0]);
+        exit(3);
+    }
 
-#ifdef DEBUG
-        printf("Input: ");
-        mpz_out_str(stdout, 10, input);
-        printf(", %d\n", plusMinus);
-        printf("Number: ");
-        mpz_out_str(stdout, 10, number);
-        printf(", Number^2: ");
-        mpz_out_str(stdout, 10, numberSquared);
-        printf("\n");
-#endif
+    checkpoint_init(&checkpoint);
+    if ( resume )
+    {
+        if ( checkpoint_read(&checkpoint, options.checkpoint) != 0 )
+        {
+            // ERROR: The checkpoint could not be read.
+            fprintf(stderr, "Cannot read the checkpoint %s.\n", options.checkpoint);
+            exit(3);
+        }
 
+        if ( checkpoint_has_options(&checkpoint, &options.search) == 0 )
+        {
+            // ERROR: The results of the resumed search would not fit the ones logged before.
+            fprintf(stderr, "The checkpoint %s was written with other --min-aps, --min-squares, --classes\n", options.checkpoint);
+            fprintf(stderr, "or --primitive options.\n");
+            exit(3);
+        }
 
-        /// ///
-        /// Get a list of all possible factor pairs f1, f2 such that f1*f2 = number. Note that f1 and f2 may be equal, i.e. f1^2 = number.
-        /// The algorithm used here is very simple - actually some sort of brute force. We know that it would be better to
-        /// first find the prime factors and then to calculate all possible combinations of the found prime factors.
-        /// But the simple approach is still quite speedy :-).
-        /// ///
-        mpz_sqrt(numberSqrt, number);
-        mpz_set_ui(f1, 1);
-        while ( mpz_cmp(f1, numberSqrt) <= 0)
+        if ( files != (checkpoint.logPath == NULL) )
         {
-            if ( mpz_divisible_p(number, f1) != 0 )
-            {
-                mpz_div(f2, number, f1);
+            // ERROR: The results of the resumed search would not go where the ones before went.
+            fprintf(stderr, "The checkpoint %s was written %s --files.\n", options.checkpoint, files ? "without" : "with");
+            exit(3);
+        }
 
-                mpz_factor_list_push(&factorPairs, f1, f2);
-                factorPairsLength++;
+        if ( files == 0 )
+        {
+            logRealPath = realpath(logPath, NULL);
+            if ( logRealPath == NULL || strcmp(logRealPath, checkpoint.logPath) != 0 )
+            {
+                // ERROR: Cutting another log would drop results of other runs.
+                fprintf(stderr, "The checkpoint %s belongs to the log %s.\n", options.checkpoint, checkpoint.logPath);
+                exit(3);
             }
 
-            mpz_add_ui(f1, f1, 1);
+            // Drop the results written after the checkpoint, they are searched again.
+            status = result_log_truncate(logPath, checkpoint.logSize);
+            if ( status == 2 )
+            {
+                // ERROR: The log has lost results written before the checkpoint.
+                fprintf(stderr, "The log %s is shorter than at the checkpoint.\n", logPath);
+                exit(3);
+            }
+            else if ( status != 0 )
+            {
+                // ERROR: The log could not be cut.
+                fprintf(stderr, "Cannot cut the log %s back to the checkpoint.\n", logPath);
+                exit(3);
+            }
         }
-#ifdef DEBUG
-        printf("-- Factor Pairs --\n");
-        mpz_factor_list_print(factorPairs);
-#endif
 
+        mpz_set(options.from, checkpoint.from);
+        mpz_set(options.to, checkpoint.to);
+        options.signs = checkpoint.signs;
+        options.resume = &checkpoint;
+        hasFrom = 1;
+    }
 
-        /// ///
-        /// Iterate over all factor pairs and calculate the Arithmetic Progressions
-        /// via Pythagorean Triples.
-        /// ///
-        while ( factorPairsLength > 0 )
+    if ( statsPath != NULL )
+    {
+        options.stats = strcmp(statsPath, "-") == 0 ? stderr : fopen(statsPath, "a");
+        if ( options.stats == NULL )
         {
-            mpz_set(f1, factorPairs->factor1);
-            mpz_set(f2, factorPairs->factor2);
-            mpz_factor_list_pop(&factorPairs);
-            factorPairsLength --;
+            // ERROR: The stats file could not be opened.
+            fprintf(stderr, "Cannot open the stats file %s.\n", statsPath);
+            exit(3);
+        }
+    }
 
-            calc(&arithmeticProgressions, f1, f2, m, n, mSquared, nSquared, x1, x2, x3, a1, a2, a3);
-            if ( mpz_cmp(f1, f2) != 0 )
-            {
-                calc(&arithmeticProgressions, f2, f1, m, n, mSquared, nSquared, x1, x2, x3, a1, a2, a3);
-            }
+    if ( files == 0 )
+    {
+        if ( result_log_open(&log, logPath) != 0 )
+        {
+            // ERROR: The log could not be opened.
+            fprintf(stderr, "Cannot open the log %s.\n", logPath);
+            exit(3);
         }
-#ifdef DEBUG
-        printf("-- Arithmetic Progressions --\n");
-        mpz_ap_list_print(arithmeticProgressions);
-#endif
-
-
-        result = 0;
-
-        /// ///
-        /// Iterate through all combinations of arithmetic progressions AP1 and AP2
-        /// with the condition that the distance of AP1 (call it a) is smaller than
-        /// the distance of AP2 (call it b). Further we get the middle square number
-        /// of AP1 (which is the same as the middle square number of AP2) and call
-        /// it c.
-        ///
-        /// If b == 2a then we can continue with the next combination.
-        /// Otherwise we will calculate d = a + b and e = a - b.
-        /// If d >= c or e >= c we can continue with the next combination, as then
-        /// d - e or c - e would be negative.
-        /// ///
-#ifdef DEBUG
-        printf("-- Valid Combinations --\n");
-#endif
-        AP1 = arithmeticProgressions;
-        while (AP1 != NULL)
-        {
-            AP2 = AP1->next;
-            while ( AP2 != NULL )
+        options.search.log = &log;
+        if ( logRealPath == NULL && options.checkpoint != NULL )
+        {
+            logRealPath = realpath(logPath, NULL);
+            if ( logRealPath == NULL )
             {
-#ifdef DEBUG
-                printf("(");
-                mpz_out_str(stdout, 10, AP1->d);
-                printf(", ");
-                mpz_out_str(stdout, 10, AP2->d);
-                printf(")");
-#endif
-
-                // a = "arithmetic progression distance of AP1"
-                mpz_set(a, AP1->d);
-
-                // b = "arithmetic progression distance of AP2"
-                mpz_set(b, AP2->d);
-
-                // c = "middle square number of AP1"
-                mpz_set(c, AP1->y);
-
-
-                // a2 = 2 * a
-                mpz_mul_ui(a2, a, 2);
-                if ( mpz_cmp(b, a2) == 0 )
-                {
-#ifdef DEBUG
-                    printf(" Skip as b = 2 * a\n");
-#endif
-                    AP2 = AP2->next;
-                    continue;
-                }
-
-                // d = a + b
-                mpz_add(d, a, b);
-                if ( mpz_cmp(d, c) >= 0 )
-                {
-#ifdef DEBUG
-                    printf(" Skip as a + b >= c\n");
-#endif
-                    AP2 = AP2->next;
-                    continue;
-                }
-
-                // e = a - b
-                mpz_sub(e, a, b);
-
-
-                ///
-                /// Now we can actually calculate the nine numbers of the
-                /// magic square and then check whether or not they are perfect
-                /// square numbers.
-                ///
-
-                // s1 = c - b [x1]
-                mpz_set(x1, AP2->x);
-
-                // s2 = c + (a + b) [x2]
-                mpz_add(x2, AP1->y, d);
-
-                // s3 = c - a [x3]
-                mpz_set(x3, AP1->x);
-
-                // s4 = c - (a - b) [a1]
-                mpz_sub(a1, AP1->y, e);
-
-                // s5 = c [a2]
-                mpz_set(a2, AP1->y);
-
-                // s6 = c + (a - b) [a3]
-                mpz_add(a3, AP1->y, e);
-
-                // s7 = c + a [a7]
-                mpz_set(a7, AP1->z);
-
-                // s8 = c - (a + b) [a8]
-                mpz_sub(a8, AP1->y, d);
-
-                // s9 = c + b [a9]
-                mpz_set(a9, AP2->z);
-
-#ifdef DEBUG
-                printf("...\n");
-                mpz_out_str(stdout, 10, x1);
-                printf(" ");
-                mpz_out_str(stdout, 10, x2);
-                printf(" ");
-                mpz_out_str(stdout, 10, x3);
-                printf("\n");
-                mpz_out_str(stdout, 10, a1);
-                printf(" ");
-                mpz_out_str(stdout, 10, a2);
-                printf(" ");
-                mpz_out_str(stdout, 10, a3);
-                printf("\n");
-                mpz_out_str(stdout, 10, a7);
-                printf(" ");
-                mpz_out_str(stdout, 10, a8);
-                printf(" ");
-                mpz_out_str(stdout, 10, a9);
-                printf("\n");
-#endif
-
-                int s2PerfectSquare = 0;
-                if ( mpz_perfect_square_p(x2) != 0 )
-                {
-                    // This seems to be a perfect square.
-                    mpz_sqrt(m, x2);
-                    mpz_mul(m, m, m);
-                    if ( mpz_cmp(m, x2) == 0 )
-                    {
-                        s2PerfectSquare = 1;
-                    }
-                }
-
-                int s4PerfectSquare = 0;
-                if ( mpz_perfect_square_p(a1) != 0 )
-                {
-                    // This seems to be a perfect square.
-                    mpz_sqrt(m, a1);
-                    mpz_mul(m, m, m);
-                    if ( mpz_cmp(m, a1) == 0 )
-                    {
-                        s4PerfectSquare = 1;
-                    }
-                }
-
-                int s6PerfectSquare = 0;
-                if ( mpz_perfect_square_p(a3) != 0 )
-                {
-                    // This seems to be a perfect square.
-                    mpz_sqrt(m, a3);
-                    mpz_mul(m, m, m);
-                    if ( mpz_cmp(m, a3) == 0 )
-                    {
-                        s6PerfectSquare = 1;
-                    }
-                }
-
-                int s8PerfectSquare = 0;
-                if ( mpz_perfect_square_p(a8) != 0 )
-                {
-                    // This seems to be a perfect square.
-                    mpz_sqrt(m, a8);
-                    mpz_mul(m, m, m);
-                    if ( mpz_cmp(m, a8) == 0 )
-                    {
-                        s8PerfectSquare = 1;
-                    }
-                }
-
-                // s1, s3, s5, s7 and s9 are perfect square numbers (by construction).
-                // Therefore we would have at least 5 perfect square numbers.
-                // Calculate the total number of perfect square numbers in our
-                // magic square.
-                int nrPerfectSquares = 5
-                                       + s2PerfectSquare
-                                       + s4PerfectSquare
-                                       + s6PerfectSquare
-                                       + s8PerfectSquare;
-
-                if ( nrPerfectSquares > 6 )
-                {
-                    /// ///
-                    /// We have found a magic square of more than 6 perfect
-                    /// square numbers. So write that down to disk.
-                    /// We would also write the filename to the stdout.
-                    /// ///
-                    FILE *fp;
-                    char filename[100];
-                    char generator[80];
-
-                    result ++;
-                    mpz_get_str(generator, 10, input);
-
-                    sprintf(filename, "ps,%d,%s%s,%ld.result", nrPerfectSquares, generator, plusMinus > 0 ? "P" : "M", result);
-
-                    fp = fopen(filename, "w");
-                    mpz_out_str(fp, 10, number);
-                    fprintf(fp, "\n");
-                    mpz_out_str(fp, 10, numberSquared);
-                    fprintf(fp, "\n");
-                    fprintf(fp, "1 %d 1 | %d 1 %d | 1 %d 1\n", s2PerfectSquare, s4PerfectSquare, s6PerfectSquare, s8PerfectSquare);
-
-                    // The magic square
-                    mpz_out_str(fp, 10, x1);
-                    fprintf(fp, " ");
-                    mpz_out_str(fp, 10, x2);
-                    fprintf(fp, " ");
-                    mpz_out_str(fp, 10, x3);
-                    fprintf(fp, " | ");
-                    mpz_out_str(fp, 10, a1);
-                    fprintf(fp, " ");
-                    mpz_out_str(fp, 10, a2);
-                    fprintf(fp, " ");
-                    mpz_out_str(fp, 10, a3);
-                    fprintf(fp, " | ");
-                    mpz_out_str(fp, 10, a7);
-                    fprintf(fp, " ");
-                    mpz_out_str(fp, 10, a8);
-                    fprintf(fp, " ");
-                    mpz_out_str(fp, 10, a9);
-                    fprintf(fp, "\n");
-
-                    fclose(fp);
-
-                    printf("%s\n", filename);
-                }
-
-                /// ///
-                /// Check if d and e are distances in any other arithmetic progression.
-                /// ///
-                int dFound = 0;
-                int eFound = 0;
-                AP3 = arithmeticProgressions;
-                while (AP3 != NULL)
-                {
-                    if ( mpz_cmp(d, AP3->d) == 0 )
-                    {
-                        dFound = 1;
-                    }
-
-                    if ( mpz_cmp(e, AP3->d) == 0 )
-                    {
-                        eFound = 1;
-                    }
-
-                    AP3 = AP3->next;
-                }
-
-                if ( dFound > 0 && eFound > 0 )
-                {
-                    /// ///
-                    /// HEUREKA
-                    /// ///
-                    FILE *fp;
-                    char filename[100];
-                    char generator[80];
-
-                    result ++;
-                    mpz_get_str(generator, 10, input);
-
-                    sprintf(filename, "fh,%d,%s%s,%ld.result", nrPerfectSquares, generator, plusMinus > 0 ? "P" : "M", result);
-
-                    fp = fopen(filename, "w");
-                    mpz_out_str(fp, 10, number);
-                    fprintf(fp, "\n");
-                    mpz_out_str(fp, 10, numberSquared);
-                    fprintf(fp, "\n");
-                    fprintf(fp, "1 %d 1 | %d 1 %d | 1 %d 1\n", s2PerfectSquare, s4PerfectSquare, s6PerfectSquare, s8PerfectSquare);
-
-                    // The magic square
-                    mpz_out_str(fp, 10, x1);
-                    fprintf(fp, " ");
-                    mpz_out_str(fp, 10, x2);
-                    fprintf(fp, " ");
-                    mpz_out_str(fp, 10, x3);
-                    fprintf(fp, " | ");
-                    mpz_out_str(fp, 10, a1);
-                    fprintf(fp, " ");
-                    mpz_out_str(fp, 10, a2);
-                    fprintf(fp, " ");
-                    mpz_out_str(fp, 10, a3);
-                    fprintf(fp, " | ");
-                    mpz_out_str(fp, 10, a7);
-                    fprintf(fp, " ");
-                    mpz_out_str(fp, 10, a8);
-                    fprintf(fp, " ");
-                    mpz_out_str(fp, 10, a9);
-                    fprintf(fp, "\n");
-
-                    fclose(fp);
-
-                    printf("%s\n", filename);
-                }
-                else if ( dFound > 0 )
-                {
-                    /// ///
-                    /// SEMI-HEUREKA 1
-                    /// ///
-                    FILE *fp;
-                    char filename[100];
-                    char generator[80];
-
-                    result ++;
-                    mpz_get_str(generator, 10, input);
-
-                    sprintf(filename, "sh1,%d,%s%s,%ld.result", nrPerfectSquares, generator, plusMinus > 0 ? "P" : "M", result);
-
-                    fp = fopen(filename, "w");
-                    mpz_out_str(fp, 10, number);
-                    fprintf(fp, "\n");
-                    mpz_out_str(fp, 10, numberSquared);
-                    fprintf(fp, "\n");
-                    fprintf(fp, "1 %d 1 | %d 1 %d | 1 %d 1\n", s2PerfectSquare, s4PerfectSquare, s6PerfectSquare, s8PerfectSquare);
-
-                    // The magic square
-                    mpz_out_str(fp, 10, x1);
-                    fprintf(fp, " ");
-                    mpz_out_str(fp, 10, x2);
-                    fprintf(fp, " ");
-                    mpz_out_str(fp, 10, x3);
-                    fprintf(fp, " | ");
-                    mpz_out_str(fp, 10, a1);
-                    fprintf(fp, " ");
-                    mpz_out_str(fp, 10, a2);
-                    fprintf(fp, " ");
-                    mpz_out_str(fp, 10, a3);
-                    fprintf(fp, " | ");
-                    mpz_out_str(fp, 10, a7);
-                    fprintf(fp, " ");
-                    mpz_out_str(fp, 10, a8);
-                    fprintf(fp, " ");
-                    mpz_out_str(fp, 10, a9);
-                    fprintf(fp, "\n");
-
-                    fclose(fp);
-
-                    printf("%s\n", filename);
-                }
-                else if ( eFound > 0 )
-                {
-                    /// ///
-                    /// SEMI-HEUREKA 2
-                    /// ///
-                    FILE *fp;
-                    char filename[100];
-                    char generator[80];
-
-                    result ++;
-                    mpz_get_str(generator, 10, input);
-
-                    sprintf(filename, "sh2,%d,%s%s,%ld.result", nrPerfectSquares, generator, plusMinus > 0 ? "P" : "M", result);
-
-                    fp = fopen(filename, "w");
-                    mpz_out_str(fp, 10, number);
-                    fprintf(fp, "\n");
-                    mpz_out_str(fp, 10, numberSquared);
-                    fprintf(fp, "\n");
-                    fprintf(fp, "1 %d 1 | %d 1 %d | 1 %d 1\n", s2PerfectSquare, s4PerfectSquare, s6PerfectSquare, s8PerfectSquare);
-
-                    // The magic square
-                    mpz_out_str(fp, 10, x1);
-                    fprintf(fp, " ");
-                    mpz_out_str(fp, 10, x2);
-                    fprintf(fp, " ");
-                    mpz_out_str(fp, 10, x3);
-                    fprintf(fp, " | ");
-                    mpz_out_str(fp, 10, a1);
-                    fprintf(fp, " ");
-                    mpz_out_str(fp, 10, a2);
-                    fprintf(fp, " ");
-                    mpz_out_str(fp, 10, a3);
-                    fprintf(fp, " | ");
-                    mpz_out_str(fp, 10, a7);
-                    fprintf(fp, " ");
-                    mpz_out_str(fp, 10, a8);
-                    fprintf(fp, " ");
-                    mpz_out_str(fp, 10, a9);
-                    fprintf(fp, "\n");
-
-                    fclose(fp);
-
-                    printf("%s\n", filename);
-                }
-
-                AP2 = AP2->next;
+                // ERROR: The checkpoints could not name their log.
+                fprintf(stderr, "Cannot resolve the path of the log %s.\n", logPath);
+                exit(3);
             }
+        }
+        options.logPath = logRealPath;
+    }
 
-            AP1 = AP1->next;
+    if ( cachePath != NULL )
+    {
+        status = ap_cache_open(&cache, cachePath, cacheReadOnly);
+        if ( status == 1 )
+        {
+            // ERROR: The cache could not be opened.
+            fprintf(stderr, "Cannot open the cache %s.\n", cachePath);
+            exit(3);
+        }
+        else if ( status == 2 )
+        {
+            // ERROR: The file is no cache or one of another version.
+            fprintf(stderr, "The file %s is no cache of version %d.\n", cachePath, AP_CACHE_VERSION);
+            exit(3);
+        }
+        options.search.cache = &cache;
+    }
+
+    if ( hasFrom )
+    {
+        status = range_search(&options);
+        if ( status == 1 )
+        {
+            // ERROR: The range is too big.
+            fprintf(stderr, "The range must not contain more than 2^64 generators.\n");
+            exit(3);
+        }
+        else if ( status == 3 )
+        {
+            // ERROR: The checkpoint has been changed.
+            fprintf(stderr, "The checkpoint %s does not fit its range.\n", options.checkpoint);
+            exit(3);
         }
+        else if ( status == 2 )
+        {
+            fprintf(stderr, "Stopped, continue with --checkpoint %s --resume.\n", options.checkpoint);
+        }
+    }
+    else if ( pipeline )
+    {
+        if ( options.stats != NULL )
+        {
+            stats_report_init(&report, options.stats, options.statsInterval);
+        }
+        status = pipeline_run(&options.search, options.threads, queue > 0 ? queue : 4 * options.threads,
+                              stdin, options.stats != NULL ? &report : NULL);
+        if ( status != 0 )
+        {
+            // ERROR: The input was not a valid number (1) or has been truncated (2).
+            exit(status);
+        }
+    }
+    else
+    {
+        search_state_init(&state, &options.search);
+        if ( options.stats != NULL )
+        {
+            stats_report_init(&report, options.stats, options.statsInterval);
+        }
+        run_interactive(&state, options.stats != NULL ? &report : NULL);
+        search_state_clear(&state);
+    }
 
-        // Just in case: Clean the arithmetic progression list.
-        mpz_ap_list_clean(&arithmeticProgressions);
+    if ( options.stats != NULL && options.stats != stderr )
+    {
+        fclose(options.stats);
+    }
 
-        // Just in case: Clean the factor pairs list.
-        mpz_factor_list_clean(&factorPairs);
-        factorPairsLength = 0;
+    if ( files == 0 )
+    {
+        result_log_close(&log);
+    }
 
-        printf("_\n");
-        fflush(stdout);
+    if ( cachePath != NULL )
+    {
+        ap_cache_close(&cache);
     }
 
-    return 0;
+    checkpoint_clear(&checkpoint);
+    range_options_clear(&options);
+    free(logRealPath);
+
+    return status == 2 ? 4 : 0;
 }
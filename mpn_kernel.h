@@ -0,0 +1,96 @@
+#ifndef MPN_KERNEL_H_INCLUDED
+#define MPN_KERNEL_H_INCLUDED
+
+#include <gmp.h>
+
+#if GMP_NAIL_BITS != 0
+#error "The mpn kernels need limbs without nail bits."
+#endif
+
+
+/** \brief The limb counts of the centers searched with the mpn kernels.
+ *
+ * Below two limbs the native search is used, above eight limbs the plain
+ * mpz_t functions are used.
+ */
+#define MPN_KERNEL_MIN_LIMBS 2
+#define MPN_KERNEL_MAX_LIMBS 8
+
+
+/** \brief Adds two numbers of the same number of limbs.
+ *
+ * The kernels are meant to be called with a constant limb count, so that the
+ * carry chain is unrolled and no size, sign or allocation is checked as by
+ * mpz_add().
+ *
+ * \param r mp_limb_t* Receives the sum, limbs limbs.
+ * \param a const mp_limb_t* The first summand, limbs limbs.
+ * \param b const mp_limb_t* The second summand, limbs limbs.
+ * \param limbs int The number of limbs.
+ * \return mp_limb_t The carry, 0 or 1.
+ */
+static inline mp_limb_t mpn_kernel_add(mp_limb_t * r, const mp_limb_t * a, const mp_limb_t * b, int limbs)
+{
+    mp_limb_t carry = 0;
+    mp_limb_t sum;
+    int over;
+    int i;
+
+    for ( i = 0; i < limbs; i++ )
+    {
+        over = __builtin_add_overflow(a[i], b[i], &sum);
+        over |= __builtin_add_overflow(sum, carry, &r[i]);
+        carry = over;
+    }
+
+    return carry;
+}
+
+
+/** \brief Subtracts two numbers of the same number of limbs.
+ *
+ * \param r mp_limb_t* Receives the difference, limbs limbs.
+ * \param a const mp_limb_t* The minuend, limbs limbs.
+ * \param b const mp_limb_t* The subtrahend, limbs limbs.
+ * \param limbs int The number of limbs.
+ * \return mp_limb_t The borrow, 1 if b > a.
+ */
+static inline mp_limb_t mpn_kernel_sub(mp_limb_t * r, const mp_limb_t * a, const mp_limb_t * b, int limbs)
+{
+    mp_limb_t borrow = 0;
+    mp_limb_t difference;
+    int over;
+    int i;
+
+    for ( i = 0; i < limbs; i++ )
+    {
+        over = __builtin_sub_overflow(a[i], b[i], &difference);
+        over |= __builtin_sub_overflow(difference, borrow, &r[i]);
+        borrow = over;
+    }
+
+    return borrow;
+}
+
+
+/** \brief Checks whether a number is a perfect square number.
+ *
+ * The leading zero limbs are skipped, as mpn_perfect_square_p() needs the
+ * most significant limb to be non-zero.
+ *
+ * \param s const mp_limb_t* The number, limbs limbs.
+ * \param limbs int The number of limbs.
+ * \return int 1 if the number is a perfect square number, 0 otherwise.
+ */
+static inline int mpn_kernel_perfect_square_p(const mp_limb_t * s, int limbs)
+{
+    while ( limbs > 0 && s[limbs - 1] == 0 )
+    {
+        limbs--;
+    }
+
+    return limbs == 0 || mpn_perfect_square_p(s, limbs) != 0;
+}
+
+
+#endif // MPN_KERNEL_H_INCLUDED
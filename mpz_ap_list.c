@@ -1,153 +1,187 @@
 #include "mpz_ap_list.h"
 
 
-void mpz_ap_list_insert(mpz_ap_list_t ** list, mpz_t x, mpz_t y, mpz_t z)
+void mpz_ap_list_init(mpz_ap_list_t * list)
 {
-    // Calculate the distance d = y - x.
-    mpz_t d;
-    mpz_init(d);
-    mpz_sub(d, y, x);
+    list->items = NULL;
+    list->length = 0;
+    list->capacity = 0;
+}
+
+
+void mpz_ap_list_clear(mpz_ap_list_t * list)
+{
+    int i;
 
-    mpz_ap_list_t * current = * list;
-    if ( current == NULL || mpz_cmp(d, current->d) < 0 )
+    for ( i = 0; i < list->capacity; i++ )
     {
-        // Either this is the first element or the existing first element has
-        // a bigger distance. We have to insert the new element as first
-        // element.
-        mpz_ap_list_t * newNode;
-        newNode = malloc(sizeof(mpz_ap_list_t));
-
-        // Set the values.
-        mpz_init_set(newNode->x, x);
-        mpz_init_set(newNode->y, y);
-        mpz_init_set(newNode->z, z);
-        mpz_init_set(newNode->d, d);
-
-        // Insert the new node as first element into the list.
-        newNode->next = *list;
-        *list = newNode;
-
-        // Clear d and return.
-        mpz_clear(d);
-        return;
+        mpz_clear(list->items[i].x);
+        mpz_clear(list->items[i].y);
+        mpz_clear(list->items[i].z);
+        mpz_clear(list->items[i].d);
     }
 
-    // Iterate through the list and search for the element that has a bigger d.
-    // If found we will insert a new element before the found one. If not we
-    // will append a new element to the list.
-    while (current != NULL)
+    free(list->items);
+    mpz_ap_list_init(list);
+}
+
+
+void mpz_ap_list_reset(mpz_ap_list_t * list)
+{
+    list->length = 0;
+}
+
+
+void mpz_ap_list_append(mpz_ap_list_t * list, mpz_t x, mpz_t y, mpz_t z)
+{
+    mpz_ap_t * item;
+    int i;
+
+    if ( list->length == list->capacity )
     {
-        if ( mpz_cmp(x, current->x) == 0 )
+        list->capacity = list->capacity > 0 ? 2 * list->capacity : 64;
+        list->items = realloc(list->items, list->capacity * sizeof(mpz_ap_t));
+        for ( i = list->length; i < list->capacity; i++ )
         {
-            // If there is already an element with the same x, then we can
-            // assume that this arithmetic progression exists already. Therefore
-            // we would not change anything.
-            break;
+            mpz_init(list->items[i].x);
+            mpz_init(list->items[i].y);
+            mpz_init(list->items[i].z);
+            mpz_init(list->items[i].d);
         }
+    }
 
-        if ( current->next == NULL )
-        {
-            // We have reached the end of the list. Therefore we have to append
-            // this arithmetic progression to the end of the list.
-            mpz_ap_list_t * newNode;
-            newNode = malloc(sizeof(mpz_ap_list_t));
-
-            // Set the values.
-            mpz_init_set(newNode->x, x);
-            mpz_init_set(newNode->y, y);
-            mpz_init_set(newNode->z, z);
-            mpz_init_set(newNode->d, d);
-
-            // Append the new node as last element to the list.
-            newNode->next = NULL;
-            current->next = newNode;
-            break;
-        }
+    item = &list->items[list->length];
+    mpz_set(item->x, x);
+    mpz_set(item->y, y);
+    mpz_set(item->z, z);
 
-        if ( current->next != NULL )
-        {
-            if ( mpz_cmp(x, current->next->x) == 0 )
-            {
-                // If there is already an element with the same x, then we can
-                // assume that this arithmetic progression exists already.
-                // Therefore we would not change anything.
-                break;
-            }
-
-            if ( mpz_cmp(current->next->d, d) >= 0 )
-            {
-                // The next element in the list has a bigger distance. Therefore
-                // we will insert the new arithmetic progression right after
-                // the current one but before the next one.
-                mpz_ap_list_t * newNode;
-                newNode = malloc(sizeof(mpz_ap_list_t));
-
-                // Set the values.
-                mpz_init_set(newNode->x, x);
-                mpz_init_set(newNode->y, y);
-                mpz_init_set(newNode->z, z);
-                mpz_init_set(newNode->d, d);
-
-                // Insert the new node between the current and the next one in
-                // the list.
-                newNode->next = current->next;
-                current->next = newNode;
-                break;
-            }
-        }
+    // Calculate the distance d = y - x.
+    mpz_sub(item->d, y, x);
+    item->residue = mpz_fdiv_ui(item->d, SQUARE_FILTER_MODULUS);
+    item->content = 0;
+
+    list->length++;
+}
 
-        current = current->next;
-    }
 
-    // Clear d.
-    mpz_clear(d);
+/** \brief Compares two arithmetic progressions by their distance.
+ *
+ * \param a const void* The first arithmetic progression.
+ * \param b const void* The second arithmetic progression.
+ * \return int A negative number, zero or a positive number.
+ */
+static int mpz_ap_list_compare(const void * a, const void * b)
+{
+    return mpz_cmp(((const mpz_ap_t *) a)->d, ((const mpz_ap_t *) b)->d);
 }
 
 
-void mpz_ap_list_pop(mpz_ap_list_t ** list)
+void mpz_ap_list_sort(mpz_ap_list_t * list)
 {
-    if (*list == NULL)
+    mpz_ap_t spare;
+    int i, length;
+
+    if ( list->length < 2 )
     {
         return;
     }
 
-    mpz_clear((*list)->x);
-    mpz_clear((*list)->y);
-    mpz_clear((*list)->z);
-    mpz_clear((*list)->d);
+    // The mpz_t variables are moved as a whole, their limbs stay in place.
+    qsort(list->items, list->length, sizeof(mpz_ap_t), mpz_ap_list_compare);
 
-    mpz_ap_list_t * nextNode = NULL;
-    nextNode = (*list)->next;
+    // Remove the duplicates. The removed items are swapped behind the end of
+    // the list, so that all items stay initialized.
+    length = 1;
+    for ( i = 1; i < list->length; i++ )
+    {
+        if ( mpz_cmp(list->items[i].d, list->items[length - 1].d) == 0 )
+        {
+            continue;
+        }
 
-    free(*list);
-    *list = nextNode;
+        if ( i != length )
+        {
+            spare = list->items[length];
+            list->items[length] = list->items[i];
+            list->items[i] = spare;
+        }
+        length++;
+    }
+    list->length = length;
+}
+
+
+int mpz_ap_list_lower_bound(mpz_ap_list_t * list, mpz_t d)
+{
+    int low = 0;
+    int high = list->length;
+    int middle;
+
+    while ( low < high )
+    {
+        middle = low + (high - low) / 2;
+        if ( mpz_cmp(list->items[middle].d, d) < 0 )
+        {
+            low = middle + 1;
+        }
+        else
+        {
+            high = middle;
+        }
+    }
+
+    return low;
 }
 
 
-void mpz_ap_list_clean(mpz_ap_list_t ** list)
+int mpz_ap_list_find(mpz_ap_list_t * list, mpz_t d)
 {
-    while ( *list != NULL )
+    int low = 0;
+    int high = list->length - 1;
+    int middle, cmp;
+
+    if ( mpz_sgn(d) <= 0 )
     {
-        mpz_ap_list_pop(list);
+        // All distances are positive.
+        return -1;
+    }
+
+    while ( low <= high )
+    {
+        middle = low + (high - low) / 2;
+        cmp = mpz_cmp(list->items[middle].d, d);
+        if ( cmp == 0 )
+        {
+            return middle;
+        }
+
+        if ( cmp < 0 )
+        {
+            low = middle + 1;
+        }
+        else
+        {
+            high = middle - 1;
+        }
     }
+
+    return -1;
 }
 
 
 void mpz_ap_list_print(mpz_ap_list_t * list)
 {
-    mpz_ap_list_t * current = list;
+    int i;
 
-    while (current != NULL)
+    for ( i = 0; i < list->length; i++ )
     {
-        mpz_out_str(stdout, 10, current->x);
+        mpz_out_str(stdout, 10, list->items[i].x);
         printf(", ");
-        mpz_out_str(stdout, 10, current->y);
+        mpz_out_str(stdout, 10, list->items[i].y);
         printf(", ");
-        mpz_out_str(stdout, 10, current->z);
+        mpz_out_str(stdout, 10, list->items[i].z);
         printf(" | ");
-        mpz_out_str(stdout, 10, current->d);
+        mpz_out_str(stdout, 10, list->items[i].d);
         printf("\n");
-
-        current = current->next;
     }
 }
@@ -3,11 +3,14 @@
 
 #include <stdio.h>
 #include <stdlib.h>
+#include <stdint.h>
 #include <gmp.h>
 
+#include "square_filter.h"
 
-/** \brief Linked list of arithmetic progressions. */
-typedef struct mpz_ap_list
+
+/** \brief An arithmetic progression of three square numbers. */
+typedef struct mpz_ap
 {
     /** \brief The small square number. */
     mpz_t x;
@@ -17,52 +20,103 @@ typedef struct mpz_ap_list
     mpz_t z;
     /** \brief The distance between the middle square and the small square number. */
     mpz_t d;
-    /** \brief The pointer to the next item. */
-    struct mpz_ap_list * next;
+    /** \brief The distance modulo SQUARE_FILTER_MODULUS. */
+    uint64_t residue;
+    /** \brief The prime factors of n5 dividing the square roots of x, y and z, bit i for the i-th prime (primitive mode only, 0 otherwise). */
+    uint64_t content;
+} mpz_ap_t;
+
+
+/** \brief Contiguous list of arithmetic progressions.
+ *
+ * The arithmetic progressions are appended in any order and sorted once by
+ * mpz_ap_list_sort(). The mpz_t variables of the items are kept initialized
+ * when the list is reset, so that a list can be reused for many numbers.
+ */
+typedef struct mpz_ap_list
+{
+    /** \brief The arithmetic progressions. */
+    mpz_ap_t * items;
+    /** \brief The number of arithmetic progressions in the list. */
+    int length;
+    /** \brief The number of initialized items. */
+    int capacity;
 } mpz_ap_list_t;
 
 
-/** \brief Inserts a new arithmetic progression into the given list at the
- * correct position.
+/** \brief Initializes the given list to the empty list.
+ *
+ * \param list mpz_ap_list_t* The list.
+ * \return void
+ */
+void mpz_ap_list_init(mpz_ap_list_t * list);
+
+
+/** \brief Clears the given list and releases all memory used by it.
+ *
+ * \param list mpz_ap_list_t* The list.
+ * \return void
+ */
+void mpz_ap_list_clear(mpz_ap_list_t * list);
+
+
+/** \brief Resets the given list to the empty list.
  *
- * This function would not insert if there is already the same arithmetic
- * progression in the list. The list would always be ordered ascending by
- * distance, that is by \p y - \p x = \p z - \p y = \p d. Note that it is your
- * duty to make sure that \p x < \p y < \p z and that \p y - \p x = \p z -
- * \p y. The function would not check for that.
+ * \param list mpz_ap_list_t* The list.
+ * \return void
+ */
+void mpz_ap_list_reset(mpz_ap_list_t * list);
+
+
+/** \brief Appends a new arithmetic progression to the end of the given list.
  *
- * The passed parameters \p x, \p y and \p z can be cleared after calling this
- * function as the function would create new ones internally.
+ * Note that it is your duty to make sure that \p x < \p y < \p z and that
+ * \p y - \p x = \p z - \p y. The function would not check for that. The list
+ * has to be sorted by mpz_ap_list_sort() after the last append.
  *
- * \param list mpz_ap_list_t** The list.
+ * The passed parameters \p x, \p y and \p z are copied.
+ *
+ * \param list mpz_ap_list_t* The list.
  * \param x mpz_t The small square number.
  * \param y mpz_t The middle square number.
  * \param z mpz_t The big square number.
  * \return void
  */
-void mpz_ap_list_insert(mpz_ap_list_t ** list, mpz_t x, mpz_t y, mpz_t z);
+void mpz_ap_list_append(mpz_ap_list_t * list, mpz_t x, mpz_t y, mpz_t z);
 
 
-/** \brief Pops the first arithmetic progression from the given list.
+/** \brief Sorts the given list ascending by distance and removes duplicates.
  *
- * The function would remove the first arithmetic progression and release all
- * memory used by that element.
+ * Two arithmetic progressions with the same middle square number are the same
+ * if they have the same distance.
  *
- * \param list mpz_ap_list_t** The list.
+ * \param list mpz_ap_list_t* The list.
  * \return void
  */
-void mpz_ap_list_pop(mpz_ap_list_t ** list);
+void mpz_ap_list_sort(mpz_ap_list_t * list);
 
 
-/** \brief Cleans a given list.
+/** \brief Finds the first arithmetic progression with a distance of at least the given one.
  *
- * The function would clean the whole list and release all memory used by all
- * the elements previously in the list.
+ * The list has to be sorted by mpz_ap_list_sort().
  *
- * \param list mpz_ap_list_t** The list.
- * \return void
+ * \param list mpz_ap_list_t* The list.
+ * \param d mpz_t The distance.
+ * \return int The index of the arithmetic progression or the length of the list if all distances are smaller.
+ */
+int mpz_ap_list_lower_bound(mpz_ap_list_t * list, mpz_t d);
+
+
+/** \brief Finds the arithmetic progression with the given distance.
+ *
+ * The list has to be sorted by mpz_ap_list_sort(). The arithmetic progression
+ * is found by a binary search over the distances.
+ *
+ * \param list mpz_ap_list_t* The list.
+ * \param d mpz_t The distance.
+ * \return int The index of the arithmetic progression or -1 if not found.
  */
-void mpz_ap_list_clean(mpz_ap_list_t ** list);
+int mpz_ap_list_find(mpz_ap_list_t * list, mpz_t d);
 
 
 /** \brief Prints the given list of arithmetic progressions to the stdout.
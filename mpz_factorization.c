@@ -0,0 +1,346 @@
+#include "mpz_factorization.h"
+#include "uint64_factor.h"
+#include "primes.h"
+
+
+void mpz_factorization_init(mpz_factorization_t * factorization)
+{
+    factorization->primes = NULL;
+    factorization->exponents = NULL;
+    factorization->length = 0;
+    factorization->capacity = 0;
+    factorization->cofactors = NULL;
+    factorization->cofactorsCapacity = 0;
+    mpz_init(factorization->x);
+    mpz_init(factorization->y);
+    mpz_init(factorization->ys);
+    mpz_init(factorization->q);
+    mpz_init(factorization->t);
+}
+
+
+void mpz_factorization_clear(mpz_factorization_t * factorization)
+{
+    int i;
+
+    for ( i = 0; i < factorization->capacity; i++ )
+    {
+        mpz_clear(factorization->primes[i]);
+    }
+    for ( i = 0; i < factorization->cofactorsCapacity; i++ )
+    {
+        mpz_clear(factorization->cofactors[i]);
+    }
+
+    free(factorization->primes);
+    free(factorization->exponents);
+    free(factorization->cofactors);
+    mpz_clear(factorization->x);
+    mpz_clear(factorization->y);
+    mpz_clear(factorization->ys);
+    mpz_clear(factorization->q);
+    mpz_clear(factorization->t);
+    mpz_factorization_init(factorization);
+}
+
+
+void mpz_factorization_reset(mpz_factorization_t * factorization)
+{
+    factorization->length = 0;
+}
+
+
+/** \brief Inserts a new prime factor at the given position.
+ *
+ * The items behind the position are shifted. An initialized but unused mpz_t
+ * variable is moved to the position and returned.
+ *
+ * \param factorization mpz_factorization_t* The factorization.
+ * \param position int The position.
+ * \return __mpz_struct* The mpz_t variable at the position.
+ */
+static __mpz_struct * mpz_factorization_insert(mpz_factorization_t * factorization, int position)
+{
+    __mpz_struct spare;
+    int i;
+
+    if ( factorization->length == factorization->capacity )
+    {
+        factorization->capacity = factorization->capacity > 0 ? 2 * factorization->capacity : 16;
+        factorization->primes = realloc(factorization->primes, factorization->capacity * sizeof(mpz_t));
+        factorization->exponents = realloc(factorization->exponents, factorization->capacity * sizeof(unsigned long));
+        for ( i = factorization->length; i < factorization->capacity; i++ )
+        {
+            mpz_init(factorization->primes[i]);
+        }
+    }
+
+    // Move the first unused mpz_t variable to the position.
+    spare = factorization->primes[factorization->length][0];
+    for ( i = factorization->length; i > position; i-- )
+    {
+        factorization->primes[i][0] = factorization->primes[i - 1][0];
+        factorization->exponents[i] = factorization->exponents[i - 1];
+    }
+    factorization->primes[position][0] = spare;
+    factorization->length++;
+
+    return factorization->primes[position];
+}
+
+
+void mpz_factorization_add(mpz_factorization_t * factorization, mpz_t prime, unsigned long exponent)
+{
+    int cmp = -1;
+    int i;
+
+    for ( i = 0; i < factorization->length; i++ )
+    {
+        cmp = mpz_cmp(factorization->primes[i], prime);
+        if ( cmp >= 0 )
+        {
+            break;
+        }
+    }
+
+    if ( i < factorization->length && cmp == 0 )
+    {
+        factorization->exponents[i] += exponent;
+        return;
+    }
+
+    mpz_set(mpz_factorization_insert(factorization, i), prime);
+    factorization->exponents[i] = exponent;
+}
+
+
+void mpz_factorization_add_ui(mpz_factorization_t * factorization, unsigned long prime, unsigned long exponent)
+{
+    int cmp = -1;
+    int i;
+
+    for ( i = 0; i < factorization->length; i++ )
+    {
+        cmp = mpz_cmp_ui(factorization->primes[i], prime);
+        if ( cmp >= 0 )
+        {
+            break;
+        }
+    }
+
+    if ( i < factorization->length && cmp == 0 )
+    {
+        factorization->exponents[i] += exponent;
+        return;
+    }
+
+    mpz_set_ui(mpz_factorization_insert(factorization, i), prime);
+    factorization->exponents[i] = exponent;
+}
+
+
+/** \brief Makes sure that the given number of cofactors is initialized.
+ *
+ * \param factorization mpz_factorization_t* The factorization.
+ * \param length int The number of cofactors.
+ * \return void
+ */
+static void mpz_factorization_reserve(mpz_factorization_t * factorization, int length)
+{
+    int i;
+
+    if ( length <= factorization->cofactorsCapacity )
+    {
+        return;
+    }
+
+    factorization->cofactors = realloc(factorization->cofactors, 2 * length * sizeof(mpz_t));
+    for ( i = factorization->cofactorsCapacity; i < 2 * length; i++ )
+    {
+        mpz_init(factorization->cofactors[i]);
+    }
+    factorization->cofactorsCapacity = 2 * length;
+}
+
+
+/** \brief Finds a non trivial factor of an odd composite number.
+ *
+ * The factor is found via the Pollard-Brent rho method.
+ *
+ * \param factorization mpz_factorization_t* The factorization holding the scratch numbers.
+ * \param factor mpz_t Receives a factor f of \p n with 1 < f < n.
+ * \param n mpz_t The odd composite number.
+ * \return void
+ */
+static void mpz_factorization_rho(mpz_factorization_t * factorization, mpz_t factor, mpz_t n)
+{
+    __mpz_struct * x = factorization->x;
+    __mpz_struct * y = factorization->y;
+    __mpz_struct * ys = factorization->ys;
+    __mpz_struct * q = factorization->q;
+    __mpz_struct * t = factorization->t;
+    unsigned long c, r, k, i, limit;
+    const unsigned long m = 128;
+
+    for ( c = 1; ; c++ )
+    {
+        mpz_set_ui(y, 2);
+        mpz_set_ui(ys, 2);
+        mpz_set_ui(q, 1);
+        mpz_set_ui(factor, 1);
+        r = 1;
+
+        while ( mpz_cmp_ui(factor, 1) == 0 )
+        {
+            mpz_set(x, y);
+            for ( i = 0; i < r; i++ )
+            {
+                // y = y^2 + c mod n
+                mpz_mul(y, y, y);
+                mpz_add_ui(y, y, c);
+                mpz_mod(y, y, n);
+            }
+
+            // Multiply the differences of m steps before calculating the gcd.
+            for ( k = 0; k < r && mpz_cmp_ui(factor, 1) == 0; k += m )
+            {
+                mpz_set(ys, y);
+                limit = r - k < m ? r - k : m;
+                for ( i = 0; i < limit; i++ )
+                {
+                    mpz_mul(y, y, y);
+                    mpz_add_ui(y, y, c);
+                    mpz_mod(y, y, n);
+
+                    mpz_sub(t, x, y);
+                    mpz_mul(q, q, t);
+                    mpz_mod(q, q, n);
+                }
+                mpz_gcd(factor, q, n);
+            }
+
+            r <<= 1;
+        }
+
+        if ( mpz_cmp(factor, n) == 0 )
+        {
+            // The product collapsed, redo the last steps one by one.
+            do
+            {
+                mpz_mul(ys, ys, ys);
+                mpz_add_ui(ys, ys, c);
+                mpz_mod(ys, ys, n);
+
+                mpz_sub(t, x, ys);
+                mpz_gcd(factor, t, n);
+            }
+            while ( mpz_cmp_ui(factor, 1) == 0 );
+        }
+
+        if ( mpz_cmp(factor, n) != 0 )
+        {
+            break;
+        }
+
+        // Failed, try another polynomial.
+    }
+}
+
+
+/** \brief Factors the first cofactor, a number without small prime factors.
+ *
+ * The composite cofactors are split into two and pushed onto the stack of
+ * cofactors until every cofactor is prime or fits into 64 bits.
+ *
+ * \param factorization mpz_factorization_t* The factorization to multiply by the factors of the first cofactor.
+ * \return void
+ */
+static void mpz_factorization_split(mpz_factorization_t * factorization)
+{
+    uint64_t primes[UINT64_FACTOR_MAX];
+    int exponents[UINT64_FACTOR_MAX];
+    int length, i;
+    int top = 1;
+
+    while ( top > 0 )
+    {
+        if ( mpz_sizeinbase(factorization->cofactors[top - 1], 2) <= 64 )
+        {
+            length = uint64_factor(mpz_get_ui(factorization->cofactors[top - 1]), primes, exponents);
+            for ( i = 0; i < length; i++ )
+            {
+                mpz_factorization_add_ui(factorization, primes[i], exponents[i]);
+            }
+            top--;
+            continue;
+        }
+
+        if ( mpz_probab_prime_p(factorization->cofactors[top - 1], 25) != 0 )
+        {
+            mpz_factorization_add(factorization, factorization->cofactors[top - 1], 1);
+            top--;
+            continue;
+        }
+
+        // Replace the cofactor n by n / f and push the factor f.
+        mpz_factorization_reserve(factorization, top + 1);
+        mpz_factorization_rho(factorization, factorization->cofactors[top], factorization->cofactors[top - 1]);
+        mpz_divexact(factorization->cofactors[top - 1], factorization->cofactors[top - 1], factorization->cofactors[top]);
+        top++;
+    }
+}
+
+
+void mpz_factorize(mpz_factorization_t * factorization, mpz_t number)
+{
+    unsigned long exponent;
+    __mpz_struct * n;
+    int i;
+
+    mpz_factorization_reset(factorization);
+    primes_init();
+
+    mpz_factorization_reserve(factorization, 1);
+    n = factorization->cofactors[0];
+    mpz_abs(n, number);
+
+    // Trial divide by the table of small primes until the cofactor fits into
+    // 64 bits, from there on the factorization is done natively.
+    for ( i = 0; i < PRIMES_COUNT && mpz_sizeinbase(n, 2) > 64; i++ )
+    {
+        if ( mpz_divisible_ui_p(n, primesTable[i]) != 0 )
+        {
+            exponent = 0;
+            do
+            {
+                mpz_divexact_ui(n, n, primesTable[i]);
+                exponent++;
+            }
+            while ( mpz_divisible_ui_p(n, primesTable[i]) != 0 );
+
+            mpz_factorization_add_ui(factorization, primesTable[i], exponent);
+        }
+    }
+
+    if ( mpz_cmp_ui(n, 1) > 0 )
+    {
+        mpz_factorization_split(factorization);
+    }
+}
+
+
+void mpz_factorization_print(mpz_factorization_t * factorization)
+{
+    int i;
+
+    for ( i = 0; i < factorization->length; i++ )
+    {
+        if ( i > 0 )
+        {
+            printf(" * ");
+        }
+        mpz_out_str(stdout, 10, factorization->primes[i]);
+        printf("^%lu", factorization->exponents[i]);
+    }
+    printf("\n");
+}
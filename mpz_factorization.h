@@ -0,0 +1,105 @@
+#ifndef MPZ_FACTORIZATION_H_INCLUDED
+#define MPZ_FACTORIZATION_H_INCLUDED
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <gmp.h>
+
+
+/** \brief The prime factorization of a number.
+ *
+ * The distinct prime factors are stored in ascending order together with their
+ * exponents. The mpz_t variables of the prime factors are kept initialized
+ * when the factorization is reset, so that a factorization can be reused for
+ * many numbers. The same holds for the cofactors and the scratch numbers used
+ * while factoring, so that factoring a number allocates no memory once the
+ * variables have grown to its size.
+ */
+typedef struct mpz_factorization
+{
+    /** \brief The distinct prime factors in ascending order. */
+    mpz_t * primes;
+    /** \brief The exponents of the prime factors. */
+    unsigned long * exponents;
+    /** \brief The number of distinct prime factors. */
+    int length;
+    /** \brief The number of initialized items in primes and exponents. */
+    int capacity;
+    /** \brief The cofactors not yet split into prime factors, a stack. */
+    mpz_t * cofactors;
+    /** \brief The number of initialized items in cofactors. */
+    int cofactorsCapacity;
+    /** \brief Scratch numbers of the Pollard-Brent rho method. */
+    mpz_t x, y, ys, q, t;
+} mpz_factorization_t;
+
+
+/** \brief Initializes the given factorization to the empty factorization (of 1).
+ *
+ * \param factorization mpz_factorization_t* The factorization.
+ * \return void
+ */
+void mpz_factorization_init(mpz_factorization_t * factorization);
+
+
+/** \brief Clears the given factorization and releases all memory used by it.
+ *
+ * \param factorization mpz_factorization_t* The factorization.
+ * \return void
+ */
+void mpz_factorization_clear(mpz_factorization_t * factorization);
+
+
+/** \brief Resets the given factorization to the empty factorization (of 1).
+ *
+ * \param factorization mpz_factorization_t* The factorization.
+ * \return void
+ */
+void mpz_factorization_reset(mpz_factorization_t * factorization);
+
+
+/** \brief Multiplies the factorization by \p prime ^ \p exponent.
+ *
+ * It is your duty to make sure that \p prime is a prime number.
+ *
+ * \param factorization mpz_factorization_t* The factorization.
+ * \param prime mpz_t The prime factor.
+ * \param exponent unsigned long The exponent.
+ * \return void
+ */
+void mpz_factorization_add(mpz_factorization_t * factorization, mpz_t prime, unsigned long exponent);
+
+
+/** \brief Multiplies the factorization by \p prime ^ \p exponent.
+ *
+ * \param factorization mpz_factorization_t* The factorization.
+ * \param prime unsigned long The prime factor.
+ * \param exponent unsigned long The exponent.
+ * \return void
+ */
+void mpz_factorization_add_ui(mpz_factorization_t * factorization, unsigned long prime, unsigned long exponent);
+
+
+/** \brief Factors the given number into its prime factors.
+ *
+ * Numbers fitting into 64 bits are factored natively (see uint64_factor()).
+ * Bigger numbers are trial divided by the table of small primes until the
+ * cofactor fits into 64 bits or the table is exhausted. A remaining big
+ * cofactor is split via the Pollard-Brent rho method.
+ *
+ * \param factorization mpz_factorization_t* Receives the prime factorization.
+ * \param number mpz_t The number to factor, the absolute value would be used.
+ * \return void
+ */
+void mpz_factorize(mpz_factorization_t * factorization, mpz_t number);
+
+
+/** \brief Prints the given factorization to the stdout.
+ *
+ * \param factorization mpz_factorization_t* The factorization.
+ * \return void
+ */
+void mpz_factorization_print(mpz_factorization_t * factorization);
+
+
+#endif // MPZ_FACTORIZATION_H_INCLUDED
@@ -0,0 +1,339 @@
+#include <limits.h>
+
+#include "mpz_gaussian.h"
+
+
+void mpz_gaussian_init(mpz_gaussian_t * gaussian)
+{
+    gaussian->powersRe = NULL;
+    gaussian->powersIm = NULL;
+    gaussian->powersCapacity = 0;
+    gaussian->powersOffset = NULL;
+    gaussian->powersExponent = NULL;
+    gaussian->levelRe = NULL;
+    gaussian->levelIm = NULL;
+    gaussian->levelCapacity = 0;
+    gaussian->levels = 0;
+
+    mpz_init(gaussian->inert);
+    mpz_init(gaussian->a);
+    mpz_init(gaussian->b);
+    mpz_init(gaussian->t);
+    mpz_init(gaussian->u);
+    mpz_init(gaussian->v);
+    mpz_init(gaussian->x);
+    mpz_init(gaussian->z);
+}
+
+
+void mpz_gaussian_clear(mpz_gaussian_t * gaussian)
+{
+    int i;
+
+    for ( i = 0; i < gaussian->powersCapacity; i++ )
+    {
+        mpz_clear(gaussian->powersRe[i]);
+        mpz_clear(gaussian->powersIm[i]);
+    }
+
+    for ( i = 0; i < gaussian->levelCapacity; i++ )
+    {
+        mpz_clear(gaussian->levelRe[i]);
+        mpz_clear(gaussian->levelIm[i]);
+    }
+
+    free(gaussian->powersRe);
+    free(gaussian->powersIm);
+    free(gaussian->powersOffset);
+    free(gaussian->powersExponent);
+    free(gaussian->levelRe);
+    free(gaussian->levelIm);
+
+    mpz_clear(gaussian->inert);
+    mpz_clear(gaussian->a);
+    mpz_clear(gaussian->b);
+    mpz_clear(gaussian->t);
+    mpz_clear(gaussian->u);
+    mpz_clear(gaussian->v);
+    mpz_clear(gaussian->x);
+    mpz_clear(gaussian->z);
+}
+
+
+void mpz_gaussian_two_squares(mpz_t a, mpz_t b, mpz_t p, mpz_t t)
+{
+    unsigned long c;
+
+    // Find a quadratic non-residue c, then x = c^((p - 1) / 4) is a square
+    // root of -1 modulo p.
+    for ( c = 2; ; c++ )
+    {
+        mpz_set_ui(t, c);
+        if ( mpz_legendre(t, p) == -1 )
+        {
+            break;
+        }
+    }
+
+    mpz_sub_ui(b, p, 1);
+    mpz_fdiv_q_2exp(b, b, 2);
+    mpz_powm(b, t, b, p);
+
+    // Run the Euclidean algorithm on p and x until the remainder drops below
+    // sqrt(p). That remainder is the first number.
+    mpz_set(a, p);
+    while ( 1 )
+    {
+        mpz_mul(t, b, b);
+        if ( mpz_cmp(t, p) < 0 )
+        {
+            break;
+        }
+
+        mpz_mod(t, a, b);
+        mpz_set(a, b);
+        mpz_set(b, t);
+    }
+
+    // a = remainder, b = sqrt(p - a^2)
+    mpz_mul(t, b, b);
+    mpz_sub(t, p, t);
+    mpz_set(a, b);
+    mpz_sqrt(b, t);
+}
+
+
+unsigned long mpz_gaussian_count(mpz_factorization_t * factorization)
+{
+    unsigned long product = 1;
+    unsigned long factor;
+    int i;
+
+    for ( i = 0; i < factorization->length; i++ )
+    {
+        if ( mpz_fdiv_ui(factorization->primes[i], 4) != 1 )
+        {
+            continue;
+        }
+
+        factor = 2 * factorization->exponents[i] + 1;
+        if ( product > ULONG_MAX / factor )
+        {
+            return ULONG_MAX;
+        }
+        product *= factor;
+    }
+
+    return (product - 1) / 2;
+}
+
+
+/** \brief Multiplies two Gaussian integers.
+ *
+ * \param re mpz_t Receives the real part of the product.
+ * \param im mpz_t Receives the imaginary part of the product.
+ * \param aRe mpz_t The real part of the first factor.
+ * \param aIm mpz_t The imaginary part of the first factor.
+ * \param bRe mpz_t The real part of the second factor.
+ * \param bIm mpz_t The imaginary part of the second factor.
+ * \param t mpz_t An mpz_t variable that can be used by the function.
+ * \return void
+ */
+static void mpz_gaussian_mul(mpz_t re, mpz_t im, mpz_t aRe, mpz_t aIm, mpz_t bRe, mpz_t bIm, mpz_t t)
+{
+    // re = aRe * bRe - aIm * bIm
+    mpz_mul(re, aRe, bRe);
+    mpz_mul(t, aIm, bIm);
+    mpz_sub(re, re, t);
+
+    // im = aRe * bIm + aIm * bRe
+    mpz_mul(im, aRe, bIm);
+    mpz_mul(t, aIm, bRe);
+    mpz_add(im, im, t);
+}
+
+
+/** \brief Makes sure that the given number of powers and levels are initialized.
+ *
+ * \param gaussian mpz_gaussian_t* The state.
+ * \param powers int The number of powers needed.
+ * \param levels int The number of primes p = 1 (mod 4).
+ * \return void
+ */
+static void mpz_gaussian_reserve(mpz_gaussian_t * gaussian, int powers, int levels)
+{
+    int i;
+
+    if ( powers > gaussian->powersCapacity )
+    {
+        gaussian->powersRe = realloc(gaussian->powersRe, powers * sizeof(mpz_t));
+        gaussian->powersIm = realloc(gaussian->powersIm, powers * sizeof(mpz_t));
+        for ( i = gaussian->powersCapacity; i < powers; i++ )
+        {
+            mpz_init(gaussian->powersRe[i]);
+            mpz_init(gaussian->powersIm[i]);
+        }
+        gaussian->powersCapacity = powers;
+    }
+
+    // One level more than primes: the last level holds the full product.
+    if ( levels + 1 > gaussian->levelCapacity )
+    {
+        gaussian->levelRe = realloc(gaussian->levelRe, (levels + 1) * sizeof(mpz_t));
+        gaussian->levelIm = realloc(gaussian->levelIm, (levels + 1) * sizeof(mpz_t));
+        gaussian->powersOffset = realloc(gaussian->powersOffset, (levels + 1) * sizeof(int));
+        gaussian->powersExponent = realloc(gaussian->powersExponent, (levels + 1) * sizeof(unsigned long));
+        for ( i = gaussian->levelCapacity; i < levels + 1; i++ )
+        {
+            mpz_init(gaussian->levelRe[i]);
+            mpz_init(gaussian->levelIm[i]);
+        }
+        gaussian->levelCapacity = levels + 1;
+    }
+}
+
+
+/** \brief Enumerates the Gaussian integers of norm n^2 recursively.
+ *
+ * For the prime of the given level, pi^a * conj(pi)^(2e - a) is multiplied to
+ * the partial product for every a in [0, 2e]. A Gaussian integer and its
+ * conjugate give the same arithmetic progression. Therefore, as long as all
+ * earlier levels chose a = e, only a <= e is enumerated.
+ *
+ * \param gaussian mpz_gaussian_t* The state.
+ * \param level int The level.
+ * \param decided int Whether an earlier level chose a != e.
+ * \param numberSquared mpz_t The center n^2.
+ * \param list mpz_ap_list_t* The list.
+ * \return void
+ */
+static void mpz_gaussian_enumerate(mpz_gaussian_t * gaussian, int level, int decided, mpz_t numberSquared, mpz_ap_list_t * list)
+{
+    unsigned long a, e, last;
+    int power;
+
+    if ( level == gaussian->levels )
+    {
+        if ( decided == 0 )
+        {
+            // This is n itself, i.e. n^2 = n^2 + 0^2.
+            return;
+        }
+
+        // u = |re| * inert, v = |im| * inert
+        mpz_abs(gaussian->u, gaussian->levelRe[level]);
+        mpz_mul(gaussian->u, gaussian->u, gaussian->inert);
+        mpz_abs(gaussian->v, gaussian->levelIm[level]);
+        mpz_mul(gaussian->v, gaussian->v, gaussian->inert);
+
+        // x = (u - v)^2
+        mpz_sub(gaussian->x, gaussian->u, gaussian->v);
+        mpz_mul(gaussian->x, gaussian->x, gaussian->x);
+
+        // z = (u + v)^2
+        mpz_add(gaussian->z, gaussian->u, gaussian->v);
+        mpz_mul(gaussian->z, gaussian->z, gaussian->z);
+
+        // Append the arithmetic progression [x, n^2, z] to the list.
+        mpz_ap_list_append(list, gaussian->x, numberSquared, gaussian->z);
+        return;
+    }
+
+    e = gaussian->powersExponent[level];
+    last = decided ? 2 * e : e;
+    for ( a = 0; a <= last; a++ )
+    {
+        power = gaussian->powersOffset[level] + (int) a;
+        mpz_gaussian_mul(gaussian->levelRe[level + 1], gaussian->levelIm[level + 1],
+                         gaussian->levelRe[level], gaussian->levelIm[level],
+                         gaussian->powersRe[power], gaussian->powersIm[power],
+                         gaussian->t);
+
+        mpz_gaussian_enumerate(gaussian, level + 1, decided || a != e, numberSquared, list);
+    }
+}
+
+
+void mpz_gaussian_aps(mpz_gaussian_t * gaussian, mpz_factorization_t * factorization, mpz_t numberSquared, mpz_ap_list_t * list)
+{
+    unsigned long e, k;
+    int powers = 0;
+    int levels = 0;
+    int offset, i;
+
+    // Count the primes p = 1 (mod 4) and the powers needed for them.
+    for ( i = 0; i < factorization->length; i++ )
+    {
+        if ( mpz_fdiv_ui(factorization->primes[i], 4) == 1 )
+        {
+            powers += 2 * (int) factorization->exponents[i] + 1;
+            levels++;
+        }
+    }
+
+    if ( levels == 0 )
+    {
+        // Without any prime p = 1 (mod 4) there is no representation.
+        return;
+    }
+
+    mpz_gaussian_reserve(gaussian, powers, levels);
+    gaussian->levels = levels;
+
+    mpz_set_ui(gaussian->inert, 1);
+    offset = 0;
+    levels = 0;
+    for ( i = 0; i < factorization->length; i++ )
+    {
+        e = factorization->exponents[i];
+
+        if ( mpz_fdiv_ui(factorization->primes[i], 4) != 1 )
+        {
+            // q = 3 (mod 4) stays prime in the Gaussian integers and q^e
+            // divides u and v (so would 2^e, which does not occur for odd n).
+            mpz_pow_ui(gaussian->t, factorization->primes[i], e);
+            mpz_mul(gaussian->inert, gaussian->inert, gaussian->t);
+            continue;
+        }
+
+        // p = a^2 + b^2 = pi * conj(pi) with pi = a + b * i.
+        mpz_gaussian_two_squares(gaussian->a, gaussian->b, factorization->primes[i], gaussian->t);
+
+        gaussian->powersOffset[levels] = offset;
+        gaussian->powersExponent[levels] = e;
+
+        // First calculate P_k = pi^k for k in [0, 2e].
+        mpz_set_ui(gaussian->powersRe[offset], 1);
+        mpz_set_ui(gaussian->powersIm[offset], 0);
+        for ( k = 1; k <= 2 * e; k++ )
+        {
+            mpz_gaussian_mul(gaussian->powersRe[offset + k], gaussian->powersIm[offset + k],
+                             gaussian->powersRe[offset + k - 1], gaussian->powersIm[offset + k - 1],
+                             gaussian->a, gaussian->b,
+                             gaussian->t);
+        }
+
+        // Then replace them by W_k = P_k * conj(P_(2e - k)). Note that
+        // W_(2e - k) = conj(W_k), so the pairs can be replaced in place.
+        for ( k = 0; k <= e; k++ )
+        {
+            mpz_neg(gaussian->v, gaussian->powersIm[offset + 2 * e - k]);
+            mpz_gaussian_mul(gaussian->x, gaussian->z,
+                             gaussian->powersRe[offset + k], gaussian->powersIm[offset + k],
+                             gaussian->powersRe[offset + 2 * e - k], gaussian->v,
+                             gaussian->t);
+
+            mpz_set(gaussian->powersRe[offset + k], gaussian->x);
+            mpz_set(gaussian->powersIm[offset + k], gaussian->z);
+            mpz_set(gaussian->powersRe[offset + 2 * e - k], gaussian->x);
+            mpz_neg(gaussian->powersIm[offset + 2 * e - k], gaussian->z);
+        }
+
+        offset += 2 * (int) e + 1;
+        levels++;
+    }
+
+    mpz_set_ui(gaussian->levelRe[0], 1);
+    mpz_set_ui(gaussian->levelIm[0], 0);
+    mpz_gaussian_enumerate(gaussian, 0, 0, numberSquared, list);
+}
@@ -0,0 +1,106 @@
+#ifndef MPZ_GAUSSIAN_H_INCLUDED
+#define MPZ_GAUSSIAN_H_INCLUDED
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <gmp.h>
+
+#include "mpz_factorization.h"
+#include "mpz_ap_list.h"
+
+
+/** \brief The state needed to build arithmetic progressions from Gaussian integers.
+ *
+ * Every representation n^2 = u^2 + v^2 corresponds to a Gaussian integer
+ * z = u + v * i with norm n^2. Given the prime factorization of n, all those
+ * Gaussian integers are products of the Gaussian primes above the primes
+ * p = 1 (mod 4) of n, multiplied by the primes q = 3 (mod 4) of n. The
+ * representation u^2 + v^2 = n^2 then gives the arithmetic progression
+ * (u - v)^2, n^2, (u + v)^2.
+ *
+ * All mpz_t variables are kept initialized, so that the state can be reused
+ * for many numbers.
+ */
+typedef struct mpz_gaussian
+{
+    /** \brief The real parts of the precomputed powers pi^a * conj(pi)^(2e - a). */
+    mpz_t * powersRe;
+    /** \brief The imaginary parts of the precomputed powers. */
+    mpz_t * powersIm;
+    /** \brief The number of initialized powers. */
+    int powersCapacity;
+    /** \brief Per prime p = 1 (mod 4) the index of its first power. */
+    int * powersOffset;
+    /** \brief Per prime p = 1 (mod 4) its exponent e in n. */
+    unsigned long * powersExponent;
+    /** \brief The real parts of the partial products, one per level. */
+    mpz_t * levelRe;
+    /** \brief The imaginary parts of the partial products, one per level. */
+    mpz_t * levelIm;
+    /** \brief The number of initialized levels. */
+    int levelCapacity;
+    /** \brief The number of primes p = 1 (mod 4) of n. */
+    int levels;
+    /** \brief The product of q^f over all primes q = 3 (mod 4) of n. */
+    mpz_t inert;
+    /** \brief Scratch variables. */
+    mpz_t a, b, t, u, v, x, z;
+} mpz_gaussian_t;
+
+
+/** \brief Initializes the given state.
+ *
+ * \param gaussian mpz_gaussian_t* The state.
+ * \return void
+ */
+void mpz_gaussian_init(mpz_gaussian_t * gaussian);
+
+
+/** \brief Clears the given state and releases all memory used by it.
+ *
+ * \param gaussian mpz_gaussian_t* The state.
+ * \return void
+ */
+void mpz_gaussian_clear(mpz_gaussian_t * gaussian);
+
+
+/** \brief Finds the representation of a prime p = 1 (mod 4) as a sum of two squares.
+ *
+ * The representation is found via the Hermite-Serret (Cornacchia) algorithm.
+ *
+ * \param a mpz_t Receives the first number.
+ * \param b mpz_t Receives the second number.
+ * \param p mpz_t The prime p = 1 (mod 4).
+ * \param t mpz_t An mpz_t variable that can be used by the function.
+ * \return void
+ */
+void mpz_gaussian_two_squares(mpz_t a, mpz_t b, mpz_t p, mpz_t t);
+
+
+/** \brief Counts the arithmetic progressions of squares centered at n^2.
+ *
+ * The count is (r2(n^2) / 4 - 1) / 2 = ((2e_1 + 1) * ... * (2e_k + 1) - 1) / 2
+ * where e_1, ..., e_k are the exponents of the primes p = 1 (mod 4) of n. The
+ * count saturates at ULONG_MAX.
+ *
+ * \param factorization mpz_factorization_t* The prime factorization of n, n being odd.
+ * \return unsigned long The number of arithmetic progressions.
+ */
+unsigned long mpz_gaussian_count(mpz_factorization_t * factorization);
+
+
+/** \brief Appends all arithmetic progressions of squares centered at n^2 to the given list.
+ *
+ * The work done is proportional to the number of representations of n^2 as
+ * a sum of two squares, not to the size of n.
+ *
+ * \param gaussian mpz_gaussian_t* The state.
+ * \param factorization mpz_factorization_t* The prime factorization of n, n being odd.
+ * \param numberSquared mpz_t The center n^2.
+ * \param list mpz_ap_list_t* The list, sorted by mpz_ap_list_sort() afterwards.
+ * \return void
+ */
+void mpz_gaussian_aps(mpz_gaussian_t * gaussian, mpz_factorization_t * factorization, mpz_t numberSquared, mpz_ap_list_t * list);
+
+
+#endif // MPZ_GAUSSIAN_H_INCLUDED
@@ -0,0 +1,367 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+
+#include "pipeline.h"
+
+
+/** \brief A generator waiting in the queue. */
+typedef struct pipeline_item
+{
+    /** \brief The generator number g. */
+    mpz_t generator;
+    /** \brief The generator function, either 1 (6g + 1) or -1 (6g - 1). */
+    int plusMinus;
+} pipeline_item_t;
+
+
+/** \brief The data shared by the reader and the workers of a pipeline.
+ *
+ * The queue is a ring buffer of capacity items. Its mpz_t variables are
+ * initialized once and reused, so queueing a generator allocates no memory
+ * once the numbers have grown to its size.
+ */
+typedef struct pipeline_context
+{
+    /** \brief The options of the search. */
+    const search_options_t * options;
+    /** \brief The queued generators. */
+    pipeline_item_t * items;
+    /** \brief The number of items of the ring buffer. */
+    int capacity;
+    /** \brief The index of the first queued generator. */
+    int head;
+    /** \brief The number of queued generators. */
+    int length;
+    /** \brief Whether no more generators are queued. */
+    int closed;
+    /** \brief Protects the queue. */
+    pthread_mutex_t mutex;
+    /** \brief Signals that a generator has been queued or the queue has been closed. */
+    pthread_cond_t notEmpty;
+    /** \brief Signals that a generator has been taken from the queue. */
+    pthread_cond_t notFull;
+    /** \brief The number of workers. */
+    int threads;
+    /** \brief The report of the counters, NULL for none. */
+    stats_report_t * report;
+    /** \brief The counters of every worker as of its last generator. */
+    search_stats_t * workerStats;
+    /** \brief The ticks the reader has spent parsing the lines. */
+    uint64_t parseTicks;
+    /** \brief Protects workerStats and parseTicks. */
+    pthread_mutex_t statsMutex;
+} pipeline_context_t;
+
+
+/** \brief The data of one worker. */
+typedef struct pipeline_worker
+{
+    /** \brief The shared context. */
+    pipeline_context_t * context;
+    /** \brief The index of the worker. */
+    int index;
+    /** \brief The thread running the worker. */
+    pthread_t thread;
+} pipeline_worker_t;
+
+
+int pipeline_parse(char * line, mpz_t generator, int * plusMinus)
+{
+    size_t length = strlen(line);
+
+    if ( length == 0 || line[length - 1] != '\n' )
+    {
+        // ERROR: Input was truncated or pipe stream was closed.
+        return PIPELINE_TRUNCATED;
+    }
+
+    if ( line[0] == 'q' )
+    {
+        return PIPELINE_QUIT;
+    }
+
+    // The sign defaults to '+'.
+    *plusMinus = 1;
+    if ( length >= 2 && (line[length - 2] == '+' || line[length - 2] == '-') )
+    {
+        *plusMinus = line[length - 2] == '+' ? 1 : -1;
+        line[length - 2] = '\n';
+    }
+
+    if ( mpz_set_str(generator, line, 10) != 0 )
+    {
+        // ERROR: Given input was not a valid number.
+        return PIPELINE_INVALID;
+    }
+
+    return PIPELINE_GENERATOR;
+}
+
+
+/** \brief Queues a generator, waits while the queue is full.
+ *
+ * \param context pipeline_context_t* The context.
+ * \param generator mpz_t The generator.
+ * \param plusMinus int The generator function.
+ * \return void
+ */
+static void pipeline_push(pipeline_context_t * context, mpz_t generator, int plusMinus)
+{
+    pipeline_item_t * item;
+
+    pthread_mutex_lock(&context->mutex);
+    while ( context->length == context->capacity )
+    {
+        pthread_cond_wait(&context->notFull, &context->mutex);
+    }
+
+    item = &context->items[(context->head + context->length) % context->capacity];
+    mpz_set(item->generator, generator);
+    item->plusMinus = plusMinus;
+    context->length++;
+
+    pthread_cond_signal(&context->notEmpty);
+    pthread_mutex_unlock(&context->mutex);
+}
+
+
+/** \brief Takes the next generator from the queue, waits while the queue is empty.
+ *
+ * \param context pipeline_context_t* The context.
+ * \param generator mpz_t Receives the generator.
+ * \param plusMinus int* Receives the generator function.
+ * \return int 1 if a generator has been taken, 0 if the queue is closed and empty.
+ */
+static int pipeline_pop(pipeline_context_t * context, mpz_t generator, int * plusMinus)
+{
+    pipeline_item_t * item;
+
+    pthread_mutex_lock(&context->mutex);
+    while ( context->length == 0 && context->closed == 0 )
+    {
+        pthread_cond_wait(&context->notEmpty, &context->mutex);
+    }
+
+    if ( context->length == 0 )
+    {
+        pthread_mutex_unlock(&context->mutex);
+        return 0;
+    }
+
+    item = &context->items[context->head];
+    mpz_swap(generator, item->generator);
+    *plusMinus = item->plusMinus;
+    context->head = (context->head + 1) % context->capacity;
+    context->length--;
+
+    pthread_cond_signal(&context->notFull);
+    pthread_mutex_unlock(&context->mutex);
+
+    return 1;
+}
+
+
+/** \brief Closes the queue, the workers finish once it is empty.
+ *
+ * \param context pipeline_context_t* The context.
+ * \return void
+ */
+static void pipeline_close(pipeline_context_t * context)
+{
+    pthread_mutex_lock(&context->mutex);
+    context->closed = 1;
+    pthread_cond_broadcast(&context->notEmpty);
+    pthread_mutex_unlock(&context->mutex);
+}
+
+
+/** \brief Reports the counters of every worker and their total.
+ *
+ * The lines are parsed by the reader, so their ticks are part of the total only.
+ *
+ * \param context pipeline_context_t* The context.
+ * \return void
+ */
+static void pipeline_report(pipeline_context_t * context)
+{
+    search_stats_t total;
+    char label[32];
+    int i;
+
+    search_stats_init(&total);
+
+    pthread_mutex_lock(&context->statsMutex);
+    stats_report_begin(context->report);
+    for ( i = 0; i < context->threads; i++ )
+    {
+        snprintf(label, sizeof label, "worker %d", i);
+        search_stats_print(context->report, label, &context->workerStats[i]);
+        search_stats_add(&total, &context->workerStats[i]);
+    }
+    total.ticks[STATS_STAGE_PARSE] += context->parseTicks;
+    search_stats_print(context->report, "total", &total);
+    fflush(context->report->stream);
+    pthread_mutex_unlock(&context->statsMutex);
+}
+
+
+/** \brief Searches the queued generators until the queue is closed and empty.
+ *
+ * \param argument void* The worker, see pipeline_worker_t.
+ * \return void* Always NULL.
+ */
+static void * pipeline_worker_run(void * argument)
+{
+    pipeline_worker_t * worker = argument;
+    pipeline_context_t * context = worker->context;
+    search_state_t state;
+    mpz_t generator;
+    int plusMinus;
+
+    search_state_init(&state, context->options);
+    mpz_init(generator);
+
+    while ( pipeline_pop(context, generator, &plusMinus) )
+    {
+        search_generator(&state, generator, plusMinus);
+        search_state_flush(&state);
+
+        // The keys of the results are printed before, the line must not be torn.
+        flockfile(stdout);
+        printf("_ ");
+        mpz_out_str(stdout, 10, generator);
+        printf("%c\n", plusMinus > 0 ? '+' : '-');
+        fflush(stdout);
+        funlockfile(stdout);
+
+        if ( context->report != NULL )
+        {
+            pthread_mutex_lock(&context->statsMutex);
+            context->workerStats[worker->index] = state.stats;
+            pthread_mutex_unlock(&context->statsMutex);
+
+            if ( stats_report_due(context->report) )
+            {
+                pipeline_report(context);
+            }
+        }
+    }
+
+    mpz_clear(generator);
+    search_state_clear(&state);
+
+    return NULL;
+}
+
+
+int pipeline_run(const search_options_t * options, int threads, int capacity, FILE * input, stats_report_t * report)
+{
+    pipeline_context_t context;
+    pipeline_worker_t * workers;
+    char buf[BUFSIZ];
+    mpz_t generator;
+    uint64_t ticks;
+    int plusMinus;
+    int kind;
+    int status = -1;
+    int i;
+
+    context.options = options;
+    context.capacity = capacity > 0 ? capacity : 1;
+    context.items = malloc(context.capacity * sizeof(pipeline_item_t));
+    for ( i = 0; i < context.capacity; i++ )
+    {
+        mpz_init(context.items[i].generator);
+    }
+    context.head = 0;
+    context.length = 0;
+    context.closed = 0;
+    pthread_mutex_init(&context.mutex, NULL);
+    pthread_cond_init(&context.notEmpty, NULL);
+    pthread_cond_init(&context.notFull, NULL);
+    context.threads = threads;
+    context.report = report;
+    context.workerStats = NULL;
+    context.parseTicks = 0;
+    if ( report != NULL )
+    {
+        context.workerStats = malloc(threads * sizeof(search_stats_t));
+        for ( i = 0; i < threads; i++ )
+        {
+            search_stats_init(&context.workerStats[i]);
+        }
+    }
+    pthread_mutex_init(&context.statsMutex, NULL);
+
+    workers = malloc(threads * sizeof(pipeline_worker_t));
+    for ( i = 0; i < threads; i++ )
+    {
+        workers[i].context = &context;
+        workers[i].index = i;
+        pthread_create(&workers[i].thread, NULL, pipeline_worker_run, &workers[i]);
+    }
+
+    mpz_init(generator);
+    while ( status < 0 )
+    {
+        if ( fgets(buf, sizeof buf, input) == NULL )
+        {
+            buf[0] = '\0';
+        }
+
+        ticks = stats_ticks();
+        kind = pipeline_parse(buf, generator, &plusMinus);
+        if ( report != NULL )
+        {
+            pthread_mutex_lock(&context.statsMutex);
+            context.parseTicks += stats_ticks() - ticks;
+            pthread_mutex_unlock(&context.statsMutex);
+        }
+
+        switch ( kind )
+        {
+        case PIPELINE_GENERATOR:
+            // Waits as long as the queue is full.
+            pipeline_push(&context, generator, plusMinus);
+            break;
+        case PIPELINE_QUIT:
+            status = 0;
+            break;
+        case PIPELINE_INVALID:
+            status = 1;
+            break;
+        default:
+            status = 2;
+            break;
+        }
+    }
+    mpz_clear(generator);
+
+    // The generators already queued are searched anyway.
+    pipeline_close(&context);
+    for ( i = 0; i < threads; i++ )
+    {
+        pthread_join(workers[i].thread, NULL);
+    }
+
+    if ( report != NULL )
+    {
+        pipeline_report(&context);
+    }
+
+    free(workers);
+    free(context.workerStats);
+    pthread_mutex_destroy(&context.statsMutex);
+    pthread_cond_destroy(&context.notFull);
+    pthread_cond_destroy(&context.notEmpty);
+    pthread_mutex_destroy(&context.mutex);
+    for ( i = 0; i < context.capacity; i++ )
+    {
+        mpz_clear(context.items[i].generator);
+    }
+    free(context.items);
+
+    return status;
+}
@@ -0,0 +1,53 @@
+#ifndef PIPELINE_H_INCLUDED
+#define PIPELINE_H_INCLUDED
+
+#include <stdio.h>
+#include <gmp.h>
+
+#include "search.h"
+#include "stats.h"
+
+
+/** \brief The kinds of lines read from the stdin, see pipeline_parse(). */
+#define PIPELINE_GENERATOR 0
+#define PIPELINE_QUIT 1
+#define PIPELINE_INVALID 2
+#define PIPELINE_TRUNCATED 3
+
+
+/** \brief Parses a line of the stdin protocol.
+ *
+ * A line is either the quit command "q" or a generator string, i.e. a number
+ * followed by '+' (6g + 1, the default) or '-' (6g - 1). A line must end by a
+ * newline, otherwise it has been truncated or the stream has been closed.
+ *
+ * \param line char* The line, the sign is removed from it.
+ * \param generator mpz_t Receives the generator.
+ * \param plusMinus int* Receives 1 for '+' and -1 for '-'.
+ * \return int PIPELINE_GENERATOR, PIPELINE_QUIT, PIPELINE_INVALID or PIPELINE_TRUNCATED.
+ */
+int pipeline_parse(char * line, mpz_t generator, int * plusMinus);
+
+
+/** \brief Reads generator strings from a stream and searches them concurrently.
+ *
+ * The calling thread reads the lines into a bounded queue, as long as there
+ * is room in it. The workers take the generators from the queue, each with
+ * its own search state, and print "_ <generator><sign>" (e.g. "_ 141-") after
+ * the results of a generator. The generators may complete in any order.
+ *
+ * The quit command "q" stops the reading. The generators already queued are
+ * searched before the function returns.
+ *
+ * \param options search_options_t* The options of the search.
+ * \param threads int The number of workers.
+ * \param capacity int The number of generators the queue holds at most.
+ * \param input FILE* The stream to read the lines from.
+ * \param report stats_report_t* The report of the counters, NULL for none.
+ * \return int 0 after "q", 1 after an invalid line, 2 if the input ended
+ *         without "q".
+ */
+int pipeline_run(const search_options_t * options, int threads, int capacity, FILE * input, stats_report_t * report);
+
+
+#endif // PIPELINE_H_INCLUDED
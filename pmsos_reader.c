@@ -0,0 +1,330 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <gmp.h>
+
+#include "result_log.h"
+
+
+/** \brief The output formats of the reader. */
+#define READER_TEXT 0
+#define READER_CSV 1
+#define READER_FILES 2
+
+
+/** \brief The numbers of a result rebuilt from its record. */
+typedef struct reader_square
+{
+    /** \brief The number n5 = 6 * generator + plusMinus. */
+    mpz_t number;
+    /** \brief The center square number n5^2. */
+    mpz_t c;
+    /** \brief The nine numbers of the magic square, row by row. */
+    mpz_t s[9];
+} reader_square_t;
+
+
+/** \brief Prints the command line usage to the stderr.
+ *
+ * \param program const char* The name of the program.
+ * \return void
+ */
+void reader_usage(const char * program)
+{
+    fprintf(stderr, "Usage: %s [--text | --csv | --files] [LOG]\n", program);
+    fprintf(stderr, "\n");
+    fprintf(stderr, "Reads a results log (default: the stdin) and prints every result.\n");
+    fprintf(stderr, "\n");
+    fprintf(stderr, "  --text   One line per result: key;n5;n5^2;pattern;magic square (default).\n");
+    fprintf(stderr, "  --csv    Comma separated values with a header line.\n");
+    fprintf(stderr, "  --files  Write every result to its own file <key>.result.\n");
+}
+
+
+/** \brief Rebuilds the magic square of a record.
+ *
+ * \param square reader_square_t* Receives the numbers.
+ * \param record result_record_t* The record.
+ * \return void
+ */
+void reader_rebuild(reader_square_t * square, result_record_t * record)
+{
+    // number = 6 * generator + plusMinus, c = number^2
+    mpz_mul_ui(square->number, record->generator, 6);
+    if ( record->plusMinus > 0 )
+    {
+        mpz_add_ui(square->number, square->number, 1);
+    }
+    else
+    {
+        mpz_sub_ui(square->number, square->number, 1);
+    }
+    mpz_mul(square->c, square->number, square->number);
+
+    // c - b, c + (a + b), c - a
+    mpz_sub(square->s[0], square->c, record->b);
+    mpz_add(square->s[1], square->c, record->a);
+    mpz_add(square->s[1], square->s[1], record->b);
+    mpz_sub(square->s[2], square->c, record->a);
+
+    // c - (a - b), c, c + (a - b)
+    mpz_sub(square->s[3], square->c, record->a);
+    mpz_add(square->s[3], square->s[3], record->b);
+    mpz_set(square->s[4], square->c);
+    mpz_add(square->s[5], square->c, record->a);
+    mpz_sub(square->s[5], square->s[5], record->b);
+
+    // c + a, c - (a + b), c + b
+    mpz_add(square->s[6], square->c, record->a);
+    mpz_sub(square->s[7], square->c, record->a);
+    mpz_sub(square->s[7], square->s[7], record->b);
+    mpz_add(square->s[8], square->c, record->b);
+}
+
+
+/** \brief Writes the key of a record, e.g. "ps,7,141M,1".
+ *
+ * \param stream FILE* The stream.
+ * \param record result_record_t* The record.
+ * \return void
+ */
+void reader_write_key(FILE * stream, result_record_t * record)
+{
+    fprintf(stream, "%s,%d,", result_type_name(record->type), record->squares);
+    mpz_out_str(stream, 10, record->generator);
+    fprintf(stream, "%s,%lu", record->plusMinus > 0 ? "P" : "M", record->counter);
+}
+
+
+/** \brief Writes the pattern of the perfect square numbers of a record.
+ *
+ * \param stream FILE* The stream.
+ * \param record result_record_t* The record.
+ * \param separator const char* The separator of the rows.
+ * \return void
+ */
+void reader_write_pattern(FILE * stream, result_record_t * record, const char * separator)
+{
+    fprintf(stream, "1 %d 1%s%d 1 %d%s1 %d 1",
+            (record->mask & RESULT_FLAG_S2) ? 1 : 0,
+            separator,
+            (record->mask & RESULT_FLAG_S4) ? 1 : 0,
+            (record->mask & RESULT_FLAG_S6) ? 1 : 0,
+            separator,
+            (record->mask & RESULT_FLAG_S8) ? 1 : 0);
+}
+
+
+/** \brief Writes the nine numbers of a magic square as "s1 s2 s3 | s4 s5 s6 | s7 s8 s9".
+ *
+ * \param stream FILE* The stream.
+ * \param square reader_square_t* The numbers.
+ * \return void
+ */
+void reader_write_square(FILE * stream, reader_square_t * square)
+{
+    int i;
+
+    for ( i = 0; i < 9; i++ )
+    {
+        if ( i > 0 )
+        {
+            fprintf(stream, i % 3 == 0 ? " | " : " ");
+        }
+        mpz_out_str(stream, 10, square->s[i]);
+    }
+}
+
+
+/** \brief Writes a record in the given format.
+ *
+ * \param format int The format, READER_*.
+ * \param record result_record_t* The record.
+ * \param square reader_square_t* The rebuilt numbers of the record.
+ * \return int 0 on success, 1 if a result file could not be written.
+ */
+int reader_write(int format, result_record_t * record, reader_square_t * square)
+{
+    // The key holds the generator and at most 48 more characters, see search_write_result().
+    char filename[mpz_sizeinbase(record->generator, 10) + 56];
+    FILE * fp;
+    int failed;
+    int i;
+
+    if ( format == READER_TEXT )
+    {
+        reader_write_key(stdout, record);
+        printf(";");
+        mpz_out_str(stdout, 10, square->number);
+        printf(";");
+        mpz_out_str(stdout, 10, square->c);
+        printf(";");
+        reader_write_pattern(stdout, record, " | ");
+        printf(";");
+        reader_write_square(stdout, square);
+        printf("\n");
+    }
+    else if ( format == READER_CSV )
+    {
+        printf("%s,%d,", result_type_name(record->type), record->squares);
+        mpz_out_str(stdout, 10, record->generator);
+        printf(",%s,%lu,", record->plusMinus > 0 ? "+" : "-", record->counter);
+        reader_write_pattern(stdout, record, " ");
+        printf(",");
+        mpz_out_str(stdout, 10, square->number);
+        printf(",");
+        mpz_out_str(stdout, 10, record->a);
+        printf(",");
+        mpz_out_str(stdout, 10, record->b);
+        for ( i = 0; i < 9; i++ )
+        {
+            printf(",");
+            mpz_out_str(stdout, 10, square->s[i]);
+        }
+        printf("\n");
+    }
+    else
+    {
+        // The layout of the result files of earlier versions.
+        fp = fmemopen(filename, sizeof filename, "w");
+        if ( fp == NULL )
+        {
+            return 1;
+        }
+        reader_write_key(fp, record);
+        fprintf(fp, ".result");
+        fputc('\0', fp);
+        failed = ferror(fp);
+        failed |= fclose(fp) != 0;
+        if ( failed || memchr(filename, '\0', sizeof filename) == NULL )
+        {
+            // ERROR: A cut file name would overwrite the file of another result.
+            return 1;
+        }
+
+        fp = fopen(filename, "w");
+        if ( fp == NULL )
+        {
+            return 1;
+        }
+        mpz_out_str(fp, 10, square->number);
+        fprintf(fp, "\n");
+        mpz_out_str(fp, 10, square->c);
+        fprintf(fp, "\n");
+        reader_write_pattern(fp, record, " | ");
+        fprintf(fp, "\n");
+        reader_write_square(fp, square);
+        fprintf(fp, "\n");
+        fclose(fp);
+    }
+
+    return 0;
+}
+
+
+/** \brief The main function of the reader.
+ *
+ * Exit codes: 0 on success, 1 if the log is broken, 2 if a file could not
+ * be opened or written, 3 on invalid arguments.
+ *
+ * \param argc int Number of command line arguments given.
+ * \param argv char** Array of command line arguments given.
+ * \return int
+ */
+int main(int argc, char **argv)
+{
+    result_record_t record;
+    reader_square_t square;
+    FILE * file = stdin;
+    const char * path = NULL;
+    int format = READER_TEXT;
+    int status = 0;
+    int read, i;
+
+    for ( i = 1; i < argc; i++ )
+    {
+        if ( strcmp(argv[i], "--text") == 0 )
+        {
+            format = READER_TEXT;
+        }
+        else if ( strcmp(argv[i], "--csv") == 0 )
+        {
+            format = READER_CSV;
+        }
+        else if ( strcmp(argv[i], "--files") == 0 )
+        {
+            format = READER_FILES;
+        }
+        else if ( argv[i][0] != '-' && path == NULL )
+        {
+            path = argv[i];
+        }
+        else
+        {
+            reader_usage(argv[0]);
+            exit(3);
+        }
+    }
+
+    if ( path != NULL )
+    {
+        file = fopen(path, "rb");
+        if ( file == NULL )
+        {
+            fprintf(stderr, "Cannot open the log %s.\n", path);
+            exit(2);
+        }
+    }
+
+    if ( result_log_read_magic(file) != 0 )
+    {
+        fprintf(stderr, "This is no results log.\n");
+        exit(1);
+    }
+
+    result_record_init(&record);
+    mpz_init(square.number);
+    mpz_init(square.c);
+    for ( i = 0; i < 9; i++ )
+    {
+        mpz_init(square.s[i]);
+    }
+
+    if ( format == READER_CSV )
+    {
+        printf("type,squares,generator,sign,counter,pattern,n5,a,b,s1,s2,s3,s4,s5,s6,s7,s8,s9\n");
+    }
+
+    while ( (read = result_record_read(file, &record)) > 0 )
+    {
+        reader_rebuild(&square, &record);
+        if ( reader_write(format, &record, &square) != 0 )
+        {
+            fprintf(stderr, "Cannot write a result file.\n");
+            status = 2;
+            break;
+        }
+    }
+
+    if ( read < 0 )
+    {
+        // ERROR: The log ends within a record or holds garbage.
+        fprintf(stderr, "The log is broken.\n");
+        status = 1;
+    }
+
+    for ( i = 0; i < 9; i++ )
+    {
+        mpz_clear(square.s[i]);
+    }
+    mpz_clear(square.c);
+    mpz_clear(square.number);
+    result_record_clear(&record);
+
+    if ( file != stdin )
+    {
+        fclose(file);
+    }
+
+    return status;
+}
@@ -0,0 +1,43 @@
+#include <string.h>
+#include <pthread.h>
+
+#include "primes.h"
+
+
+uint32_t primesTable[PRIMES_COUNT];
+
+static pthread_once_t primesOnce = PTHREAD_ONCE_INIT;
+
+
+/** \brief Sieves the primes below PRIMES_LIMIT into the prime table.
+ *
+ * \return void
+ */
+static void primes_sieve(void)
+{
+    static unsigned char composite[PRIMES_LIMIT];
+    uint32_t i, j;
+    int length = 0;
+
+    memset(composite, 0, sizeof composite);
+
+    for ( i = 2; i < PRIMES_LIMIT; i++ )
+    {
+        if ( composite[i] )
+        {
+            continue;
+        }
+
+        primesTable[length++] = i;
+        for ( j = i * i; j < PRIMES_LIMIT; j += i )
+        {
+            composite[j] = 1;
+        }
+    }
+}
+
+
+void primes_init(void)
+{
+    pthread_once(&primesOnce, primes_sieve);
+}
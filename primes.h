@@ -0,0 +1,31 @@
+#ifndef PRIMES_H_INCLUDED
+#define PRIMES_H_INCLUDED
+
+#include <stdint.h>
+
+
+/** \brief The upper bound (exclusive) of the precomputed prime table. */
+#define PRIMES_LIMIT 65536
+
+/** \brief The number of primes below PRIMES_LIMIT. */
+#define PRIMES_COUNT 6542
+
+
+/** \brief The table of all primes below PRIMES_LIMIT in ascending order.
+ *
+ * The table would only be valid after calling primes_init().
+ */
+extern uint32_t primesTable[PRIMES_COUNT];
+
+
+/** \brief Computes the prime table via the sieve of Eratosthenes.
+ *
+ * The function can be called any number of times from any thread. The table
+ * would be computed only once.
+ *
+ * \return void
+ */
+void primes_init(void);
+
+
+#endif // PRIMES_H_INCLUDED
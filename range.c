@@ -0,0 +1,526 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <signal.h>
+#include <time.h>
+#include <pthread.h>
+
+#include "range.h"
+#include "search.h"
+#include "work_pool.h"
+#include "sieve.h"
+#include "stats.h"
+
+
+/** \brief The data shared by all workers of a range search. */
+typedef struct range_context
+{
+    /** \brief The options. */
+    range_options_t * options;
+    /** \brief The pool distributing the generator offsets. */
+    work_pool_t pool;
+    /** \brief The number of generators searched so far. */
+    uint64_t generators;
+    /** \brief The number of results found so far. */
+    uint64_t results;
+    /** \brief The counters of the checkpoint resumed from, zero otherwise. */
+    search_stats_t resumed;
+    /** \brief The counters of the checkpoint resumed from and of the finished workers. */
+    search_stats_t stats;
+    /** \brief Protects the counters of the finished workers and workerStats. */
+    pthread_mutex_t statsMutex;
+    /** \brief The counters of every worker as of its last chunk or pause. */
+    search_stats_t * workerStats;
+    /** \brief The report of the counters. */
+    stats_report_t report;
+    /** \brief Whether the first generator is positive and fits into 64 bits. */
+    int fromFits;
+    /** \brief The first generator if it fits into 64 bits. */
+    uint64_t fromValue;
+    /** \brief Whether the workers have to pause before their next chunk. */
+    int pausing;
+    /** \brief Whether the workers have to stop after the pause. */
+    int stopping;
+    /** \brief The number of workers paused. */
+    int paused;
+    /** \brief The number of workers finished. */
+    int finished;
+    /** \brief Protects pausing, stopping, paused and finished. */
+    pthread_mutex_t pauseMutex;
+    /** \brief Signals the paused workers to go on. */
+    pthread_cond_t resumeCond;
+    /** \brief Signals that a worker has paused or finished. */
+    pthread_cond_t idleCond;
+} range_context_t;
+
+
+/** \brief The data of one worker. */
+typedef struct range_worker
+{
+    /** \brief The shared context. */
+    range_context_t * context;
+    /** \brief The index of the worker. */
+    int index;
+    /** \brief The thread running the worker. */
+    pthread_t thread;
+} range_worker_t;
+
+
+/** \brief Set by SIGINT and SIGTERM to stop a range search with checkpoints. */
+static volatile sig_atomic_t range_stop_signal = 0;
+
+
+/** \brief Handles SIGINT and SIGTERM during a range search with checkpoints.
+ *
+ * \param signal int The signal.
+ * \return void
+ */
+static void range_signal(int signal)
+{
+    (void) signal;
+    range_stop_signal = 1;
+}
+
+
+/** \brief Reports the counters of every worker and their total.
+ *
+ * \param context range_context_t* The context.
+ * \return void
+ */
+static void range_report(range_context_t * context)
+{
+    search_stats_t total;
+    char label[32];
+    int i;
+
+    search_stats_init(&total);
+
+    pthread_mutex_lock(&context->statsMutex);
+    stats_report_begin(&context->report);
+    for ( i = 0; i < context->options->threads; i++ )
+    {
+        snprintf(label, sizeof label, "worker %d", i);
+        search_stats_print(&context->report, label, &context->workerStats[i]);
+        search_stats_add(&total, &context->workerStats[i]);
+    }
+    search_stats_print(&context->report, "total", &total);
+    fflush(context->report.stream);
+    pthread_mutex_unlock(&context->statsMutex);
+}
+
+
+/** \brief Pauses the calling worker as long as a checkpoint is written.
+ *
+ * Workers only pause between two chunks, after their results have been
+ * flushed to the log. So the log holds all results of the generators taken
+ * from the pool and none of the others.
+ *
+ * \param context range_context_t* The context.
+ * \param worker int The index of the worker.
+ * \param state search_state_t* The search state of the worker.
+ * \return int 1 if the worker has to stop, 0 to go on.
+ */
+static int range_worker_pause(range_context_t * context, int worker, search_state_t * state)
+{
+    int stop;
+
+    if ( __atomic_load_n(&context->pausing, __ATOMIC_ACQUIRE) == 0 )
+    {
+        return 0;
+    }
+
+    search_state_flush(state);
+
+    // The counters are written to the checkpoint as well.
+    pthread_mutex_lock(&context->statsMutex);
+    context->workerStats[worker] = state->stats;
+    pthread_mutex_unlock(&context->statsMutex);
+
+    pthread_mutex_lock(&context->pauseMutex);
+    context->paused++;
+    pthread_cond_signal(&context->idleCond);
+    while ( context->pausing )
+    {
+        pthread_cond_wait(&context->resumeCond, &context->pauseMutex);
+    }
+    context->paused--;
+    stop = context->stopping;
+    pthread_mutex_unlock(&context->pauseMutex);
+
+    return stop;
+}
+
+
+/** \brief Runs one worker of a range search.
+ *
+ * \param argument void* The worker, see range_worker_t.
+ * \return void* Always NULL.
+ */
+static void * range_worker_run(void * argument)
+{
+    range_worker_t * worker = argument;
+    range_context_t * context = worker->context;
+    range_options_t * options = context->options;
+    search_state_t state;
+    sieve_t sieve;
+    mpz_t generator;
+    uint64_t begin, end, offset;
+    uint64_t results, before;
+    uint64_t primes[UINT64_FACTOR_MAX];
+    int exponents[UINT64_FACTOR_MAX];
+    uint64_t ticks;
+    int plusMinus, sieved, length;
+
+    search_state_init(&state, &options->search);
+    sieve_init(&sieve);
+    mpz_init(generator);
+
+    while ( range_worker_pause(context, worker->index, &state) == 0
+            && work_pool_next(&context->pool, worker->index, &begin, &end) )
+    {
+        for ( plusMinus = 1; plusMinus >= -1; plusMinus -= 2 )
+        {
+            if ( (options->signs & (plusMinus > 0 ? 1 : 2)) == 0 )
+            {
+                continue;
+            }
+
+            // Factor the whole chunk at once if the numbers allow it.
+            sieved = 0;
+            if ( options->sieve && context->fromFits && context->fromValue <= UINT64_MAX - end )
+            {
+                ticks = stats_ticks();
+                sieved = sieve_run(&sieve, context->fromValue + begin, end - begin, plusMinus);
+                state.stats.ticks[STATS_STAGE_FACTOR] += stats_ticks() - ticks;
+            }
+
+            for ( offset = begin; offset < end; offset++ )
+            {
+                // generator = from + offset
+                mpz_add_ui(generator, options->from, offset);
+
+                if ( sieved )
+                {
+                    length = sieve_get_native(&sieve, offset - begin, primes, exponents);
+                    results = search_generator_native(&state, generator, plusMinus, primes, exponents, length);
+                }
+                else
+                {
+                    results = search_generator(&state, generator, plusMinus);
+                }
+
+                __atomic_add_fetch(&context->results, results, __ATOMIC_RELAXED);
+                before = __atomic_fetch_add(&context->generators, 1, __ATOMIC_RELAXED);
+
+                if ( options->progress > 0 && (before + 1) % options->progress == 0 )
+                {
+                    fprintf(stderr, "progress ");
+                    mpz_out_str(stderr, 10, generator);
+                    fprintf(stderr, "%s %llu generators %llu results\n",
+                            plusMinus > 0 ? "+" : "-",
+                            (unsigned long long) (before + 1),
+                            (unsigned long long) __atomic_load_n(&context->results, __ATOMIC_RELAXED));
+                }
+            }
+        }
+
+        if ( options->stats != NULL )
+        {
+            pthread_mutex_lock(&context->statsMutex);
+            context->workerStats[worker->index] = state.stats;
+            pthread_mutex_unlock(&context->statsMutex);
+
+            if ( stats_report_due(&context->report) )
+            {
+                range_report(context);
+            }
+        }
+    }
+
+    pthread_mutex_lock(&context->statsMutex);
+    search_stats_add(&context->stats, &state.stats);
+    context->workerStats[worker->index] = state.stats;
+    pthread_mutex_unlock(&context->statsMutex);
+
+    mpz_clear(generator);
+    sieve_clear(&sieve);
+    search_state_clear(&state);
+
+    pthread_mutex_lock(&context->pauseMutex);
+    context->finished++;
+    pthread_cond_signal(&context->idleCond);
+    pthread_mutex_unlock(&context->pauseMutex);
+
+    return NULL;
+}
+
+
+/** \brief Writes the checkpoint of a range search.
+ *
+ * No worker must be searching meanwhile.
+ *
+ * \param context range_context_t* The context.
+ * \return void
+ */
+static void range_write_checkpoint(range_context_t * context)
+{
+    range_options_t * options = context->options;
+    checkpoint_t checkpoint;
+    int i;
+
+    checkpoint_init(&checkpoint);
+    mpz_set(checkpoint.from, options->from);
+    mpz_set(checkpoint.to, options->to);
+    checkpoint.signs = options->signs;
+    checkpoint_set_options(&checkpoint, &options->search);
+    checkpoint.generators = context->generators;
+    checkpoint.results = context->results;
+
+    // A finished worker has its final counters in workerStats as well.
+    checkpoint.stats = context->resumed;
+    pthread_mutex_lock(&context->statsMutex);
+    for ( i = 0; i < options->threads; i++ )
+    {
+        search_stats_add(&checkpoint.stats, &context->workerStats[i]);
+    }
+    pthread_mutex_unlock(&context->statsMutex);
+    checkpoint.logSize = options->search.log != NULL ? result_log_size(options->search.log) : 0;
+    checkpoint.logPath = options->logPath != NULL ? strdup(options->logPath) : NULL;
+    checkpoint_resize(&checkpoint, context->pool.length);
+    checkpoint.length = work_pool_pending(&context->pool, checkpoint.begins, checkpoint.ends);
+
+    if ( checkpoint_write(&checkpoint, options->checkpoint) != 0 )
+    {
+        // ERROR: Go on searching, the previous checkpoint is still valid.
+        fprintf(stderr, "Cannot write the checkpoint %s.\n", options->checkpoint);
+    }
+
+    checkpoint_clear(&checkpoint);
+}
+
+
+/** \brief Writes a checkpoint every checkpointInterval seconds until all workers finished.
+ *
+ * \param context range_context_t* The context.
+ * \return int 1 if the workers have been stopped by a signal, 0 otherwise.
+ */
+static int range_checkpoint_loop(range_context_t * context)
+{
+    range_options_t * options = context->options;
+    struct timespec deadline;
+    time_t last = time(NULL);
+    int stop = 0;
+
+    pthread_mutex_lock(&context->pauseMutex);
+    while ( context->finished < options->threads && stop == 0 )
+    {
+        // Wake up every second to notice the signals.
+        clock_gettime(CLOCK_REALTIME, &deadline);
+        deadline.tv_sec += 1;
+        pthread_cond_timedwait(&context->idleCond, &context->pauseMutex, &deadline);
+
+        stop = range_stop_signal;
+        if ( context->finished == options->threads
+                || (stop == 0 && (unsigned long) (time(NULL) - last) < options->checkpointInterval) )
+        {
+            continue;
+        }
+
+        // Wait for all workers to finish their chunks.
+        __atomic_store_n(&context->pausing, 1, __ATOMIC_RELEASE);
+        while ( context->paused + context->finished < options->threads )
+        {
+            pthread_cond_wait(&context->idleCond, &context->pauseMutex);
+        }
+
+        range_write_checkpoint(context);
+        last = time(NULL);
+
+        context->stopping = stop;
+        __atomic_store_n(&context->pausing, 0, __ATOMIC_RELEASE);
+        pthread_cond_broadcast(&context->resumeCond);
+    }
+    pthread_mutex_unlock(&context->pauseMutex);
+
+    return stop;
+}
+
+
+void range_options_init(range_options_t * options)
+{
+    long processors = sysconf(_SC_NPROCESSORS_ONLN);
+
+    mpz_init(options->from);
+    mpz_init(options->to);
+    options->signs = 3;
+    options->progress = 0;
+    options->threads = processors > 0 ? (int) processors : 1;
+    options->chunk = 1024;
+    options->sieve = 1;
+    options->checkpoint = NULL;
+    options->checkpointInterval = 300;
+    options->logPath = NULL;
+    options->resume = NULL;
+    options->stats = NULL;
+    options->statsInterval = 0;
+    search_options_init(&options->search);
+}
+
+
+void range_options_clear(range_options_t * options)
+{
+    mpz_clear(options->from);
+    mpz_clear(options->to);
+}
+
+
+int range_search(range_options_t * options)
+{
+    range_context_t context;
+    range_worker_t * workers;
+    const int moduli[SQUARE_FILTER_STAGES] = SQUARE_FILTER_MODULI;
+    mpz_t count;
+    int stopped = 0;
+    int i;
+
+    // count = to - from + 1
+    mpz_init(count);
+    mpz_sub(count, options->to, options->from);
+    mpz_add_ui(count, count, 1);
+    if ( mpz_sgn(count) < 0 )
+    {
+        mpz_set_ui(count, 0);
+    }
+
+    if ( mpz_sizeinbase(count, 2) > 64 )
+    {
+        // ERROR: The generator offsets have to fit into 64 bits.
+        mpz_clear(count);
+        return 1;
+    }
+
+    if ( options->resume != NULL )
+    {
+        for ( i = 0; i < options->resume->length; i++ )
+        {
+            if ( mpz_cmp_ui(count, options->resume->ends[i]) < 0 )
+            {
+                // ERROR: The pending intervals have to be within the range.
+                mpz_clear(count);
+                return 3;
+            }
+        }
+    }
+
+    context.options = options;
+    context.generators = options->resume != NULL ? options->resume->generators : 0;
+    context.results = options->resume != NULL ? options->resume->results : 0;
+    search_stats_init(&context.resumed);
+    if ( options->resume != NULL )
+    {
+        context.resumed = options->resume->stats;
+    }
+    context.stats = context.resumed;
+    pthread_mutex_init(&context.statsMutex, NULL);
+    context.workerStats = calloc(options->threads, sizeof(search_stats_t));
+    if ( options->stats != NULL )
+    {
+        stats_report_init(&context.report, options->stats, options->statsInterval);
+    }
+    context.fromFits = mpz_sgn(options->from) > 0 && mpz_sizeinbase(options->from, 2) <= 64;
+    context.fromValue = context.fromFits ? mpz_get_ui(options->from) : 0;
+    context.pausing = 0;
+    context.stopping = 0;
+    context.paused = 0;
+    context.finished = 0;
+    pthread_mutex_init(&context.pauseMutex, NULL);
+    pthread_cond_init(&context.resumeCond, NULL);
+    pthread_cond_init(&context.idleCond, NULL);
+    if ( options->resume != NULL )
+    {
+        work_pool_init_ranges(&context.pool, options->threads, options->resume->begins,
+                              options->resume->ends, options->resume->length, options->chunk);
+    }
+    else
+    {
+        work_pool_init(&context.pool, options->threads, mpz_get_ui(count), options->chunk);
+    }
+    mpz_clear(count);
+
+    if ( options->checkpoint != NULL )
+    {
+        range_stop_signal = 0;
+        signal(SIGINT, range_signal);
+        signal(SIGTERM, range_signal);
+    }
+
+    workers = malloc(options->threads * sizeof(range_worker_t));
+    for ( i = 0; i < options->threads; i++ )
+    {
+        workers[i].context = &context;
+        workers[i].index = i;
+        pthread_create(&workers[i].thread, NULL, range_worker_run, &workers[i]);
+    }
+
+    if ( options->checkpoint != NULL )
+    {
+        stopped = range_checkpoint_loop(&context);
+    }
+
+    for ( i = 0; i < options->threads; i++ )
+    {
+        pthread_join(workers[i].thread, NULL);
+    }
+
+    if ( options->checkpoint != NULL )
+    {
+        signal(SIGINT, SIG_DFL);
+        signal(SIGTERM, SIG_DFL);
+        if ( stopped == 0 )
+        {
+            // The last checkpoint has no pending generators left.
+            range_write_checkpoint(&context);
+        }
+    }
+
+    fflush(stdout);
+    fprintf(stderr, "%s %llu generators %llu results %llu pruned\n",
+            stopped ? "stopped" : "done",
+            (unsigned long long) context.generators,
+            (unsigned long long) context.results,
+            (unsigned long long) context.stats.pruned);
+    fprintf(stderr, "squares %llu tested", (unsigned long long) context.stats.squareTests);
+    for ( i = 0; i < SQUARE_FILTER_STAGES; i++ )
+    {
+        fprintf(stderr, ", passed mod %d %llu", moduli[i], (unsigned long long) context.stats.squarePassed[i]);
+    }
+    fprintf(stderr, "\n");
+    fprintf(stderr, "pairs %llu tested, %llu pruned\n",
+            (unsigned long long) context.stats.pairs,
+            (unsigned long long) context.stats.prunedPairs);
+    if ( context.stats.blocked > 0 )
+    {
+        fprintf(stderr, "blocked %llu generators\n", (unsigned long long) context.stats.blocked);
+    }
+    if ( options->stats != NULL )
+    {
+        range_report(&context);
+    }
+    free(context.workerStats);
+    if ( context.options->search.primitive )
+    {
+        fprintf(stderr, "imprimitive %llu generators, %llu pairs\n",
+                (unsigned long long) context.stats.imprimitive,
+                (unsigned long long) context.stats.imprimitivePairs);
+    }
+
+    free(workers);
+    pthread_cond_destroy(&context.idleCond);
+    pthread_cond_destroy(&context.resumeCond);
+    pthread_mutex_destroy(&context.pauseMutex);
+    pthread_mutex_destroy(&context.statsMutex);
+    work_pool_clear(&context.pool);
+
+    return stopped ? 2 : 0;
+}
@@ -0,0 +1,85 @@
+#ifndef RANGE_H_INCLUDED
+#define RANGE_H_INCLUDED
+
+#include <stdio.h>
+#include <stdint.h>
+#include <gmp.h>
+
+#include "search.h"
+#include "checkpoint.h"
+
+
+/** \brief The options of a range search. */
+typedef struct range_options
+{
+    /** \brief The first generator of the range. */
+    mpz_t from;
+    /** \brief The last generator of the range (inclusive). */
+    mpz_t to;
+    /** \brief Bit 1 to apply 6g + 1, bit 2 to apply 6g - 1. */
+    int signs;
+    /** \brief Print the progress every that many generators, 0 for never. */
+    unsigned long progress;
+    /** \brief The number of worker threads. */
+    int threads;
+    /** \brief The number of generators a worker takes at once. */
+    uint64_t chunk;
+    /** \brief Whether the chunks are factored by a segmented sieve. */
+    int sieve;
+    /** \brief The checkpoint file, NULL for no checkpoints. */
+    const char * checkpoint;
+    /** \brief Write a checkpoint every that many seconds. */
+    unsigned long checkpointInterval;
+    /** \brief The absolute path of the log kept by the checkpoints, NULL if there is no log. */
+    const char * logPath;
+    /** \brief The checkpoint to resume from, NULL to search the whole range. */
+    checkpoint_t * resume;
+    /** \brief The stream receiving the counters of every stage, NULL for none. */
+    FILE * stats;
+    /** \brief Report the counters every that many seconds, 0 for the final report only. */
+    unsigned long statsInterval;
+    /** \brief The options passed to the search of every generator. */
+    search_options_t search;
+} range_options_t;
+
+
+/** \brief Initializes the given options with their default values.
+ *
+ * \param options range_options_t* The options.
+ * \return void
+ */
+void range_options_init(range_options_t * options);
+
+
+/** \brief Clears the given options.
+ *
+ * \param options range_options_t* The options.
+ * \return void
+ */
+void range_options_clear(range_options_t * options);
+
+
+/** \brief Searches all generators of the range given by the options.
+ *
+ * The generators are distributed to the worker threads via a work stealing
+ * pool. Every worker has its own search state. The results are written by the
+ * workers as soon as they are found.
+ *
+ * With a checkpoint file, the workers are paused between two chunks every
+ * checkpointInterval seconds and the generators not yet searched are written
+ * to the checkpoint, together with the size and the path of the log. SIGINT and SIGTERM
+ * write a last checkpoint and stop the search.
+ *
+ * With a stats stream, the workers publish their counters after every chunk
+ * and the counters of every worker and their total are reported every
+ * statsInterval seconds and at the end.
+ *
+ * \param options range_options_t* The options.
+ * \return int 0 on success, 1 if the range is too big, 2 if the search has
+ *         been stopped by a signal, 3 if the checkpoint to resume from does
+ *         not fit the range.
+ */
+int range_search(range_options_t * options);
+
+
+#endif // RANGE_H_INCLUDED
@@ -0,0 +1,333 @@
+#include <string.h>
+#include <errno.h>
+#include <unistd.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+
+#include "result_log.h"
+
+
+const char * result_type_name(int type)
+{
+    static const char * names[] = {"ps", "fh", "sh1", "sh2"};
+
+    if ( type < 0 || type > RESULT_TYPE_SH2 )
+    {
+        return "?";
+    }
+
+    return names[type];
+}
+
+
+void result_record_init(result_record_t * record)
+{
+    record->type = RESULT_TYPE_PS;
+    record->squares = 0;
+    record->mask = 0;
+    record->plusMinus = 1;
+    record->counter = 0;
+    mpz_init(record->generator);
+    mpz_init(record->a);
+    mpz_init(record->b);
+}
+
+
+void result_record_clear(result_record_t * record)
+{
+    mpz_clear(record->generator);
+    mpz_clear(record->a);
+    mpz_clear(record->b);
+}
+
+
+/** \brief Reads a number of a record.
+ *
+ * \param file FILE* The log.
+ * \param number mpz_t Receives the number.
+ * \return int 1 on success, 0 if the log ended.
+ */
+static int result_record_read_number(FILE * file, mpz_t number)
+{
+    unsigned char header[2];
+    unsigned char * bytes;
+    size_t length;
+
+    if ( fread(header, 1, 2, file) != 2 )
+    {
+        return 0;
+    }
+
+    length = header[0] | ((size_t) header[1] << 8);
+    bytes = malloc(length > 0 ? length : 1);
+    if ( fread(bytes, 1, length, file) != length )
+    {
+        free(bytes);
+        return 0;
+    }
+
+    mpz_import(number, length, -1, 1, 0, 0, bytes);
+    free(bytes);
+
+    return 1;
+}
+
+
+int result_record_read(FILE * file, result_record_t * record)
+{
+    unsigned char header[8];
+    size_t length;
+
+    length = fread(header, 1, sizeof header, file);
+    if ( length == 0 )
+    {
+        return 0;
+    }
+
+    if ( length != sizeof header || header[0] > RESULT_TYPE_SH2 )
+    {
+        return -1;
+    }
+
+    record->type = header[0];
+    record->squares = header[1];
+    record->mask = header[2] & (RESULT_FLAG_S2 | RESULT_FLAG_S4 | RESULT_FLAG_S6 | RESULT_FLAG_S8);
+    record->plusMinus = (header[2] & RESULT_FLAG_PLUS) ? 1 : -1;
+    record->counter = header[4]
+                      | ((unsigned long) header[5] << 8)
+                      | ((unsigned long) header[6] << 16)
+                      | ((unsigned long) header[7] << 24);
+
+    if ( !result_record_read_number(file, record->generator)
+            || !result_record_read_number(file, record->a)
+            || !result_record_read_number(file, record->b) )
+    {
+        return -1;
+    }
+
+    if ( header[2] & RESULT_FLAG_NEGATIVE )
+    {
+        mpz_neg(record->generator, record->generator);
+    }
+
+    return 1;
+}
+
+
+int result_log_read_magic(FILE * file)
+{
+    char magic[RESULT_LOG_MAGIC_LENGTH];
+
+    if ( fread(magic, 1, RESULT_LOG_MAGIC_LENGTH, file) != RESULT_LOG_MAGIC_LENGTH
+            || memcmp(magic, RESULT_LOG_MAGIC, RESULT_LOG_MAGIC_LENGTH) != 0 )
+    {
+        return 1;
+    }
+
+    return 0;
+}
+
+
+int result_log_open(result_log_t * log, const char * path)
+{
+    FILE * file;
+    int broken;
+
+    log->file = fopen(path, "ab");
+    if ( log->file == NULL )
+    {
+        return 1;
+    }
+
+    fseek(log->file, 0, SEEK_END);
+    if ( ftell(log->file) == 0 )
+    {
+        fwrite(RESULT_LOG_MAGIC, 1, RESULT_LOG_MAGIC_LENGTH, log->file);
+        fflush(log->file);
+    }
+    else
+    {
+        // Only append to a log, never to any other file.
+        file = fopen(path, "rb");
+        broken = file == NULL || result_log_read_magic(file) != 0;
+        if ( file != NULL )
+        {
+            fclose(file);
+        }
+
+        if ( broken )
+        {
+            fclose(log->file);
+            return 1;
+        }
+    }
+
+    pthread_mutex_init(&log->mutex, NULL);
+
+    return 0;
+}
+
+
+void result_log_close(result_log_t * log)
+{
+    fclose(log->file);
+    pthread_mutex_destroy(&log->mutex);
+}
+
+
+uint64_t result_log_size(result_log_t * log)
+{
+    off_t size;
+
+    pthread_mutex_lock(&log->mutex);
+    fflush(log->file);
+    fseeko(log->file, 0, SEEK_END);
+    size = ftello(log->file);
+    pthread_mutex_unlock(&log->mutex);
+
+    return size > 0 ? (uint64_t) size : 0;
+}
+
+
+int result_log_truncate(const char * path, uint64_t size)
+{
+    struct stat info;
+
+    // A log always keeps its magic.
+    if ( size < RESULT_LOG_MAGIC_LENGTH )
+    {
+        size = 0;
+    }
+
+    if ( stat(path, &info) != 0 )
+    {
+        // An empty log does not need to exist.
+        if ( errno == ENOENT )
+        {
+            return size > 0 ? 2 : 0;
+        }
+        return 1;
+    }
+
+    // Never let truncate() pad a log that has lost some of its records.
+    if ( (uint64_t) info.st_size < size )
+    {
+        return 2;
+    }
+
+    return truncate(path, (off_t) size) != 0;
+}
+
+
+void result_buffer_init(result_buffer_t * buffer, result_log_t * log)
+{
+    buffer->log = log;
+    buffer->data = NULL;
+    buffer->length = 0;
+    buffer->capacity = 0;
+}
+
+
+void result_buffer_clear(result_buffer_t * buffer)
+{
+    result_buffer_flush(buffer);
+    free(buffer->data);
+    result_buffer_init(buffer, NULL);
+}
+
+
+/** \brief Makes sure that the given buffer can take that many more bytes.
+ *
+ * \param buffer result_buffer_t* The buffer.
+ * \param length size_t The number of bytes.
+ * \return void
+ */
+static void result_buffer_reserve(result_buffer_t * buffer, size_t length)
+{
+    if ( buffer->length + length <= buffer->capacity )
+    {
+        return;
+    }
+
+    while ( buffer->length + length > buffer->capacity )
+    {
+        buffer->capacity = buffer->capacity > 0 ? 2 * buffer->capacity : 2 * RESULT_BUFFER_FLUSH;
+    }
+    buffer->data = realloc(buffer->data, buffer->capacity);
+}
+
+
+/** \brief Appends the absolute value of a number to the given buffer.
+ *
+ * \param buffer result_buffer_t* The buffer.
+ * \param number mpz_t The number.
+ * \return void
+ */
+static void result_buffer_add_number(result_buffer_t * buffer, mpz_t number)
+{
+    unsigned char * header;
+    size_t length = 0;
+
+    result_buffer_reserve(buffer, 2 + (mpz_sizeinbase(number, 2) + 7) / 8);
+
+    header = buffer->data + buffer->length;
+    mpz_export(header + 2, &length, -1, 1, 0, 0, number);
+    header[0] = (unsigned char) length;
+    header[1] = (unsigned char) (length >> 8);
+
+    buffer->length += 2 + length;
+}
+
+
+void result_buffer_add(result_buffer_t * buffer, result_record_t * record)
+{
+    unsigned char * header;
+    int flags = record->mask;
+
+    if ( record->plusMinus > 0 )
+    {
+        flags |= RESULT_FLAG_PLUS;
+    }
+    if ( mpz_sgn(record->generator) < 0 )
+    {
+        flags |= RESULT_FLAG_NEGATIVE;
+    }
+
+    result_buffer_reserve(buffer, 8);
+    header = buffer->data + buffer->length;
+    header[0] = (unsigned char) record->type;
+    header[1] = (unsigned char) record->squares;
+    header[2] = (unsigned char) flags;
+    header[3] = 0;
+    header[4] = (unsigned char) record->counter;
+    header[5] = (unsigned char) (record->counter >> 8);
+    header[6] = (unsigned char) (record->counter >> 16);
+    header[7] = (unsigned char) (record->counter >> 24);
+    buffer->length += 8;
+
+    result_buffer_add_number(buffer, record->generator);
+    result_buffer_add_number(buffer, record->a);
+    result_buffer_add_number(buffer, record->b);
+
+    if ( buffer->length >= RESULT_BUFFER_FLUSH )
+    {
+        result_buffer_flush(buffer);
+    }
+}
+
+
+void result_buffer_flush(result_buffer_t * buffer)
+{
+    if ( buffer->length == 0 || buffer->log == NULL )
+    {
+        buffer->length = 0;
+        return;
+    }
+
+    pthread_mutex_lock(&buffer->log->mutex);
+    fwrite(buffer->data, 1, buffer->length, buffer->log->file);
+    fflush(buffer->log->file);
+    pthread_mutex_unlock(&buffer->log->mutex);
+
+    buffer->length = 0;
+}
@@ -0,0 +1,220 @@
+#ifndef RESULT_LOG_H_INCLUDED
+#define RESULT_LOG_H_INCLUDED
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <pthread.h>
+#include <gmp.h>
+
+
+/** \brief A buffer is written to the log as soon as it holds that many bytes. */
+#define RESULT_BUFFER_FLUSH 65536
+
+/** \brief The first bytes of every log file. */
+#define RESULT_LOG_MAGIC "PMSoSR01"
+
+/** \brief The length of RESULT_LOG_MAGIC. */
+#define RESULT_LOG_MAGIC_LENGTH 8
+
+/** \brief The types of results. */
+#define RESULT_TYPE_PS 0
+#define RESULT_TYPE_FH 1
+#define RESULT_TYPE_SH1 2
+#define RESULT_TYPE_SH2 3
+
+/** \brief The bits of the flags of a record. */
+#define RESULT_FLAG_S2 1
+#define RESULT_FLAG_S4 2
+#define RESULT_FLAG_S6 4
+#define RESULT_FLAG_S8 8
+#define RESULT_FLAG_PLUS 16
+#define RESULT_FLAG_NEGATIVE 32
+
+
+/** \brief One result, a magic square with at least five perfect square numbers.
+ *
+ * The magic square is fully given by the center c = n5^2 with
+ * n5 = 6 * generator + plusMinus and the distances a < b of the two
+ * arithmetic progressions. In a log, a record is stored as
+ *
+ *     uint8  type       RESULT_TYPE_*
+ *     uint8  squares    the number of perfect square numbers
+ *     uint8  flags      RESULT_FLAG_*
+ *     uint8  reserved   0
+ *     uint32 counter    the number of the result within its generator
+ *     number generator  the absolute value, see RESULT_FLAG_NEGATIVE
+ *     number a
+ *     number b
+ *
+ * where a number is a uint16 n followed by n bytes, least significant first.
+ * All integers are little endian.
+ */
+typedef struct result_record
+{
+    /** \brief The type, RESULT_TYPE_*. */
+    int type;
+    /** \brief The number of perfect square numbers. */
+    int squares;
+    /** \brief The flags RESULT_FLAG_S2 to RESULT_FLAG_S8 of the perfect square numbers s2 to s8. */
+    int mask;
+    /** \brief The generator function applied, either 1 (6g + 1) or -1 (6g - 1). */
+    int plusMinus;
+    /** \brief The number of the result within its generator, starting at 1. */
+    unsigned long counter;
+    /** \brief The generator number g. */
+    mpz_t generator;
+    /** \brief The smaller distance a. */
+    mpz_t a;
+    /** \brief The bigger distance b. */
+    mpz_t b;
+} result_record_t;
+
+
+/** \brief An append-only log of results shared by all threads.
+ *
+ * The threads collect their records in a result_buffer_t each and append
+ * whole buffers to the log under the mutex, so the records of different
+ * threads are never mixed.
+ */
+typedef struct result_log
+{
+    /** \brief The log file. */
+    FILE * file;
+    /** \brief Protects the log file. */
+    pthread_mutex_t mutex;
+} result_log_t;
+
+
+/** \brief The records of one thread not yet written to the log. */
+typedef struct result_buffer
+{
+    /** \brief The log, NULL to discard the records. */
+    result_log_t * log;
+    /** \brief The encoded records. */
+    unsigned char * data;
+    /** \brief The number of bytes buffered. */
+    size_t length;
+    /** \brief The number of bytes allocated. */
+    size_t capacity;
+} result_buffer_t;
+
+
+/** \brief Gets the name of a type of result.
+ *
+ * \param type int The type, RESULT_TYPE_*.
+ * \return const char* The name, e.g. "ps".
+ */
+const char * result_type_name(int type);
+
+
+/** \brief Initializes the given record.
+ *
+ * \param record result_record_t* The record.
+ * \return void
+ */
+void result_record_init(result_record_t * record);
+
+
+/** \brief Clears the given record.
+ *
+ * \param record result_record_t* The record.
+ * \return void
+ */
+void result_record_clear(result_record_t * record);
+
+
+/** \brief Reads the next record from a log.
+ *
+ * \param file FILE* The log, positioned behind the magic or a record.
+ * \param record result_record_t* Receives the record.
+ * \return int 1 if a record has been read, 0 at the end of the log, -1 if the log is broken.
+ */
+int result_record_read(FILE * file, result_record_t * record);
+
+
+/** \brief Reads and checks the magic at the start of a log.
+ *
+ * \param file FILE* The log.
+ * \return int 0 if the magic is fine, 1 otherwise.
+ */
+int result_log_read_magic(FILE * file);
+
+
+/** \brief Opens the given log for appending.
+ *
+ * The magic is written if the log is empty.
+ *
+ * \param log result_log_t* The log.
+ * \param path const char* The path of the log file.
+ * \return int 0 on success, 1 if the file could not be opened or is no log.
+ */
+int result_log_open(result_log_t * log, const char * path);
+
+
+/** \brief Closes the given log.
+ *
+ * All buffers have to be flushed before.
+ *
+ * \param log result_log_t* The log.
+ * \return void
+ */
+void result_log_close(result_log_t * log);
+
+
+/** \brief Gets the size of the given log.
+ *
+ * \param log result_log_t* The log.
+ * \return uint64_t The number of bytes written to the log.
+ */
+uint64_t result_log_size(result_log_t * log);
+
+
+/** \brief Cuts a log back to the given size, dropping all records behind.
+ *
+ * A log shorter than the given size is left as it is.
+ *
+ * \param path const char* The path of the log file.
+ * \param size uint64_t The size, e.g. as stored by a checkpoint.
+ * \return int 0 on success, 1 if the log could not be cut, 2 if it is shorter than size.
+ */
+int result_log_truncate(const char * path, uint64_t size);
+
+
+/** \brief Initializes the given buffer.
+ *
+ * \param buffer result_buffer_t* The buffer.
+ * \param log result_log_t* The log the buffer is written to.
+ * \return void
+ */
+void result_buffer_init(result_buffer_t * buffer, result_log_t * log);
+
+
+/** \brief Flushes the given buffer and releases all memory used by it.
+ *
+ * \param buffer result_buffer_t* The buffer.
+ * \return void
+ */
+void result_buffer_clear(result_buffer_t * buffer);
+
+
+/** \brief Appends a record to the given buffer.
+ *
+ * The buffer is written to the log if it is full.
+ *
+ * \param buffer result_buffer_t* The buffer.
+ * \param record result_record_t* The record.
+ * \return void
+ */
+void result_buffer_add(result_buffer_t * buffer, result_record_t * record);
+
+
+/** \brief Writes the buffered records to the log.
+ *
+ * \param buffer result_buffer_t* The buffer.
+ * \return void
+ */
+void result_buffer_flush(result_buffer_t * buffer);
+
+
+#endif // RESULT_LOG_H_INCLUDED
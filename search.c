@@ -0,0 +1,1940 @@
+#include <limits.h>
+#include <string.h>
+
+#include "search.h"
+#include "uint128_gaussian.h"
+
+/** \brief The bits of the numbers s2, s4, s6 and s8 in the masks of search_screen().
+ *
+ * With a = AP1->d and b = AP2->d these are the numbers c + a + b, c - a + b,
+ * c + a - b and c - a - b of square_filter_batch().
+ */
+#define SEARCH_S2 SQUARE_FILTER_SUM
+#define SEARCH_S4 SQUARE_FILTER_DIFFERENCE_A
+#define SEARCH_S6 SQUARE_FILTER_DIFFERENCE_B
+#define SEARCH_S8 SQUARE_FILTER_DIFFERENCE
+
+
+/** \brief Writes a found magic square to its own result file.
+ *
+ * \param state search_state_t* The state.
+ * \param key const char* The key of the result.
+ * \param pattern const char* The pattern of the perfect square numbers.
+ * \return void
+ */
+static void search_write_result_file(search_state_t * state, const char * key, const char * pattern)
+{
+    FILE *fp;
+    char filename[strlen(key) + 8];
+
+    snprintf(filename, sizeof filename, "%s.result", key);
+
+    fp = fopen(filename, "w");
+    mpz_out_str(fp, 10, state->number);
+    fprintf(fp, "\n");
+    mpz_out_str(fp, 10, state->numberSquared);
+    fprintf(fp, "\n");
+    fprintf(fp, "%s\n", pattern);
+
+    // The magic square
+    mpz_out_str(fp, 10, state->x1);
+    fprintf(fp, " ");
+    mpz_out_str(fp, 10, state->x2);
+    fprintf(fp, " ");
+    mpz_out_str(fp, 10, state->x3);
+    fprintf(fp, " | ");
+    mpz_out_str(fp, 10, state->a1);
+    fprintf(fp, " ");
+    mpz_out_str(fp, 10, state->a2);
+    fprintf(fp, " ");
+    mpz_out_str(fp, 10, state->a3);
+    fprintf(fp, " | ");
+    mpz_out_str(fp, 10, state->a7);
+    fprintf(fp, " ");
+    mpz_out_str(fp, 10, state->a8);
+    fprintf(fp, " ");
+    mpz_out_str(fp, 10, state->a9);
+    fprintf(fp, "\n");
+
+    fclose(fp);
+
+    printf("%s\n", filename);
+}
+
+
+/** \brief Writes a found magic square to the log.
+ *
+ * The record holds the generator, the distances a and b and the pattern,
+ * everything else follows from these.
+ *
+ * \param state search_state_t* The state.
+ * \param key const char* The key of the result.
+ * \param type int The type of the result, RESULT_TYPE_*.
+ * \param nrPerfectSquares int The number of perfect square numbers.
+ * \param mask int The flags RESULT_FLAG_S2 to RESULT_FLAG_S8 of the perfect square numbers.
+ * \return void
+ */
+static void search_write_result_log(search_state_t * state, const char * key, int type, int nrPerfectSquares, int mask)
+{
+    result_record_t * record = &state->record;
+
+    record->type = type;
+    record->squares = nrPerfectSquares;
+    record->mask = mask;
+    record->plusMinus = state->plusMinus;
+    record->counter = (unsigned long) state->result;
+    mpz_set(record->generator, state->input);
+    mpz_set(record->a, state->a);
+    mpz_set(record->b, state->b);
+
+    result_buffer_add(&state->results, record);
+
+    printf("%s\n", key);
+}
+
+
+/** \brief Writes a found magic square to the log or to a result file.
+ *
+ * The magic square is expected in the variables a, b, x1, x2, x3, a1, a2, a3,
+ * a7, a8 and a9 of the given state. The key of a result is
+ * "type,squares,generator{P|M},counter", e.g. "ps,7,141M,1".
+ *
+ * \param state search_state_t* The state.
+ * \param type int The type of the result, RESULT_TYPE_*.
+ * \param nrPerfectSquares int The number of perfect square numbers.
+ * \param s2PerfectSquare int Whether s2 is a perfect square number.
+ * \param s4PerfectSquare int Whether s4 is a perfect square number.
+ * \param s6PerfectSquare int Whether s6 is a perfect square number.
+ * \param s8PerfectSquare int Whether s8 is a perfect square number.
+ * \return void
+ */
+static void search_write_result(search_state_t * state, int type, int nrPerfectSquares, int s2PerfectSquare, int s4PerfectSquare, int s6PerfectSquare, int s8PerfectSquare)
+{
+    // The generator may have any number of digits (plus sign and terminator).
+    size_t digits = mpz_sizeinbase(state->input, 10) + 2;
+    char generator[digits];
+    char key[digits + 48];
+    char pattern[32];
+    uint64_t start = stats_ticks();
+
+    state->result ++;
+    mpz_get_str(generator, 10, state->input);
+
+    snprintf(key, sizeof key, "%s,%d,%s%s,%ld", result_type_name(type), nrPerfectSquares, generator, state->plusMinus > 0 ? "P" : "M", state->result);
+
+    if ( state->options->log == NULL )
+    {
+        snprintf(pattern, sizeof pattern, "1 %d 1 | %d 1 %d | 1 %d 1", s2PerfectSquare, s4PerfectSquare, s6PerfectSquare, s8PerfectSquare);
+        search_write_result_file(state, key, pattern);
+    }
+    else
+    {
+        search_write_result_log(state, key, type, nrPerfectSquares,
+                                (s2PerfectSquare ? RESULT_FLAG_S2 : 0)
+                                | (s4PerfectSquare ? RESULT_FLAG_S4 : 0)
+                                | (s6PerfectSquare ? RESULT_FLAG_S6 : 0)
+                                | (s8PerfectSquare ? RESULT_FLAG_S8 : 0));
+    }
+
+    state->stats.results++;
+    state->stats.ticks[STATS_STAGE_RESULTS] += stats_ticks() - start;
+}
+
+
+/** \brief Checks whether a combination could still be written.
+ *
+ * A combination is written as "ps" if it has at least state->minSquares
+ * perfect square numbers and as "sh1" if d = a + b is the distance of another
+ * arithmetic progression, i.e. if s2 and s8 are perfect square numbers (and
+ * the class is selected).
+ *
+ * \param state search_state_t* The state.
+ * \param squares int The number of perfect square numbers the combination could have at most.
+ * \param distance int Whether s2 and s8 could both be perfect square numbers.
+ * \return int 1 if the combination could be written, 0 otherwise.
+ */
+static inline int search_reachable(search_state_t * state, int squares, int distance)
+{
+    return squares >= state->minSquares || (distance && state->distances);
+}
+
+
+/** \brief Screens the combinations of one AP1 with many AP2 by their residues.
+ *
+ * Writes the masks of the numbers s2, s4, s6 and s8 passing the square
+ * filter to state->masks, indexed by AP2. Every combination of the range is
+ * screened, the combinations skipped afterwards (b = 2a, imprimitive) are
+ * counted as well.
+ *
+ * \param state search_state_t* The state, its counters are updated.
+ * \param lanes const square_filter_lanes_t* The residues of the AP2.
+ * \param residueC uint64_t The center modulo SQUARE_FILTER_MODULUS.
+ * \param residueA uint64_t The distance of AP1 modulo SQUARE_FILTER_MODULUS.
+ * \param from int The index of the first AP2.
+ * \param to int The index after the last AP2.
+ * \return void
+ */
+static inline void search_screen_batch(search_state_t * state, const square_filter_lanes_t * lanes, uint64_t residueC, uint64_t residueA, int from, int to)
+{
+    if ( from >= to )
+    {
+        return;
+    }
+
+    state->stats.squareTests += 4 * (uint64_t) (to - from);
+    square_filter_batch(lanes, residueC, residueA, from, to, state->masks, state->stats.squarePassed);
+}
+
+
+/** \brief Checks the mask of a combination screened by search_screen_batch().
+ *
+ * If the combination could not be written with the numbers passing the
+ * square filter (see search_reachable()), it is dropped without any exact
+ * test.
+ *
+ * \param state search_state_t* The state.
+ * \param mask int The mask of the numbers passing the square filter (SEARCH_S2 to SEARCH_S8).
+ * \return int The mask, 0 if the combination can be dropped.
+ */
+static inline int search_screen(search_state_t * state, int mask)
+{
+    if ( search_reachable(state, 5 + __builtin_popcount(mask), (mask & (SEARCH_S2 | SEARCH_S8)) == (SEARCH_S2 | SEARCH_S8)) == 0 )
+    {
+        return 0;
+    }
+
+    return mask;
+}
+
+
+/** \brief Swaps the bits of s4 and s6 of a mask screened with AP1 and AP2 swapped.
+ *
+ * \param mask int The mask.
+ * \return int The mask of the combination in the right order.
+ */
+static inline int search_screen_swap(int mask)
+{
+    return (mask & (SEARCH_S2 | SEARCH_S8)) | ((mask & SEARCH_S4) ? SEARCH_S6 : 0) | ((mask & SEARCH_S6) ? SEARCH_S4 : 0);
+}
+
+
+/** \brief Makes room for the masks of search_screen_batch() of the given number of AP2.
+ *
+ * \param state search_state_t* The state.
+ * \param length int The number of arithmetic progressions.
+ * \return void
+ */
+static void search_masks_reserve(search_state_t * state, int length)
+{
+    if ( length > state->masksCapacity )
+    {
+        state->masksCapacity = length > 2 * state->masksCapacity ? length : 2 * state->masksCapacity;
+        state->masks = realloc(state->masks, state->masksCapacity);
+    }
+}
+
+
+/** \brief Adds the ticks since the last lap to the given stage and starts the next lap.
+ *
+ * \param state search_state_t* The state.
+ * \param stage int The stage finished, STATS_STAGE_*.
+ * \return void
+ */
+static inline void search_lap(search_state_t * state, int stage)
+{
+    uint64_t now = stats_ticks();
+
+    state->stats.ticks[stage] += now - state->lap;
+    state->lap = now;
+}
+
+
+void search_options_init(search_options_t * options)
+{
+    // A magic square needs at least the two arithmetic progressions a and b.
+    options->minAps = 2;
+    options->log = NULL;
+    options->blockAps = 1 << 18;
+    options->minSquares = 7;
+    options->classes = SEARCH_CLASS_ALL;
+    options->primitive = 0;
+    options->cache = NULL;
+}
+
+
+void search_stats_init(search_stats_t * stats)
+{
+    memset(stats, 0, sizeof(search_stats_t));
+}
+
+
+void search_stats_add(search_stats_t * total, search_stats_t * stats)
+{
+    int i;
+
+    total->generators += stats->generators;
+    total->pruned += stats->pruned;
+    total->progressions += stats->progressions;
+    total->squareTests += stats->squareTests;
+    for ( i = 0; i < SQUARE_FILTER_STAGES; i++ )
+    {
+        total->squarePassed[i] += stats->squarePassed[i];
+    }
+    total->blocked += stats->blocked;
+    total->pairs += stats->pairs;
+    total->prunedPairs += stats->prunedPairs;
+    total->imprimitive += stats->imprimitive;
+    total->imprimitivePairs += stats->imprimitivePairs;
+    total->exactTests += stats->exactTests;
+    total->results += stats->results;
+    total->cached += stats->cached;
+    for ( i = 0; i < STATS_STAGES; i++ )
+    {
+        total->ticks[i] += stats->ticks[i];
+    }
+    for ( i = 0; i < STATS_BUCKETS; i++ )
+    {
+        total->apsHistogram[i] += stats->apsHistogram[i];
+        total->pairsHistogram[i] += stats->pairsHistogram[i];
+    }
+    total->maxAps = stats->maxAps > total->maxAps ? stats->maxAps : total->maxAps;
+    total->maxPairs = stats->maxPairs > total->maxPairs ? stats->maxPairs : total->maxPairs;
+    total->maxTicks = stats->maxTicks > total->maxTicks ? stats->maxTicks : total->maxTicks;
+}
+
+
+void search_stats_print(stats_report_t * report, const char * label, search_stats_t * stats)
+{
+    const char * stages[STATS_STAGES] = STATS_STAGE_NAMES;
+    const int moduli[SQUARE_FILTER_STAGES] = SQUARE_FILTER_MODULI;
+    double ticksPerSecond = stats_report_ticks_per_second(report);
+    FILE * stream = report->stream;
+    int i;
+
+    fprintf(stream, "%s generators %llu pruned %llu imprimitive %llu blocked %llu aps %llu results %llu cached %llu\n", label,
+            (unsigned long long) stats->generators,
+            (unsigned long long) stats->pruned,
+            (unsigned long long) stats->imprimitive,
+            (unsigned long long) stats->blocked,
+            (unsigned long long) stats->progressions,
+            (unsigned long long) stats->results,
+            (unsigned long long) stats->cached);
+    fprintf(stream, "%s squares %llu", label, (unsigned long long) stats->squareTests);
+    for ( i = 0; i < SQUARE_FILTER_STAGES; i++ )
+    {
+        fprintf(stream, " mod%d %llu", moduli[i], (unsigned long long) stats->squarePassed[i]);
+    }
+    fprintf(stream, " exact %llu\n", (unsigned long long) stats->exactTests);
+    fprintf(stream, "%s pairs %llu pruned %llu imprimitive %llu\n", label,
+            (unsigned long long) stats->pairs,
+            (unsigned long long) stats->prunedPairs,
+            (unsigned long long) stats->imprimitivePairs);
+    fprintf(stream, "%s seconds", label);
+    for ( i = 0; i < STATS_STAGES; i++ )
+    {
+        fprintf(stream, " %s %.6f", stages[i], stats->ticks[i] / ticksPerSecond);
+    }
+    fprintf(stream, "\n");
+    fprintf(stream, "%s max aps %llu pairs %llu seconds %.6f\n", label,
+            (unsigned long long) stats->maxAps,
+            (unsigned long long) stats->maxPairs,
+            stats->maxTicks / ticksPerSecond);
+    stats_report_histogram(report, label, "aps", stats->apsHistogram);
+    stats_report_histogram(report, label, "pairs", stats->pairsHistogram);
+}
+
+
+void search_state_init(search_state_t * state, const search_options_t * options)
+{
+    mpz_init(state->input);
+    mpz_init(state->number);
+    mpz_init(state->numberSquared);
+
+    mpz_init(state->x1);
+    mpz_init(state->x2);
+    mpz_init(state->x3);
+    mpz_init(state->a1);
+    mpz_init(state->a2);
+    mpz_init(state->a3);
+    mpz_init(state->a7);
+    mpz_init(state->a8);
+    mpz_init(state->a9);
+
+    mpz_init(state->a);
+    mpz_init(state->b);
+    mpz_init(state->c);
+    mpz_init(state->d);
+    mpz_init(state->e);
+
+    mpz_factorization_init(&state->factorization);
+    mpz_gaussian_init(&state->gaussian);
+    mpz_ap_list_init(&state->arithmeticProgressions);
+    state->mpnLimbs = 0;
+    state->mpnDistances = NULL;
+    state->mpnCapacity = 0;
+    state->nativeLength = 0;
+    uint128_ap_list_init(&state->nativeProgressions);
+    uint128_ap_list_set_limit(&state->nativeProgressions, options->blockAps);
+    uint128_ap_list_init(&state->nativeBlock);
+    square_filter_lanes_init(&state->lanes);
+    square_filter_lanes_init(&state->blockLanes);
+    state->masks = NULL;
+    state->masksCapacity = 0;
+
+    state->options = options;
+
+    /// ///
+    /// Derive what has to be searched from the classes selected. An "fh" or
+    /// "sh2" result needs e = a - b to be a distance, which never happens as
+    /// a < b. A "sh1" result needs the third arithmetic progression d = a + b.
+    /// If nothing could be written, all generators are skipped.
+    /// ///
+    state->minSquares = (options->classes & SEARCH_CLASS_PS) ? options->minSquares : 10;
+    state->distances = (options->classes & SEARCH_CLASS_SH1) != 0;
+    state->minAps = options->minAps;
+    if ( state->minSquares > 9 && state->distances == 0 )
+    {
+        state->minAps = ULONG_MAX;
+    }
+    else if ( state->minSquares > 9 && state->minAps < 3 )
+    {
+        state->minAps = 3;
+    }
+
+    search_stats_init(&state->stats);
+    result_buffer_init(&state->results, options->log);
+    result_record_init(&state->record);
+    state->cacheHit = 0;
+    ap_cache_buffer_init(&state->cacheBuffer, options->cache);
+
+    state->plusMinus = 1;
+    state->result = 0;
+    state->start = 0;
+    state->lap = 0;
+    state->aps = -1;
+}
+
+
+void search_state_clear(search_state_t * state)
+{
+    result_buffer_clear(&state->results);
+    result_record_clear(&state->record);
+    ap_cache_buffer_clear(&state->cacheBuffer);
+    uint128_ap_list_clear(&state->nativeProgressions);
+    uint128_ap_list_clear(&state->nativeBlock);
+    square_filter_lanes_clear(&state->lanes);
+    square_filter_lanes_clear(&state->blockLanes);
+    free(state->masks);
+    mpz_ap_list_clear(&state->arithmeticProgressions);
+    free(state->mpnDistances);
+    mpz_gaussian_clear(&state->gaussian);
+    mpz_factorization_clear(&state->factorization);
+
+    mpz_clear(state->input);
+    mpz_clear(state->number);
+    mpz_clear(state->numberSquared);
+
+    mpz_clear(state->x1);
+    mpz_clear(state->x2);
+    mpz_clear(state->x3);
+    mpz_clear(state->a1);
+    mpz_clear(state->a2);
+    mpz_clear(state->a3);
+    mpz_clear(state->a7);
+    mpz_clear(state->a8);
+    mpz_clear(state->a9);
+
+    mpz_clear(state->a);
+    mpz_clear(state->b);
+    mpz_clear(state->c);
+    mpz_clear(state->d);
+    mpz_clear(state->e);
+}
+
+
+void search_state_flush(search_state_t * state)
+{
+    result_buffer_flush(&state->results);
+    ap_cache_buffer_flush(&state->cacheBuffer);
+}
+
+
+/** \brief Sets the generator to search and calculates n5 and n5^2.
+ *
+ * \param state search_state_t* The state.
+ * \param generator mpz_t The generator number g.
+ * \param plusMinus int Either 1 to use 6g + 1 or -1 to use 6g - 1.
+ * \return void
+ */
+static void search_set_generator(search_state_t * state, mpz_t generator, int plusMinus)
+{
+    state->start = stats_ticks();
+    state->lap = state->start;
+    state->aps = -1;
+
+    mpz_set(state->input, generator);
+    state->plusMinus = plusMinus;
+
+    // number = 6 * input + plusMinus
+    mpz_mul_ui(state->number, state->input, 6);
+    if ( plusMinus > 0 )
+    {
+        mpz_add_ui(state->number, state->number, 1);
+    }
+    else
+    {
+        mpz_sub_ui(state->number, state->number, 1);
+    }
+
+    // numberSquared = number^2
+    mpz_mul(state->numberSquared, state->number, state->number);
+
+#ifdef DEBUG
+    printf("Input: ");
+    mpz_out_str(stdout, 10, state->input);
+    printf(", %d\n", plusMinus);
+    printf("Number: ");
+    mpz_out_str(stdout, 10, state->number);
+    printf(", Number^2: ");
+    mpz_out_str(stdout, 10, state->numberSquared);
+    printf("\n");
+#endif
+
+    state->cacheHit = state->options->cache != NULL && mpz_sgn(state->number) > 0
+                      && ap_cache_find(state->options->cache, state->number, &state->cacheEntry);
+    state->stats.cached += state->cacheHit;
+
+    search_lap(state, STATS_STAGE_PARSE);
+}
+
+
+/** \brief Checks whether the arithmetic progressions of the generator set are in the cache.
+ *
+ * \param state search_state_t* The state.
+ * \return int 1 if they are, 0 otherwise.
+ */
+static inline int search_cache_aps(search_state_t * state)
+{
+    return state->cacheHit && state->cacheEntry.aps != AP_CACHE_NO_APS;
+}
+
+
+/** \brief Takes the prime factors of the generator set from the cache.
+ *
+ * Numbers n5 of up to 64 bits get native prime factors, bigger numbers get
+ * state->factorization, same as by factoring them. The prime factors of a
+ * damaged or foreign cache are refused, they have to be ascending and their
+ * product has to be n5.
+ *
+ * \param state search_state_t* The state, state->c, state->d and state->e are used as scratch.
+ * \return int 1 if the prime factors have been taken, 0 if they are refused.
+ */
+static int search_cache_factors(search_state_t * state)
+{
+    mpz_factorization_t * factorization = &state->factorization;
+    const unsigned char * data = state->cacheEntry.factors;
+    size_t bits = mpz_sizeinbase(state->number, 2);
+    unsigned long exponent;
+    uint32_t i;
+
+    if ( bits <= 64 && state->cacheEntry.primes > UINT64_FACTOR_MAX )
+    {
+        return 0;
+    }
+
+    mpz_factorization_reset(factorization);
+    mpz_set_ui(state->d, 1);
+    for ( i = 0; i < state->cacheEntry.primes; i++ )
+    {
+        data = ap_cache_read_factor(data, state->e, &exponent);
+        if ( mpz_cmp_ui(state->e, 1) <= 0 || exponent == 0 || exponent > bits
+                || (i > 0 && mpz_cmp(state->e, factorization->primes[i - 1]) <= 0) )
+        {
+            return 0;
+        }
+        mpz_factorization_add(factorization, state->e, exponent);
+        mpz_pow_ui(state->c, state->e, exponent);
+        mpz_mul(state->d, state->d, state->c);
+    }
+
+    if ( mpz_cmp(state->d, state->number) != 0 )
+    {
+        return 0;
+    }
+
+    if ( bits <= 64 )
+    {
+        // The primes of a product of up to 64 bits are native numbers.
+        for ( i = 0; i < state->cacheEntry.primes; i++ )
+        {
+            state->nativePrimes[i] = mpz_get_ui(factorization->primes[i]);
+            state->nativeExponents[i] = (int) factorization->exponents[i];
+        }
+        state->nativeLength = (int) state->cacheEntry.primes;
+    }
+
+    return 1;
+}
+
+
+/** \brief Checks whether the generator set needs a new record in the cache.
+ *
+ * A generator found in the cache gets no further record, unless its record
+ * has no arithmetic progressions and they are known now.
+ *
+ * \param state search_state_t* The state.
+ * \param aps int Whether the arithmetic progressions are known.
+ * \return int 1 if a record has to be written, 0 otherwise.
+ */
+static inline int search_cache_wanted(search_state_t * state, int aps)
+{
+    return state->cacheBuffer.cache != NULL && (state->cacheHit == 0 || (aps && state->cacheEntry.aps == AP_CACHE_NO_APS));
+}
+
+
+/** \brief Writes the record of the generator set with native prime factors to the cache.
+ *
+ * \param state search_state_t* The state.
+ * \param list uint128_ap_list_t* The sorted arithmetic progressions, NULL to write the prime factors only.
+ * \return void
+ */
+static void search_cache_native(search_state_t * state, uint128_ap_list_t * list)
+{
+    int i;
+
+    if ( search_cache_wanted(state, list != NULL) == 0 )
+    {
+        return;
+    }
+
+    ap_cache_buffer_begin(&state->cacheBuffer, state->number, state->nativeLength);
+    for ( i = 0; i < state->nativeLength; i++ )
+    {
+        ap_cache_buffer_add_factor_ui(&state->cacheBuffer, state->nativePrimes[i], state->nativeExponents[i]);
+    }
+    ap_cache_buffer_add_aps(&state->cacheBuffer, list != NULL ? (unsigned long) list->length : AP_CACHE_NO_APS);
+    for ( i = 0; list != NULL && i < list->length; i++ )
+    {
+        ap_cache_buffer_add_distance_uint128(&state->cacheBuffer, list->items[i].d);
+    }
+    ap_cache_buffer_end(&state->cacheBuffer);
+}
+
+
+/** \brief Writes the record of the generator set with the prime factors of state->factorization to the cache.
+ *
+ * \param state search_state_t* The state.
+ * \param list mpz_ap_list_t* The sorted arithmetic progressions, NULL to write the prime factors only.
+ * \return void
+ */
+static void search_cache_mpz(search_state_t * state, mpz_ap_list_t * list)
+{
+    int i;
+
+    if ( search_cache_wanted(state, list != NULL) == 0 )
+    {
+        return;
+    }
+
+    ap_cache_buffer_begin(&state->cacheBuffer, state->number, state->factorization.length);
+    for ( i = 0; i < state->factorization.length; i++ )
+    {
+        ap_cache_buffer_add_factor(&state->cacheBuffer, state->factorization.primes[i], state->factorization.exponents[i]);
+    }
+    ap_cache_buffer_add_aps(&state->cacheBuffer, list != NULL ? (unsigned long) list->length : AP_CACHE_NO_APS);
+    for ( i = 0; list != NULL && i < list->length; i++ )
+    {
+        ap_cache_buffer_add_distance(&state->cacheBuffer, list->items[i].d);
+    }
+    ap_cache_buffer_end(&state->cacheBuffer);
+}
+
+
+/** \brief Finishes the counters of a generator.
+ *
+ * The ticks of the generator end with its last stage, so no further tick
+ * counter is read.
+ *
+ * \param state search_state_t* The state.
+ * \param pairs uint64_t The number of combinations tested before the generator.
+ * \return long The number of results written for the generator.
+ */
+static long search_finish(search_state_t * state, uint64_t pairs)
+{
+    uint64_t ticks = state->lap - state->start;
+
+    if ( state->aps >= 0 )
+    {
+        pairs = state->stats.pairs - pairs;
+        state->stats.progressions += (uint64_t) state->aps;
+        state->stats.apsHistogram[stats_bucket((uint64_t) state->aps)]++;
+        state->stats.pairsHistogram[stats_bucket(pairs)]++;
+        state->stats.maxAps = (uint64_t) state->aps > state->stats.maxAps ? (uint64_t) state->aps : state->stats.maxAps;
+        state->stats.maxPairs = pairs > state->stats.maxPairs ? pairs : state->stats.maxPairs;
+    }
+    state->stats.maxTicks = ticks > state->stats.maxTicks ? ticks : state->stats.maxTicks;
+
+    return state->result;
+}
+
+
+/** \brief Loads the nine numbers of a magic square found by the mpz search into the state.
+ *
+ * Sets the variables a, b, c, d, e and the nine numbers x1, x2, x3, a1, a2,
+ * a3, a7, a8 and a9 of the state, as expected by search_write_result().
+ *
+ * \param state search_state_t* The state.
+ * \param AP1 mpz_ap_t* The arithmetic progression with the distance a.
+ * \param AP2 mpz_ap_t* The arithmetic progression with the distance b > a.
+ * \return void
+ */
+static void search_mpz_load(search_state_t * state, mpz_ap_t * AP1, mpz_ap_t * AP2)
+{
+    // a = "arithmetic progression distance of AP1"
+    mpz_set(state->a, AP1->d);
+
+    // b = "arithmetic progression distance of AP2"
+    mpz_set(state->b, AP2->d);
+
+    // c = "middle square number of AP1"
+    mpz_set(state->c, AP1->y);
+
+    // d = a + b, e = a - b
+    mpz_add(state->d, state->a, state->b);
+    mpz_sub(state->e, state->a, state->b);
+
+    // s1 = c - b [x1]
+    mpz_set(state->x1, AP2->x);
+
+    // s2 = c + (a + b) [x2]
+    mpz_add(state->x2, AP1->y, state->d);
+
+    // s3 = c - a [x3]
+    mpz_set(state->x3, AP1->x);
+
+    // s4 = c - (a - b) [a1]
+    mpz_sub(state->a1, AP1->y, state->e);
+
+    // s5 = c [a2]
+    mpz_set(state->a2, AP1->y);
+
+    // s6 = c + (a - b) [a3]
+    mpz_add(state->a3, AP1->y, state->e);
+
+    // s7 = c + a [a7]
+    mpz_set(state->a7, AP1->z);
+
+    // s8 = c - (a + b) [a8]
+    mpz_sub(state->a8, AP1->y, state->d);
+
+    // s9 = c + b [a9]
+    mpz_set(state->a9, AP2->z);
+
+#ifdef DEBUG
+    mpz_out_str(stdout, 10, state->x1);
+    printf(" ");
+    mpz_out_str(stdout, 10, state->x2);
+    printf(" ");
+    mpz_out_str(stdout, 10, state->x3);
+    printf("\n");
+    mpz_out_str(stdout, 10, state->a1);
+    printf(" ");
+    mpz_out_str(stdout, 10, state->a2);
+    printf(" ");
+    mpz_out_str(stdout, 10, state->a3);
+    printf("\n");
+    mpz_out_str(stdout, 10, state->a7);
+    printf(" ");
+    mpz_out_str(stdout, 10, state->a8);
+    printf(" ");
+    mpz_out_str(stdout, 10, state->a9);
+    printf("\n");
+#endif
+}
+
+
+/** \brief Writes the results of a combination of the mpz search tested exactly.
+ *
+ * \param state search_state_t* The state.
+ * \param AP1 mpz_ap_t* The arithmetic progression with the distance a.
+ * \param AP2 mpz_ap_t* The arithmetic progression with the distance b > a.
+ * \param s2PerfectSquare int Whether s2 is a perfect square number.
+ * \param s4PerfectSquare int Whether s4 is a perfect square number.
+ * \param s6PerfectSquare int Whether s6 is a perfect square number.
+ * \param s8PerfectSquare int Whether s8 is a perfect square number.
+ * \return void
+ */
+static void search_mpz_write(search_state_t * state, mpz_ap_t * AP1, mpz_ap_t * AP2, int s2PerfectSquare, int s4PerfectSquare, int s6PerfectSquare, int s8PerfectSquare)
+{
+    // s1, s3, s5, s7 and s9 are perfect square numbers (by construction).
+    // Therefore we would have at least 5 perfect square numbers.
+    // Calculate the total number of perfect square numbers in our
+    // magic square.
+    int nrPerfectSquares = 5
+                           + s2PerfectSquare
+                           + s4PerfectSquare
+                           + s6PerfectSquare
+                           + s8PerfectSquare;
+
+    /// ///
+    /// Check if d and e are distances in any other arithmetic progression.
+    /// d is one if and only if c - d and c + d are perfect square numbers.
+    /// e = a - b is negative and therefore never a distance.
+    /// ///
+    int psFound = nrPerfectSquares >= state->minSquares;
+    int dFound = s2PerfectSquare && s8PerfectSquare && state->distances;
+    int eFound = 0;
+
+    if ( psFound == 0 && dFound == 0 && eFound == 0 )
+    {
+        return;
+    }
+
+#ifdef DEBUG
+    printf("(");
+    mpz_out_str(stdout, 10, AP1->d);
+    printf(", ");
+    mpz_out_str(stdout, 10, AP2->d);
+    printf(")...\n");
+#endif
+    search_mpz_load(state, AP1, AP2);
+
+    if ( psFound > 0 )
+    {
+        /// ///
+        /// We have found a magic square of at least minSquares perfect
+        /// square numbers. So write that down to disk.
+        /// We would also write the filename to the stdout.
+        /// ///
+        search_write_result(state, RESULT_TYPE_PS, nrPerfectSquares, s2PerfectSquare, s4PerfectSquare, s6PerfectSquare, s8PerfectSquare);
+    }
+
+    if ( dFound > 0 && eFound > 0 )
+    {
+        /// ///
+        /// HEUREKA
+        /// ///
+        search_write_result(state, RESULT_TYPE_FH, nrPerfectSquares, s2PerfectSquare, s4PerfectSquare, s6PerfectSquare, s8PerfectSquare);
+    }
+    else if ( dFound > 0 )
+    {
+        /// ///
+        /// SEMI-HEUREKA 1
+        /// ///
+        search_write_result(state, RESULT_TYPE_SH1, nrPerfectSquares, s2PerfectSquare, s4PerfectSquare, s6PerfectSquare, s8PerfectSquare);
+    }
+    else if ( eFound > 0 )
+    {
+        /// ///
+        /// SEMI-HEUREKA 2
+        /// ///
+        search_write_result(state, RESULT_TYPE_SH2, nrPerfectSquares, s2PerfectSquare, s4PerfectSquare, s6PerfectSquare, s8PerfectSquare);
+    }
+}
+
+
+/** \brief Tests one combination of arithmetic progressions of the mpz search.
+ *
+ * s1, s3, s5, s7 and s9 are perfect square numbers by construction, so only
+ * s2 = c + d, s4 = c - e, s6 = c + e and s8 = c - d are tested. They are
+ * screened by their residues first, then tested exactly one by one as long
+ * as the combination can still be written. The nine numbers of the magic
+ * square are only calculated for the combinations written.
+ *
+ * The caller makes sure that b != 2a and a + b < c.
+ *
+ * \param state search_state_t* The state.
+ * \param mask int The mask of search_screen_batch().
+ * \param AP1 mpz_ap_t* The arithmetic progression with the distance a.
+ * \param AP2 mpz_ap_t* The arithmetic progression with the distance b > a.
+ * \return void
+ */
+static void search_mpz_pair(search_state_t * state, int mask, mpz_ap_t * AP1, mpz_ap_t * AP2)
+{
+    int s2PerfectSquare = 0;
+    int s4PerfectSquare = 0;
+    int s6PerfectSquare = 0;
+    int s8PerfectSquare = 0;
+
+    // Both progressions are scaled by a common prime factor, so is the square.
+    if ( AP1->content & AP2->content )
+    {
+        state->stats.imprimitivePairs++;
+        return;
+    }
+
+    mask = search_screen(state, mask);
+    if ( mask == 0 )
+    {
+        return;
+    }
+
+    // d = a + b
+    mpz_add(state->d, AP1->d, AP2->d);
+
+    // s2 = c + d, s8 = c - d
+    if ( mask & SEARCH_S2 )
+    {
+        mpz_add(state->x2, AP1->y, state->d);
+        state->stats.exactTests++;
+        s2PerfectSquare = mpz_perfect_square_p(state->x2) != 0;
+    }
+    if ( mask & SEARCH_S8 )
+    {
+        mpz_sub(state->a8, AP1->y, state->d);
+        state->stats.exactTests++;
+        s8PerfectSquare = mpz_perfect_square_p(state->a8) != 0;
+    }
+    if ( search_reachable(state, 5 + s2PerfectSquare + s8PerfectSquare + __builtin_popcount(mask & (SEARCH_S4 | SEARCH_S6)),
+                          s2PerfectSquare && s8PerfectSquare) == 0 )
+    {
+        return;
+    }
+
+    // e = a - b, s4 = c - e, s6 = c + e
+    mpz_sub(state->e, AP1->d, AP2->d);
+    if ( mask & SEARCH_S4 )
+    {
+        mpz_sub(state->a1, AP1->y, state->e);
+        state->stats.exactTests++;
+        s4PerfectSquare = mpz_perfect_square_p(state->a1) != 0;
+    }
+    if ( mask & SEARCH_S6 )
+    {
+        mpz_add(state->a3, AP1->y, state->e);
+        state->stats.exactTests++;
+        s6PerfectSquare = mpz_perfect_square_p(state->a3) != 0;
+    }
+
+    search_mpz_write(state, AP1, AP2, s2PerfectSquare, s4PerfectSquare, s6PerfectSquare, s8PerfectSquare);
+}
+
+
+/** \brief Tests one combination of arithmetic progressions of the mpz search with the mpn kernels.
+ *
+ * The same as search_mpz_pair(), but s2, s4, s6 and s8 are calculated by the
+ * fixed limb kernels of mpn_kernel.h into buffers on the stack. With
+ * f = b - a = -e they are s2 = c + d, s4 = c + f, s6 = c - f and s8 = c - d,
+ * where d < c and f < c, so only s2 and s4 can carry into an extra limb.
+ *
+ * \param state search_state_t* The state.
+ * \param mask int The mask of search_screen_batch().
+ * \param AP1 mpz_ap_t* The arithmetic progression with the distance a.
+ * \param AP2 mpz_ap_t* The arithmetic progression with the distance b > a.
+ * \param a const mp_limb_t* The limbs of a.
+ * \param b const mp_limb_t* The limbs of b.
+ * \param limbs int The number of limbs of the center, a constant in the callers.
+ * \return void
+ */
+static inline void search_mpn_pair(search_state_t * state, int mask, mpz_ap_t * AP1, mpz_ap_t * AP2,
+                                   const mp_limb_t * a, const mp_limb_t * b, int limbs)
+{
+    mp_limb_t d[MPN_KERNEL_MAX_LIMBS];
+    mp_limb_t s[MPN_KERNEL_MAX_LIMBS + 1];
+    int s2PerfectSquare = 0;
+    int s4PerfectSquare = 0;
+    int s6PerfectSquare = 0;
+    int s8PerfectSquare = 0;
+
+    // Both progressions are scaled by a common prime factor, so is the square.
+    if ( AP1->content & AP2->content )
+    {
+        state->stats.imprimitivePairs++;
+        return;
+    }
+
+    mask = search_screen(state, mask);
+    if ( mask == 0 )
+    {
+        return;
+    }
+
+    // d = a + b
+    mpn_kernel_add(d, a, b, limbs);
+
+    // s2 = c + d, s8 = c - d
+    if ( mask & SEARCH_S2 )
+    {
+        s[limbs] = mpn_kernel_add(s, state->mpnCenter, d, limbs);
+        state->stats.exactTests++;
+        s2PerfectSquare = mpn_kernel_perfect_square_p(s, limbs + 1);
+    }
+    if ( mask & SEARCH_S8 )
+    {
+        mpn_kernel_sub(s, state->mpnCenter, d, limbs);
+        state->stats.exactTests++;
+        s8PerfectSquare = mpn_kernel_perfect_square_p(s, limbs);
+    }
+    if ( search_reachable(state, 5 + s2PerfectSquare + s8PerfectSquare + __builtin_popcount(mask & (SEARCH_S4 | SEARCH_S6)),
+                          s2PerfectSquare && s8PerfectSquare) == 0 )
+    {
+        return;
+    }
+
+    // f = b - a, s4 = c + f, s6 = c - f
+    mpn_kernel_sub(d, b, a, limbs);
+    if ( mask & SEARCH_S4 )
+    {
+        s[limbs] = mpn_kernel_add(s, state->mpnCenter, d, limbs);
+        state->stats.exactTests++;
+        s4PerfectSquare = mpn_kernel_perfect_square_p(s, limbs + 1);
+    }
+    if ( mask & SEARCH_S6 )
+    {
+        mpn_kernel_sub(s, state->mpnCenter, d, limbs);
+        state->stats.exactTests++;
+        s6PerfectSquare = mpn_kernel_perfect_square_p(s, limbs);
+    }
+
+    search_mpz_write(state, AP1, AP2, s2PerfectSquare, s4PerfectSquare, s6PerfectSquare, s8PerfectSquare);
+}
+
+
+/** \brief The pair loop of one arithmetic progression AP1 of the mpz search.
+ *
+ * Tests the combinations of the progression i with the progressions from to
+ * to - 1, screened by search_screen_batch() already.
+ */
+typedef void (*search_mpz_row_t)(search_state_t * state, int i, int from, int to);
+
+
+/** \brief Tests the combinations of one row with the mpz_t functions.
+ *
+ * \param state search_state_t* The state.
+ * \param i int The index of AP1.
+ * \param from int The index of the first AP2.
+ * \param to int The index after the last AP2.
+ * \return void
+ */
+static void search_mpz_row(search_state_t * state, int i, int from, int to)
+{
+    mpz_ap_t * items = state->arithmeticProgressions.items;
+    int j;
+
+    for ( j = from; j < to; j++ )
+    {
+        search_mpz_pair(state, state->masks[j], &items[i], &items[j]);
+    }
+}
+
+
+/** \brief Defines search_mpn_row_<limbs>(), the row of search_mpz_row() with the mpn kernels of a fixed limb count. */
+#define SEARCH_MPN_ROW(limbs) \
+static void search_mpn_row_##limbs(search_state_t * state, int i, int from, int to) \
+{ \
+    mpz_ap_t * items = state->arithmeticProgressions.items; \
+    const mp_limb_t * a = state->mpnDistances + (size_t) i * (limbs); \
+    int j; \
+    \
+    for ( j = from; j < to; j++ ) \
+    { \
+        search_mpn_pair(state, state->masks[j], &items[i], &items[j], a, state->mpnDistances + (size_t) j * (limbs), (limbs)); \
+    } \
+}
+
+SEARCH_MPN_ROW(2)
+SEARCH_MPN_ROW(3)
+SEARCH_MPN_ROW(4)
+SEARCH_MPN_ROW(5)
+SEARCH_MPN_ROW(6)
+SEARCH_MPN_ROW(7)
+SEARCH_MPN_ROW(8)
+
+
+/** \brief The rows with the mpn kernels, indexed by the limb count of the center. */
+static const search_mpz_row_t search_mpn_rows[MPN_KERNEL_MAX_LIMBS + 1] =
+{
+    NULL, NULL,
+    search_mpn_row_2, search_mpn_row_3, search_mpn_row_4, search_mpn_row_5,
+    search_mpn_row_6, search_mpn_row_7, search_mpn_row_8
+};
+
+
+/** \brief Picks the row function for the generator set and prepares its limbs.
+ *
+ * If n5^2 has MPN_KERNEL_MIN_LIMBS to MPN_KERNEL_MAX_LIMBS limbs, the center
+ * and the distances of all arithmetic progressions are copied into zero
+ * padded limb arrays of that size, once per generator. Otherwise the
+ * combinations are tested with the mpz_t functions.
+ *
+ * \param state search_state_t* The state.
+ * \param list mpz_ap_list_t* The sorted arithmetic progressions.
+ * \return search_mpz_row_t The row function.
+ */
+static search_mpz_row_t search_mpn_prepare(search_state_t * state, mpz_ap_list_t * list)
+{
+    int limbs = (int) mpz_size(state->numberSquared);
+    size_t size;
+    mp_limb_t * distance;
+    int i;
+
+    if ( limbs < MPN_KERNEL_MIN_LIMBS || limbs > MPN_KERNEL_MAX_LIMBS )
+    {
+        state->mpnLimbs = 0;
+        return search_mpz_row;
+    }
+
+    size = (size_t) list->length * limbs;
+    if ( size > state->mpnCapacity )
+    {
+        state->mpnCapacity = size > 2 * state->mpnCapacity ? size : 2 * state->mpnCapacity;
+        state->mpnDistances = realloc(state->mpnDistances, state->mpnCapacity * sizeof(mp_limb_t));
+    }
+
+    state->mpnLimbs = limbs;
+    memcpy(state->mpnCenter, mpz_limbs_read(state->numberSquared), limbs * sizeof(mp_limb_t));
+    for ( i = 0; i < list->length; i++ )
+    {
+        // Every distance is smaller than the center.
+        distance = state->mpnDistances + (size_t) i * limbs;
+        memset(distance, 0, limbs * sizeof(mp_limb_t));
+        memcpy(distance, mpz_limbs_read(list->items[i].d), mpz_size(list->items[i].d) * sizeof(mp_limb_t));
+    }
+
+    return search_mpn_rows[limbs];
+}
+
+
+/** \brief Stores the residues of the distances of the mpz search for search_screen_batch().
+ *
+ * \param state search_state_t* The state.
+ * \param list mpz_ap_list_t* The sorted arithmetic progressions.
+ * \return void
+ */
+static void search_mpz_lanes(search_state_t * state, mpz_ap_list_t * list)
+{
+    int i;
+
+    square_filter_lanes_reserve(&state->lanes, list->length);
+    for ( i = 0; i < list->length; i++ )
+    {
+        square_filter_lanes_set(&state->lanes, i, list->items[i].residue);
+    }
+    search_masks_reserve(state, list->length);
+}
+
+
+/** \brief Marks the prime factors of n5 every arithmetic progression is scaled by.
+ *
+ * The prime p divides the square roots of x, y and z if and only if p^2
+ * divides the distance d, as c = y^2 holds p^2 anyway. Bit i of the content
+ * is set for the i-th prime factor (only the first 64 get a bit, which needs
+ * far bigger numbers than searched here).
+ *
+ * Two progressions sharing a prime p give a magic square of p^2 times a
+ * magic square of n5 / p, found with that generator already. Progressions
+ * with a content are not dropped, though: together with a progression not
+ * sharing any of their prime factors they give a primitive magic square.
+ *
+ * \param state search_state_t* The state, state->e is used as scratch.
+ * \param list mpz_ap_list_t* The arithmetic progressions.
+ * \return void
+ */
+static void search_mpz_contents(search_state_t * state, mpz_ap_list_t * list)
+{
+    int i, k;
+
+    for ( i = 0; i < list->length; i++ )
+    {
+        list->items[i].content = 0;
+    }
+
+    for ( k = 0; k < state->factorization.length && k < 64; k++ )
+    {
+        mpz_mul(state->e, state->factorization.primes[k], state->factorization.primes[k]);
+        for ( i = 0; i < list->length; i++ )
+        {
+            if ( mpz_divisible_p(list->items[i].d, state->e) )
+            {
+                list->items[i].content |= (uint64_t) 1 << k;
+            }
+        }
+    }
+}
+
+
+/** \brief Builds the arithmetic progressions of the generator set from its distances in the cache.
+ *
+ * The distances are stored ascending and without duplicates, so the list
+ * needs no sorting. The distances of a damaged or foreign cache are refused,
+ * they have to be strictly ascending and below n5^2.
+ *
+ * \param state search_state_t* The state, state->a, state->b and state->d are used as scratch.
+ * \param list mpz_ap_list_t* Receives the arithmetic progressions.
+ * \return int 1 if the distances have been taken, 0 if they are refused.
+ */
+static int search_mpz_cached(search_state_t * state, mpz_ap_list_t * list)
+{
+    const unsigned char * data = state->cacheEntry.distances;
+    unsigned long i;
+
+    for ( i = 0; i < state->cacheEntry.aps; i++ )
+    {
+        data = ap_cache_read_number(data, state->d);
+        if ( mpz_cmp(state->d, state->numberSquared) >= 0
+                || (i == 0 ? mpz_sgn(state->d) <= 0 : mpz_cmp(state->d, list->items[i - 1].d) <= 0) )
+        {
+            mpz_ap_list_reset(list);
+            return 0;
+        }
+        mpz_sub(state->a, state->numberSquared, state->d);
+        mpz_add(state->b, state->numberSquared, state->d);
+        mpz_ap_list_append(list, state->a, state->numberSquared, state->b);
+    }
+
+    return 1;
+}
+
+
+/** \brief Searches the magic squares of squares for the generator set with mpz_t variables.
+ *
+ * The prime factorization of n5 must already be stored in state->factorization.
+ *
+ * \param state search_state_t* The state.
+ * \return long The number of results written.
+ */
+static long search_mpz(search_state_t * state)
+{
+    mpz_ap_list_t * list = &state->arithmeticProgressions;
+    mpz_ap_t * AP1;
+    search_mpz_row_t row;
+    uint64_t residueC;
+    uint64_t enumerated = 0;
+    int i, end, skip;
+
+    /// ///
+    /// Calculate the Arithmetic Progressions from the representations of
+    /// number^2 as a sum of two squares u^2 + v^2. These are built directly from
+    /// the prime factors of the number via Gaussian integers, unless they are
+    /// taken from the cache. New ones are written to the cache.
+    /// ///
+#ifdef DEBUG
+    printf("-- Prime Factors --\n");
+    mpz_factorization_print(&state->factorization);
+#endif
+    mpz_ap_list_reset(list);
+    if ( search_cache_aps(state) && search_mpz_cached(state, list) )
+    {
+        search_lap(state, STATS_STAGE_APS);
+    }
+    else
+    {
+        // Not cached or a damaged record, which is replaced by a new one.
+        state->cacheEntry.aps = AP_CACHE_NO_APS;
+        mpz_gaussian_aps(&state->gaussian, &state->factorization, state->numberSquared, list);
+        search_lap(state, STATS_STAGE_APS);
+        mpz_ap_list_sort(list);
+        search_cache_mpz(state, list);
+    }
+    residueC = mpz_fdiv_ui(state->numberSquared, SQUARE_FILTER_MODULUS);
+    if ( state->options->primitive )
+    {
+        search_mpz_contents(state, list);
+    }
+    search_mpz_lanes(state, list);
+    row = search_mpn_prepare(state, list);
+    search_lap(state, STATS_STAGE_SORT);
+#ifdef DEBUG
+    printf("-- Arithmetic Progressions --\n");
+    mpz_ap_list_print(list);
+#endif
+
+
+    /// ///
+    /// Iterate through all combinations of arithmetic progressions AP1 and AP2
+    /// with the condition that the distance of AP1 (call it a) is smaller than
+    /// the distance of AP2 (call it b). Further we get the middle square number
+    /// of AP1 (which is the same as the middle square number of AP2) and call
+    /// it c.
+    ///
+    /// If b == 2a then the combination is skipped.
+    /// Otherwise we will calculate d = a + b and e = a - b.
+    /// If d >= c the combination is skipped, as then c - d would be negative.
+    ///
+    /// As the list is sorted, the AP2 with a < b < c - a are found by a binary
+    /// search and so is the AP2 with b == 2a. Once there is no such AP2 left,
+    /// there is none for any bigger a either.
+    /// ///
+#ifdef DEBUG
+    printf("-- Valid Combinations --\n");
+#endif
+    for ( i = 0; i + 1 < list->length; i++ )
+    {
+        AP1 = &list->items[i];
+
+        // a + b < c
+        mpz_sub(state->e, AP1->y, AP1->d);
+        end = mpz_ap_list_lower_bound(list, state->e);
+        if ( end <= i + 1 )
+        {
+            break;
+        }
+
+        // b = 2a
+        mpz_mul_2exp(state->e, AP1->d, 1);
+        skip = mpz_ap_list_find(list, state->e);
+        if ( skip < 0 || skip >= end )
+        {
+            skip = end;
+        }
+        enumerated += end - i - 1 - (skip < end ? 1 : 0);
+
+        search_screen_batch(state, &state->lanes, residueC, AP1->residue, i + 1, end);
+        row(state, i, i + 1, skip);
+        row(state, i, skip + 1, end);
+    }
+
+    state->stats.pairs += enumerated;
+    state->stats.prunedPairs += (uint64_t) list->length * (list->length - 1) / 2 - enumerated;
+    search_lap(state, STATS_STAGE_PAIRS);
+
+    return state->result;
+}
+
+
+/** \brief Searches the magic squares of squares for the generator set.
+ *
+ * The prime factorization of n5 must already be stored in state->factorization.
+ *
+ * \param state search_state_t* The state.
+ * \return long The number of results written.
+ */
+static long search_factored(search_state_t * state)
+{
+    unsigned long count;
+    int i;
+
+    state->stats.generators++;
+    state->result = 0;
+
+    /// ///
+    /// Skip the generator if the number of Arithmetic Progressions, known from
+    /// the prime factors alone, is too small.
+    /// ///
+    count = mpz_gaussian_count(&state->factorization);
+    if ( count < state->minAps )
+    {
+        state->stats.pruned++;
+        search_cache_mpz(state, NULL);
+        return 0;
+    }
+
+    /// ///
+    /// In the primitive mode, skip the generator if n5 has a prime factor
+    /// p = 3 (mod 4). Such a p divides u and v of every n5^2 = u^2 + v^2, so
+    /// every magic square is p^2 times a magic square of n5 / p.
+    /// ///
+    if ( state->options->primitive )
+    {
+        for ( i = 0; i < state->factorization.length; i++ )
+        {
+            if ( mpz_fdiv_ui(state->factorization.primes[i], 4) == 3 )
+            {
+                state->stats.imprimitive++;
+                search_cache_mpz(state, NULL);
+                return 0;
+            }
+        }
+    }
+
+    state->aps = count;
+
+    return search_mpz(state);
+}
+
+
+/** \brief Loads a magic square found by the native search into the state.
+ *
+ * Sets the variables a, b, c, d, e and the nine numbers x1, x2, x3, a1, a2,
+ * a3, a7, a8 and a9 of the state, as expected by search_write_result().
+ *
+ * \param state search_state_t* The state.
+ * \param c uint128_t The center square number.
+ * \param AP1 uint128_ap_t* The arithmetic progression with the distance a.
+ * \param AP2 uint128_ap_t* The arithmetic progression with the distance b > a.
+ * \return void
+ */
+static void search_native_load(search_state_t * state, uint128_t c, uint128_ap_t * AP1, uint128_ap_t * AP2)
+{
+    uint128_t a = AP1->d;
+    uint128_t b = AP2->d;
+
+    uint128_get_mpz(state->a, a);
+    uint128_get_mpz(state->b, b);
+    uint128_get_mpz(state->c, c);
+    uint128_get_mpz(state->d, a + b);
+
+    // e = a - b is negative.
+    uint128_get_mpz(state->e, b - a);
+    mpz_neg(state->e, state->e);
+
+    uint128_get_mpz(state->x1, AP2->x);
+    uint128_get_mpz(state->x2, c + (a + b));
+    uint128_get_mpz(state->x3, AP1->x);
+    uint128_get_mpz(state->a1, c + (b - a));
+    uint128_get_mpz(state->a2, c);
+    uint128_get_mpz(state->a3, c - (b - a));
+    uint128_get_mpz(state->a7, AP1->z);
+    uint128_get_mpz(state->a8, c - (a + b));
+    uint128_get_mpz(state->a9, AP2->z);
+}
+
+
+/** \brief Tests one combination of arithmetic progressions of the native search.
+ *
+ * See search_mpz() for the conditions. As AP1 has the smaller distance,
+ * e = a - b is negative. The numbers s4 = c - e and s6 = c + e are
+ * calculated as c + (b - a) and c - (b - a).
+ *
+ * The sum d = a + b is the distance of another arithmetic progression if and
+ * only if c - d and c + d are perfect square numbers, i.e. s8 and s2. So no
+ * lookup in the list is needed and combinations can be tested without the
+ * other arithmetic progressions at hand.
+ *
+ * The numbers have been screened by search_screen_batch() and are tested
+ * exactly only as long as the combination can still be written.
+ *
+ * The caller makes sure that b != 2a and a + b < c.
+ *
+ * \param state search_state_t* The state.
+ * \param c uint128_t The center square number.
+ * \param mask int The mask of search_screen_batch().
+ * \param AP1 uint128_ap_t* The arithmetic progression with the distance a.
+ * \param AP2 uint128_ap_t* The arithmetic progression with the distance b > a.
+ * \return void
+ */
+static inline void search_native_pair(search_state_t * state, uint128_t c, int mask, uint128_ap_t * AP1, uint128_ap_t * AP2)
+{
+    uint128_t a = AP1->d;
+    uint128_t b = AP2->d;
+
+    // d = a + b
+    uint128_t d = a + b;
+
+    // |e| = b - a
+    uint128_t e = b - a;
+
+    int s2PerfectSquare = 0;
+    int s4PerfectSquare = 0;
+    int s6PerfectSquare = 0;
+    int s8PerfectSquare = 0;
+
+    // Both progressions are scaled by a common prime factor, so is the square.
+    if ( AP1->content & AP2->content )
+    {
+        state->stats.imprimitivePairs++;
+        return;
+    }
+
+    mask = search_screen(state, mask);
+    if ( mask == 0 )
+    {
+        return;
+    }
+
+    // s2 and s8 first, together they decide about d.
+    if ( mask & SEARCH_S2 )
+    {
+        state->stats.exactTests++;
+        s2PerfectSquare = uint128_is_square(c + d);
+    }
+    if ( mask & SEARCH_S8 )
+    {
+        state->stats.exactTests++;
+        s8PerfectSquare = uint128_is_square(c - d);
+    }
+    if ( search_reachable(state, 5 + s2PerfectSquare + s8PerfectSquare + __builtin_popcount(mask & (SEARCH_S4 | SEARCH_S6)),
+                          s2PerfectSquare && s8PerfectSquare) == 0 )
+    {
+        return;
+    }
+
+    if ( mask & SEARCH_S4 )
+    {
+        state->stats.exactTests++;
+        s4PerfectSquare = uint128_is_square(c + e);
+    }
+    if ( mask & SEARCH_S6 )
+    {
+        state->stats.exactTests++;
+        s6PerfectSquare = uint128_is_square(c - e);
+    }
+
+    int nrPerfectSquares = 5
+                           + s2PerfectSquare
+                           + s4PerfectSquare
+                           + s6PerfectSquare
+                           + s8PerfectSquare;
+
+    int psFound = nrPerfectSquares >= state->minSquares;
+    int dFound = s2PerfectSquare && s8PerfectSquare && state->distances;
+    // e is negative and therefore never a distance.
+    int eFound = 0;
+
+    if ( psFound == 0 && dFound == 0 && eFound == 0 )
+    {
+        return;
+    }
+
+    search_native_load(state, c, AP1, AP2);
+
+    if ( psFound > 0 )
+    {
+        search_write_result(state, RESULT_TYPE_PS, nrPerfectSquares, s2PerfectSquare, s4PerfectSquare, s6PerfectSquare, s8PerfectSquare);
+    }
+
+    if ( dFound > 0 && eFound > 0 )
+    {
+        search_write_result(state, RESULT_TYPE_FH, nrPerfectSquares, s2PerfectSquare, s4PerfectSquare, s6PerfectSquare, s8PerfectSquare);
+    }
+    else if ( dFound > 0 )
+    {
+        search_write_result(state, RESULT_TYPE_SH1, nrPerfectSquares, s2PerfectSquare, s4PerfectSquare, s6PerfectSquare, s8PerfectSquare);
+    }
+    else if ( eFound > 0 )
+    {
+        search_write_result(state, RESULT_TYPE_SH2, nrPerfectSquares, s2PerfectSquare, s4PerfectSquare, s6PerfectSquare, s8PerfectSquare);
+    }
+}
+
+
+/** \brief Marks the prime factors of n5 every native arithmetic progression is scaled by.
+ *
+ * Same as search_mpz_contents() for native numbers.
+ *
+ * \param state search_state_t* The state.
+ * \param list uint128_ap_list_t* The arithmetic progressions.
+ * \return void
+ */
+static void search_native_contents(search_state_t * state, uint128_ap_list_t * list)
+{
+    uint128_t square;
+    int i, k;
+
+    for ( i = 0; i < list->length; i++ )
+    {
+        list->items[i].content = 0;
+    }
+
+    for ( k = 0; k < state->nativeLength; k++ )
+    {
+        square = (uint128_t) state->nativePrimes[k] * state->nativePrimes[k];
+        for ( i = 0; i < list->length; i++ )
+        {
+            if ( list->items[i].d % square == 0 )
+            {
+                list->items[i].content |= (uint64_t) 1 << k;
+            }
+        }
+    }
+}
+
+
+/** \brief Stores the residues of the distances of the native search for search_screen_batch().
+ *
+ * \param state search_state_t* The state.
+ * \param list uint128_ap_list_t* The sorted arithmetic progressions.
+ * \param lanes square_filter_lanes_t* Receives the residues.
+ * \return void
+ */
+static void search_native_lanes(search_state_t * state, uint128_ap_list_t * list, square_filter_lanes_t * lanes)
+{
+    int i;
+
+    square_filter_lanes_reserve(lanes, list->length);
+    for ( i = 0; i < list->length; i++ )
+    {
+        square_filter_lanes_set(lanes, i, list->items[i].residue);
+    }
+    search_masks_reserve(state, list->length);
+}
+
+
+/** \brief Tests the combinations of the arithmetic progressions of a sorted list.
+ *
+ * For AP1 with the distance a, only the AP2 with a < b < c - a can give a
+ * magic square. As the distances are sorted, that range is found by a binary
+ * search, and so is the AP2 with b = 2a to skip. The AP1 loop stops as soon
+ * as the range is empty, it would be empty for all bigger distances a, too.
+ *
+ * \param state search_state_t* The state.
+ * \param c uint128_t The center square number.
+ * \param residueC uint64_t The center modulo SQUARE_FILTER_MODULUS.
+ * \param list uint128_ap_list_t* The arithmetic progressions, sorted by distance.
+ * \return void
+ */
+static void search_native_list(search_state_t * state, uint128_t c, uint64_t residueC, uint128_ap_list_t * list)
+{
+    uint128_ap_t * items = list->items;
+    uint64_t enumerated = 0;
+    int i, j, end, skip;
+
+    for ( i = 0; i + 1 < list->length; i++ )
+    {
+        // a + b < c
+        end = uint128_ap_list_lower_bound(list, c - items[i].d);
+        if ( end <= i + 1 )
+        {
+            break;
+        }
+
+        // b = 2a
+        skip = uint128_ap_list_find(list, 2 * items[i].d);
+        if ( skip < 0 || skip >= end )
+        {
+            skip = end;
+        }
+
+        search_screen_batch(state, &state->lanes, residueC, items[i].residue, i + 1, end);
+        for ( j = i + 1; j < skip; j++ )
+        {
+            search_native_pair(state, c, state->masks[j], &items[i], &items[j]);
+        }
+        for ( j = skip + 1; j < end; j++ )
+        {
+            search_native_pair(state, c, state->masks[j], &items[i], &items[j]);
+        }
+
+        enumerated += end - i - 1 - (skip < end ? 1 : 0);
+    }
+
+    state->stats.pairs += enumerated;
+    state->stats.prunedPairs += (uint64_t) list->length * (list->length - 1) / 2 - enumerated;
+}
+
+
+/** \brief Tests the combinations of the arithmetic progressions of two sorted lists.
+ *
+ * Same as search_native_list(), but every arithmetic progression of the
+ * first list is combined with every one of the second list. The distances of
+ * the two lists are not sorted against each other, so either one can be AP1.
+ *
+ * \param state search_state_t* The state.
+ * \param c uint128_t The center square number.
+ * \param residueC uint64_t The center modulo SQUARE_FILTER_MODULUS.
+ * \param first uint128_ap_list_t* The first arithmetic progressions, sorted by distance.
+ * \param second uint128_ap_list_t* The second arithmetic progressions, sorted by distance.
+ * \param lanes const square_filter_lanes_t* The residues of the second arithmetic progressions.
+ * \return void
+ */
+static void search_native_lists(search_state_t * state, uint128_t c, uint64_t residueC, uint128_ap_list_t * first, uint128_ap_list_t * second,
+                                const square_filter_lanes_t * lanes)
+{
+    uint128_t a;
+    uint64_t enumerated = 0;
+    int i, j, end, twice, half;
+
+    for ( i = 0; i < first->length; i++ )
+    {
+        a = first->items[i].d;
+
+        // a + b < c
+        end = uint128_ap_list_lower_bound(second, c - a);
+
+        // b = 2a and a = 2b, all distances are even
+        twice = uint128_ap_list_find(second, 2 * a);
+        half = uint128_ap_list_find(second, a / 2);
+
+        // The screen takes the first arithmetic progression as AP1.
+        search_screen_batch(state, lanes, residueC, first->items[i].residue, 0, end);
+        for ( j = 0; j < end; j++ )
+        {
+            if ( j == twice || j == half )
+            {
+                continue;
+            }
+
+            if ( a < second->items[j].d )
+            {
+                search_native_pair(state, c, state->masks[j], &first->items[i], &second->items[j]);
+            }
+            else
+            {
+                search_native_pair(state, c, search_screen_swap(state->masks[j]), &second->items[j], &first->items[i]);
+            }
+        }
+
+        enumerated += end - (twice >= 0 && twice < end ? 1 : 0) - (half >= 0 && half < end ? 1 : 0);
+    }
+
+    state->stats.pairs += enumerated;
+    state->stats.prunedPairs += (uint64_t) first->length * second->length - enumerated;
+}
+
+
+/** \brief Searches the arithmetic progressions spilled by the native search block by block.
+ *
+ * Only two blocks are held in memory at a time: every block is combined with
+ * itself and then with every following block. The blocks are sorted by
+ * distance each, but not against each other.
+ *
+ * \param state search_state_t* The state.
+ * \param c uint128_t The center square number.
+ * \param residueC uint64_t The center modulo SQUARE_FILTER_MODULUS.
+ * \return void
+ */
+static void search_native_blocks(search_state_t * state, uint128_t c, uint64_t residueC)
+{
+    uint128_ap_list_t * list = &state->nativeProgressions;
+    uint128_ap_list_t * other = &state->nativeBlock;
+    int block, otherBlock;
+
+    state->stats.blocked++;
+
+    for ( block = 0; block < list->blocks; block++ )
+    {
+        uint128_ap_list_load(list, list, block);
+        if ( state->options->primitive )
+        {
+            search_native_contents(state, list);
+        }
+        search_native_lanes(state, list, &state->lanes);
+        search_lap(state, STATS_STAGE_SORT);
+        search_native_list(state, c, residueC, list);
+        search_lap(state, STATS_STAGE_PAIRS);
+
+        for ( otherBlock = block + 1; otherBlock < list->blocks; otherBlock++ )
+        {
+            uint128_ap_list_load(other, list, otherBlock);
+            if ( state->options->primitive )
+            {
+                search_native_contents(state, other);
+            }
+            search_native_lanes(state, other, &state->blockLanes);
+            search_lap(state, STATS_STAGE_SORT);
+            search_native_lists(state, c, residueC, list, other, &state->blockLanes);
+            search_lap(state, STATS_STAGE_PAIRS);
+        }
+    }
+}
+
+
+/** \brief Builds the native arithmetic progressions of the generator set from its distances in the cache.
+ *
+ * Same as search_mpz_cached(), the list is spilled if it is limited.
+ *
+ * \param state search_state_t* The state.
+ * \param c uint128_t The center square number.
+ * \param list uint128_ap_list_t* Receives the arithmetic progressions.
+ * \return int 1 if the distances have been taken, 0 if they are refused.
+ */
+static int search_native_cached(search_state_t * state, uint128_t c, uint128_ap_list_t * list)
+{
+    const unsigned char * data = state->cacheEntry.distances;
+    uint128_t d;
+    uint128_t previous = 0;
+    unsigned long i;
+
+    for ( i = 0; i < state->cacheEntry.aps; i++ )
+    {
+        data = ap_cache_read_uint128(data, &d);
+        if ( data == NULL || d <= previous || d >= c )
+        {
+            // Drops the blocks spilled as well.
+            uint128_ap_list_reset(list);
+            return 0;
+        }
+        uint128_ap_list_append(list, c - d, c + d, d);
+        previous = d;
+    }
+
+    return 1;
+}
+
+
+/** \brief Searches the magic squares of squares for the generator set with native numbers.
+ *
+ * The prime factorization of n5 must already be stored in state->nativePrimes
+ * and state->nativeExponents. Numbers n5 too big for the native numbers are
+ * handed over to search_mpz().
+ *
+ * \param state search_state_t* The state.
+ * \return long The number of results written.
+ */
+static long search_native(search_state_t * state)
+{
+    uint128_ap_list_t * list = &state->nativeProgressions;
+    uint128_t c;
+    uint64_t residueC;
+    unsigned long count;
+    int i;
+
+    state->stats.generators++;
+    state->result = 0;
+
+    /// ///
+    /// Skip the generator if the number of Arithmetic Progressions, known from
+    /// the prime factors alone, is too small.
+    /// ///
+    count = uint128_gaussian_count(state->nativePrimes, state->nativeExponents, state->nativeLength);
+    if ( count < state->minAps )
+    {
+        state->stats.pruned++;
+        search_cache_native(state, NULL);
+        return 0;
+    }
+
+    /// ///
+    /// In the primitive mode, skip the generator if n5 has a prime factor
+    /// p = 3 (mod 4), same as in search_factored().
+    /// ///
+    if ( state->options->primitive )
+    {
+        for ( i = 0; i < state->nativeLength; i++ )
+        {
+            if ( state->nativePrimes[i] % 4 == 3 )
+            {
+                state->stats.imprimitive++;
+                search_cache_native(state, NULL);
+                return 0;
+            }
+        }
+    }
+
+    state->aps = count;
+
+    if ( mpz_sizeinbase(state->number, 2) > UINT128_GAUSSIAN_BITS )
+    {
+        // The squares would not fit into 128 bits.
+        mpz_factorization_reset(&state->factorization);
+        for ( i = 0; i < state->nativeLength; i++ )
+        {
+            mpz_factorization_add_ui(&state->factorization, state->nativePrimes[i], state->nativeExponents[i]);
+        }
+
+        return search_mpz(state);
+    }
+
+    /// ///
+    /// Calculate the Arithmetic Progressions or take them from the cache, same
+    /// as in search_mpz(). If there are more than options->blockAps of them,
+    /// they are spilled to a temporary file in blocks and searched block by
+    /// block. The cache only gets the prime factors of such a generator.
+    /// ///
+    c = (uint128_t) mpz_get_ui(state->number) * mpz_get_ui(state->number);
+    residueC = (uint64_t) (c % SQUARE_FILTER_MODULUS);
+
+    uint128_ap_list_reset(list);
+    if ( search_cache_aps(state) == 0 || search_native_cached(state, c, list) == 0 )
+    {
+        // Not cached or a damaged record, which is replaced by a new one.
+        state->cacheEntry.aps = AP_CACHE_NO_APS;
+        uint128_gaussian_aps(mpz_get_ui(state->number), state->nativePrimes, state->nativeExponents, state->nativeLength, list);
+    }
+    search_lap(state, STATS_STAGE_APS);
+
+    if ( list->blocks > 0 )
+    {
+        uint128_ap_list_spill(list);
+        search_cache_native(state, NULL);
+        search_lap(state, STATS_STAGE_SORT);
+        search_native_blocks(state, c, residueC);
+        return state->result;
+    }
+
+    if ( search_cache_aps(state) == 0 )
+    {
+        uint128_ap_list_sort(list);
+        search_cache_native(state, list);
+    }
+    if ( state->options->primitive )
+    {
+        search_native_contents(state, list);
+    }
+    search_native_lanes(state, list, &state->lanes);
+    search_lap(state, STATS_STAGE_SORT);
+#ifdef DEBUG
+    printf("-- Arithmetic Progressions --\n");
+    uint128_ap_list_print(list, c);
+#endif
+
+    /// ///
+    /// Iterate through the combinations of arithmetic progressions AP1 and
+    /// AP2, same as in search_mpz().
+    /// ///
+    search_native_list(state, c, residueC, list);
+    search_lap(state, STATS_STAGE_PAIRS);
+
+    return state->result;
+}
+
+
+long search_generator(search_state_t * state, mpz_t generator, int plusMinus)
+{
+    uint64_t pairs = state->stats.pairs;
+    int native;
+
+    search_set_generator(state, generator, plusMinus);
+
+    native = mpz_sgn(state->number) > 0 && mpz_sizeinbase(state->number, 2) <= 64;
+    if ( state->cacheHit && search_cache_factors(state) == 0 )
+    {
+        // A damaged record, n5 is factored and recorded again.
+        state->cacheHit = 0;
+        state->stats.cached--;
+    }
+
+    if ( state->cacheHit == 0 && native )
+    {
+        state->nativeLength = uint64_factor(mpz_get_ui(state->number), state->nativePrimes, state->nativeExponents);
+    }
+    else if ( state->cacheHit == 0 )
+    {
+        mpz_factorize(&state->factorization, state->number);
+    }
+    search_lap(state, STATS_STAGE_FACTOR);
+
+    if ( native )
+    {
+        search_native(state);
+    }
+    else
+    {
+        search_factored(state);
+    }
+
+    return search_finish(state, pairs);
+}
+
+
+long search_generator_factored(search_state_t * state, mpz_t generator, int plusMinus)
+{
+    uint64_t pairs = state->stats.pairs;
+    int i;
+
+    search_set_generator(state, generator, plusMinus);
+
+    if ( mpz_sgn(state->number) > 0 && mpz_sizeinbase(state->number, 2) <= UINT128_GAUSSIAN_BITS )
+    {
+        for ( i = 0; i < state->factorization.length; i++ )
+        {
+            state->nativePrimes[i] = mpz_get_ui(state->factorization.primes[i]);
+            state->nativeExponents[i] = (int) state->factorization.exponents[i];
+        }
+        state->nativeLength = state->factorization.length;
+
+        search_native(state);
+    }
+    else
+    {
+        search_factored(state);
+    }
+
+    return search_finish(state, pairs);
+}
+
+
+long search_generator_native(search_state_t * state, mpz_t generator, int plusMinus, const uint64_t * primes, const int * exponents, int length)
+{
+    uint64_t pairs = state->stats.pairs;
+
+    search_set_generator(state, generator, plusMinus);
+
+    memcpy(state->nativePrimes, primes, length * sizeof(uint64_t));
+    memcpy(state->nativeExponents, exponents, length * sizeof(int));
+    state->nativeLength = length;
+
+    search_native(state);
+
+    return search_finish(state, pairs);
+}
@@ -0,0 +1,300 @@
+#ifndef SEARCH_H_INCLUDED
+#define SEARCH_H_INCLUDED
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <gmp.h>
+
+#include "mpz_factorization.h"
+#include "mpz_gaussian.h"
+#include "mpz_ap_list.h"
+#include "mpn_kernel.h"
+#include "uint64_factor.h"
+#include "uint128_ap_list.h"
+#include "square_filter.h"
+#include "result_log.h"
+#include "ap_cache.h"
+#include "stats.h"
+
+
+/** \brief The classes of results to search, see search_options_t.classes. */
+#define SEARCH_CLASS_PS (1 << RESULT_TYPE_PS)
+#define SEARCH_CLASS_FH (1 << RESULT_TYPE_FH)
+#define SEARCH_CLASS_SH1 (1 << RESULT_TYPE_SH1)
+#define SEARCH_CLASS_SH2 (1 << RESULT_TYPE_SH2)
+#define SEARCH_CLASS_ALL (SEARCH_CLASS_PS | SEARCH_CLASS_FH | SEARCH_CLASS_SH1 | SEARCH_CLASS_SH2)
+
+/** \brief The options of the search. */
+typedef struct search_options
+{
+    /** \brief Generators with less arithmetic progressions are skipped. */
+    unsigned long minAps;
+    /** \brief The log receiving the results, NULL to write one file per result. */
+    result_log_t * log;
+    /** \brief Generators with more arithmetic progressions are searched block by block of that many. */
+    int blockAps;
+    /** \brief Magic squares with at least that many perfect square numbers are written as "ps". */
+    int minSquares;
+    /** \brief The classes of results to search, SEARCH_CLASS_*. */
+    int classes;
+    /** \brief Whether only the primitive magic squares are searched, not their scaled copies. */
+    int primitive;
+    /** \brief The cache of the prime factors and arithmetic progressions of n5, NULL for none. */
+    ap_cache_t * cache;
+} search_options_t;
+
+
+/** \brief The counters of the search. */
+typedef struct search_stats
+{
+    /** \brief The number of generators searched. */
+    uint64_t generators;
+    /** \brief The number of generators skipped because of too few arithmetic progressions. */
+    uint64_t pruned;
+    /** \brief The number of arithmetic progressions of the generators searched. */
+    uint64_t progressions;
+    /** \brief The number of candidates tested for being a perfect square number. */
+    uint64_t squareTests;
+    /** \brief The number of candidates passing each stage of the square filter. */
+    uint64_t squarePassed[SQUARE_FILTER_STAGES];
+    /** \brief The number of generators searched block by block. */
+    uint64_t blocked;
+    /** \brief The number of combinations of arithmetic progressions tested. */
+    uint64_t pairs;
+    /** \brief The number of combinations skipped by the bounds a + b < c and b != 2a. */
+    uint64_t prunedPairs;
+    /** \brief The number of generators skipped in the primitive mode because of a prime factor 3 (mod 4). */
+    uint64_t imprimitive;
+    /** \brief The number of combinations skipped in the primitive mode because of a common prime factor. */
+    uint64_t imprimitivePairs;
+    /** \brief The number of candidates tested exactly after passing the square filter. */
+    uint64_t exactTests;
+    /** \brief The number of results written. */
+    uint64_t results;
+    /** \brief The number of generators found in the cache. */
+    uint64_t cached;
+    /** \brief The ticks spent in every stage, see STATS_STAGE_*. */
+    uint64_t ticks[STATS_STAGES];
+    /** \brief The generators searched by their number of arithmetic progressions, see stats_bucket(). */
+    uint64_t apsHistogram[STATS_BUCKETS];
+    /** \brief The generators searched by their number of combinations tested, see stats_bucket(). */
+    uint64_t pairsHistogram[STATS_BUCKETS];
+    /** \brief The most arithmetic progressions of a generator. */
+    uint64_t maxAps;
+    /** \brief The most combinations tested for a generator. */
+    uint64_t maxPairs;
+    /** \brief The most ticks spent on a generator. */
+    uint64_t maxTicks;
+} search_stats_t;
+
+
+/** \brief The state needed to search the magic squares of one generator.
+ *
+ * All mpz_t variables are initialized once by search_state_init() and are
+ * then reused for every generator searched with this state. That way we avoid
+ * the initialization and the clearing of mpz_t variables per generator.
+ */
+typedef struct search_state
+{
+    /** \brief The generator number g. */
+    mpz_t input;
+    /** \brief The number n5 = 6 * g + plusMinus. */
+    mpz_t number;
+    /** \brief The center square number n5^2. */
+    mpz_t numberSquared;
+
+    /** \brief The nine numbers of the magic square. */
+    mpz_t x1, x2, x3, a1, a2, a3, a7, a8, a9;
+    /** \brief The distances a, b, the center c and the sum d and difference e. */
+    mpz_t a, b, c, d, e;
+
+    /** \brief The prime factorization of n5. */
+    mpz_factorization_t factorization;
+    /** \brief The state used to build the arithmetic progressions. */
+    mpz_gaussian_t gaussian;
+    /** \brief The arithmetic progressions centered at n5^2. */
+    mpz_ap_list_t arithmeticProgressions;
+    /** \brief The limbs of n5^2 if the pairs are tested with the mpn kernels. */
+    mp_limb_t mpnCenter[MPN_KERNEL_MAX_LIMBS];
+    /** \brief The number of limbs of n5^2 if the pairs are tested with the mpn kernels, 0 otherwise. */
+    int mpnLimbs;
+    /** \brief The distances of the arithmetic progressions, mpnLimbs limbs each (zero padded). */
+    mp_limb_t * mpnDistances;
+    /** \brief The number of limbs allocated for mpnDistances. */
+    size_t mpnCapacity;
+
+    /** \brief The distinct prime factors of n5 if it fits into 64 bits. */
+    uint64_t nativePrimes[UINT64_FACTOR_MAX];
+    /** \brief The exponents of the native prime factors. */
+    int nativeExponents[UINT64_FACTOR_MAX];
+    /** \brief The number of native prime factors. */
+    int nativeLength;
+    /** \brief The arithmetic progressions centered at n5^2 with native numbers. */
+    uint128_ap_list_t nativeProgressions;
+    /** \brief The second block of arithmetic progressions if they have been spilled. */
+    uint128_ap_list_t nativeBlock;
+    /** \brief The residues of the distances of the arithmetic progressions (mpz or native) for the square filter. */
+    square_filter_lanes_t lanes;
+    /** \brief The residues of the distances of nativeBlock for the square filter. */
+    square_filter_lanes_t blockLanes;
+    /** \brief The masks of the square filter of the combinations of one AP1, indexed by AP2. */
+    uint8_t * masks;
+    /** \brief The number of masks allocated. */
+    int masksCapacity;
+
+    /** \brief The options. */
+    const search_options_t * options;
+    /** \brief The minimal number of perfect square numbers of a "ps" result, 10 if none is written. */
+    int minSquares;
+    /** \brief Whether the "sh1" results are written. */
+    int distances;
+    /** \brief Generators with less arithmetic progressions are skipped. */
+    unsigned long minAps;
+    /** \brief The counters. */
+    search_stats_t stats;
+    /** \brief The results not yet written to the log. */
+    result_buffer_t results;
+    /** \brief The record of the result written last. */
+    result_record_t record;
+    /** \brief The record of the current generator in the cache, if cacheHit is set. */
+    ap_cache_entry_t cacheEntry;
+    /** \brief Whether the current generator has been found in the cache. */
+    int cacheHit;
+    /** \brief The records not yet appended to the cache. */
+    ap_cache_buffer_t cacheBuffer;
+
+    /** \brief The generator function applied, either 1 (6g + 1) or -1 (6g - 1). */
+    int plusMinus;
+    /** \brief The number of results written for the current generator. */
+    long result;
+    /** \brief The ticks when the current generator has started. */
+    uint64_t start;
+    /** \brief The ticks when the current stage has started. */
+    uint64_t lap;
+    /** \brief The number of arithmetic progressions of the current generator, -1 if it has been skipped. */
+    int64_t aps;
+} search_state_t;
+
+
+/** \brief Initializes the given options with their default values.
+ *
+ * \param options search_options_t* The options.
+ * \return void
+ */
+void search_options_init(search_options_t * options);
+
+
+/** \brief Sets all counters to zero.
+ *
+ * \param stats search_stats_t* The counters.
+ * \return void
+ */
+void search_stats_init(search_stats_t * stats);
+
+
+/** \brief Adds the counters of \p stats to the counters of \p total.
+ *
+ * \param total search_stats_t* The total counters.
+ * \param stats search_stats_t* The counters to add.
+ * \return void
+ */
+void search_stats_add(search_stats_t * total, search_stats_t * stats);
+
+
+/** \brief Prints the counters as lines starting with the given label.
+ *
+ * The lines are "<label> generators ...", "<label> squares ...", "<label>
+ * pairs ...", "<label> seconds <stage> <seconds> ...", "<label> max ..." and
+ * the histograms "<label> histogram aps ..." and "<label> histogram pairs
+ * ...".
+ *
+ * \param report stats_report_t* The report.
+ * \param label const char* The label, e.g. "total" or "worker 3".
+ * \param stats search_stats_t* The counters.
+ * \return void
+ */
+void search_stats_print(stats_report_t * report, const char * label, search_stats_t * stats);
+
+
+/** \brief Initializes the given search state.
+ *
+ * The options are not copied, they have to stay valid as long as the state is
+ * used.
+ *
+ * \param state search_state_t* The state.
+ * \param options search_options_t* The options.
+ * \return void
+ */
+void search_state_init(search_state_t * state, const search_options_t * options);
+
+
+/** \brief Clears the given search state and releases all memory used by it.
+ *
+ * \param state search_state_t* The state.
+ * \return void
+ */
+void search_state_clear(search_state_t * state);
+
+
+/** \brief Writes the buffered results of the given state to the log and the buffered records to the cache.
+ *
+ * \param state search_state_t* The state.
+ * \return void
+ */
+void search_state_flush(search_state_t * state);
+
+
+/** \brief Searches the magic squares of squares for a generator.
+ *
+ * The center square number would be (6 * \p generator + \p plusMinus)^2. Any
+ * magic square of a class selected by the options would be written to the log
+ * (or a file) and its key (or the filename) would be printed to the stdout.
+ * The log is written in batches, see search_state_flush().
+ *
+ * Numbers n5 below 2^UINT128_GAUSSIAN_BITS are searched with native 64 and
+ * 128 bit numbers, the mpz_t variables are only used for bigger numbers and
+ * to write the results.
+ *
+ * If n5 is found in the cache of the options, its prime factors and its
+ * arithmetic progressions are taken from the cache. Otherwise they are
+ * calculated and appended to the cache, see search_state_flush().
+ *
+ * \param state search_state_t* The state.
+ * \param generator mpz_t The generator number g.
+ * \param plusMinus int Either 1 to use 6g + 1 or -1 to use 6g - 1.
+ * \return long The number of results written.
+ */
+long search_generator(search_state_t * state, mpz_t generator, int plusMinus);
+
+
+/** \brief Searches the magic squares of squares for an already factored generator.
+ *
+ * Same as search_generator() but the prime factorization of n5 has to be
+ * stored in state->factorization by the caller, e.g. from a sieve.
+ *
+ * \param state search_state_t* The state.
+ * \param generator mpz_t The generator number g.
+ * \param plusMinus int Either 1 to use 6g + 1 or -1 to use 6g - 1.
+ * \return long The number of results written.
+ */
+long search_generator_factored(search_state_t * state, mpz_t generator, int plusMinus);
+
+
+/** \brief Searches the magic squares of squares for a natively factored generator.
+ *
+ * Same as search_generator() but the prime factorization of n5 is given by the
+ * caller, e.g. from sieve_get_native().
+ *
+ * \param state search_state_t* The state.
+ * \param generator mpz_t The generator number g.
+ * \param plusMinus int Either 1 to use 6g + 1 or -1 to use 6g - 1.
+ * \param primes const uint64_t* The distinct prime factors of n5.
+ * \param exponents const int* The exponents of the prime factors.
+ * \param length int The number of distinct prime factors.
+ * \return long The number of results written.
+ */
+long search_generator_native(search_state_t * state, mpz_t generator, int plusMinus, const uint64_t * primes, const int * exponents, int length);
+
+
+#endif // SEARCH_H_INCLUDED
@@ -0,0 +1,184 @@
+#include <stdlib.h>
+#include <pthread.h>
+
+#include "sieve.h"
+#include "primes.h"
+#include "uint64_factor.h"
+
+
+/** \brief The inverse of 6 modulo the primes of the prime table (0 for 2 and 3). */
+static uint32_t sieveInverse6[PRIMES_COUNT];
+
+static pthread_once_t sieveOnce = PTHREAD_ONCE_INIT;
+
+
+/** \brief Computes the inverse of 6 modulo every prime of the prime table.
+ *
+ * \return void
+ */
+static void sieve_inverses(void)
+{
+    uint64_t p, inverse, base, exponent;
+    int i;
+
+    primes_init();
+
+    sieveInverse6[0] = 0;
+    sieveInverse6[1] = 0;
+    for ( i = 2; i < PRIMES_COUNT; i++ )
+    {
+        // 6^-1 = 6^(p - 2) mod p
+        p = primesTable[i];
+        inverse = 1;
+        base = 6;
+        for ( exponent = p - 2; exponent > 0; exponent >>= 1 )
+        {
+            if ( exponent & 1 )
+            {
+                inverse = inverse * base % p;
+            }
+            base = base * base % p;
+        }
+        sieveInverse6[i] = (uint32_t) inverse;
+    }
+}
+
+
+void sieve_init(sieve_t * sieve)
+{
+    pthread_once(&sieveOnce, sieve_inverses);
+
+    sieve->first = 0;
+    sieve->length = 0;
+    sieve->plusMinus = 1;
+    sieve->primeBound = 0;
+    sieve->capacity = 0;
+    sieve->cofactors = NULL;
+    sieve->counts = NULL;
+    sieve->primes = NULL;
+    sieve->exponents = NULL;
+}
+
+
+void sieve_clear(sieve_t * sieve)
+{
+    free(sieve->cofactors);
+    free(sieve->counts);
+    free(sieve->primes);
+    free(sieve->exponents);
+    sieve_init(sieve);
+}
+
+
+int sieve_run(sieve_t * sieve, uint64_t first, uint64_t length, int plusMinus)
+{
+    uint64_t p, start, index, last, cofactor;
+    uint8_t exponent;
+    int i;
+
+    if ( first < 1 || length == 0 || first + length - 1 > (UINT64_MAX - 1) / 6 )
+    {
+        // ERROR: The numbers would not fit into 64 bits.
+        return 0;
+    }
+
+    if ( length > sieve->capacity )
+    {
+        sieve->capacity = length;
+        sieve->cofactors = realloc(sieve->cofactors, length * sizeof(uint64_t));
+        sieve->counts = realloc(sieve->counts, length * sizeof(uint8_t));
+        sieve->primes = realloc(sieve->primes, length * SIEVE_MAX_FACTORS * sizeof(uint32_t));
+        sieve->exponents = realloc(sieve->exponents, length * SIEVE_MAX_FACTORS * sizeof(uint8_t));
+    }
+
+    sieve->first = first;
+    sieve->length = length;
+    sieve->plusMinus = plusMinus;
+
+    for ( index = 0; index < length; index++ )
+    {
+        sieve->cofactors[index] = 6 * (first + index) + plusMinus;
+        sieve->counts[index] = 0;
+    }
+
+    // The numbers 6g +/- 1 are never divisible by 2 or 3, so start with 5.
+    last = 6 * (first + length - 1) + plusMinus;
+    p = 0;
+    for ( i = 2; i < PRIMES_COUNT; i++ )
+    {
+        p = primesTable[i];
+        if ( p * p > last )
+        {
+            break;
+        }
+
+        // p divides 6g + plusMinus if and only if g = -plusMinus * 6^-1 mod p.
+        start = plusMinus > 0 ? (p - sieveInverse6[i]) % p : sieveInverse6[i];
+        start = (start + p - first % p) % p;
+
+        for ( index = start; index < length; index += p )
+        {
+            cofactor = sieve->cofactors[index];
+            exponent = 0;
+            do
+            {
+                cofactor /= p;
+                exponent++;
+            }
+            while ( cofactor % p == 0 );
+            sieve->cofactors[index] = cofactor;
+
+            sieve->primes[index * SIEVE_MAX_FACTORS + sieve->counts[index]] = (uint32_t) p;
+            sieve->exponents[index * SIEVE_MAX_FACTORS + sieve->counts[index]] = exponent;
+            sieve->counts[index]++;
+        }
+    }
+
+    // Any cofactor below the square of the first prime not sieved is a prime.
+    sieve->primeBound = i < PRIMES_COUNT ? p * p : (uint64_t) PRIMES_LIMIT * PRIMES_LIMIT;
+
+    return 1;
+}
+
+
+int sieve_get_native(sieve_t * sieve, uint64_t index, uint64_t * primes, int * exponents)
+{
+    uint64_t cofactor = sieve->cofactors[index];
+    int length, i;
+
+    length = sieve->counts[index];
+    for ( i = 0; i < length; i++ )
+    {
+        primes[i] = sieve->primes[index * SIEVE_MAX_FACTORS + i];
+        exponents[i] = sieve->exponents[index * SIEVE_MAX_FACTORS + i];
+    }
+
+    if ( cofactor == 1 )
+    {
+        return length;
+    }
+
+    if ( cofactor < sieve->primeBound || uint64_is_prime(cofactor) )
+    {
+        return uint64_factor_add(cofactor, 1, primes, exponents, length);
+    }
+
+    // The cofactor is a product of primes above the prime table.
+    return uint64_factor_split(cofactor, primes, exponents, length);
+}
+
+
+void sieve_get(sieve_t * sieve, uint64_t index, mpz_factorization_t * factorization)
+{
+    uint64_t primes[UINT64_FACTOR_MAX];
+    int exponents[UINT64_FACTOR_MAX];
+    int length, i;
+
+    mpz_factorization_reset(factorization);
+
+    length = sieve_get_native(sieve, index, primes, exponents);
+    for ( i = 0; i < length; i++ )
+    {
+        mpz_factorization_add_ui(factorization, primes[i], exponents[i]);
+    }
+}
@@ -0,0 +1,97 @@
+#ifndef SIEVE_H_INCLUDED
+#define SIEVE_H_INCLUDED
+
+#include <stdint.h>
+
+#include "mpz_factorization.h"
+
+
+/** \brief The maximal number of distinct sieved prime factors per number. */
+#define SIEVE_MAX_FACTORS 15
+
+
+/** \brief A segmented sieve over the numbers 6g + plusMinus of a block of generators.
+ *
+ * All primes of the prime table up to the square root of the biggest number
+ * are sieved in one pass over the block. What remains per number is a
+ * cofactor that is either 1, a prime or (rarely) a product of primes above the
+ * prime table. The buffers are kept between blocks.
+ */
+typedef struct sieve
+{
+    /** \brief The first generator of the block. */
+    uint64_t first;
+    /** \brief The number of generators in the block. */
+    uint64_t length;
+    /** \brief The generator function, either 1 (6g + 1) or -1 (6g - 1). */
+    int plusMinus;
+    /** \brief All cofactors below this bound are primes. */
+    uint64_t primeBound;
+    /** \brief The number of generators the buffers can hold. */
+    uint64_t capacity;
+    /** \brief The cofactors remaining after sieving, one per generator. */
+    uint64_t * cofactors;
+    /** \brief The number of sieved prime factors, one per generator. */
+    uint8_t * counts;
+    /** \brief The sieved prime factors, SIEVE_MAX_FACTORS per generator. */
+    uint32_t * primes;
+    /** \brief The exponents of the sieved prime factors, SIEVE_MAX_FACTORS per generator. */
+    uint8_t * exponents;
+} sieve_t;
+
+
+/** \brief Initializes the given sieve.
+ *
+ * \param sieve sieve_t* The sieve.
+ * \return void
+ */
+void sieve_init(sieve_t * sieve);
+
+
+/** \brief Clears the given sieve and releases all memory used by it.
+ *
+ * \param sieve sieve_t* The sieve.
+ * \return void
+ */
+void sieve_clear(sieve_t * sieve);
+
+
+/** \brief Sieves the block of generators [\p first, \p first + \p length).
+ *
+ * The sieve works natively, so all numbers 6g + plusMinus of the block have
+ * to fit into 64 bits and the first generator has to be positive. Otherwise
+ * the function would not sieve and return 0.
+ *
+ * \param sieve sieve_t* The sieve.
+ * \param first uint64_t The first generator of the block.
+ * \param length uint64_t The number of generators in the block.
+ * \param plusMinus int Either 1 to use 6g + 1 or -1 to use 6g - 1.
+ * \return int 1 if the block has been sieved, 0 otherwise.
+ */
+int sieve_run(sieve_t * sieve, uint64_t first, uint64_t length, int plusMinus);
+
+
+/** \brief Gets the prime factorization of the number of a sieved generator natively.
+ *
+ * The prime factors are stored in ascending order.
+ *
+ * \param sieve sieve_t* The sieve.
+ * \param index uint64_t The index of the generator within the block.
+ * \param primes uint64_t* Receives the distinct prime factors (at least UINT64_FACTOR_MAX items).
+ * \param exponents int* Receives the exponents of the prime factors.
+ * \return int The number of distinct prime factors.
+ */
+int sieve_get_native(sieve_t * sieve, uint64_t index, uint64_t * primes, int * exponents);
+
+
+/** \brief Gets the prime factorization of the number of a sieved generator.
+ *
+ * \param sieve sieve_t* The sieve.
+ * \param index uint64_t The index of the generator within the block.
+ * \param factorization mpz_factorization_t* Receives the prime factorization.
+ * \return void
+ */
+void sieve_get(sieve_t * sieve, uint64_t index, mpz_factorization_t * factorization);
+
+
+#endif // SIEVE_H_INCLUDED
@@ -0,0 +1,189 @@
+#include <stdlib.h>
+#ifdef __SSSE3__
+#include <tmmintrin.h>
+#endif
+
+#include "square_filter.h"
+
+
+/** \brief All bits of a mask of square_filter_batch(). */
+#define SQUARE_FILTER_ALL (SQUARE_FILTER_SUM | SQUARE_FILTER_DIFFERENCE_A | SQUARE_FILTER_DIFFERENCE_B | SQUARE_FILTER_DIFFERENCE)
+
+
+void square_filter_lanes_init(square_filter_lanes_t * lanes)
+{
+    lanes->residues = NULL;
+    lanes->capacity = 0;
+}
+
+
+void square_filter_lanes_clear(square_filter_lanes_t * lanes)
+{
+    free(lanes->residues);
+    lanes->residues = NULL;
+    lanes->capacity = 0;
+}
+
+
+void square_filter_lanes_reserve(square_filter_lanes_t * lanes, int length)
+{
+    if ( length <= lanes->capacity )
+    {
+        return;
+    }
+
+    lanes->capacity = length > 2 * lanes->capacity ? length : 2 * lanes->capacity;
+    free(lanes->residues);
+    lanes->residues = malloc((size_t) SQUARE_FILTER_STAGES * lanes->capacity);
+}
+
+
+void square_filter_lanes_set(square_filter_lanes_t * lanes, int index, uint64_t residue)
+{
+    static const int moduli[SQUARE_FILTER_STAGES] = SQUARE_FILTER_MODULI;
+    int k;
+
+    for ( k = 0; k < SQUARE_FILTER_STAGES; k++ )
+    {
+        lanes->residues[(size_t) k * lanes->capacity + index] = (uint8_t) (residue % moduli[k]);
+    }
+}
+
+
+/** \brief Screens the four numbers of one number b, see square_filter_batch().
+ *
+ * \param lanes const square_filter_lanes_t* The residues of the numbers b.
+ * \param sums const int* The residues of c + a, one per stage.
+ * \param differences const int* The residues of c - a, one per stage.
+ * \param index int The index of the number b.
+ * \param passed uint64_t* The counters of the stages.
+ * \return int The mask.
+ */
+static inline int square_filter_batch_one(const square_filter_lanes_t * lanes, const int * sums, const int * differences, int index, uint64_t * passed)
+{
+    static const int moduli[SQUARE_FILTER_STAGES] = SQUARE_FILTER_MODULI;
+    static const uint64_t bitmaps[SQUARE_FILTER_STAGES] = SQUARE_FILTER_BITMAPS;
+    int pass = SQUARE_FILTER_ALL;
+    int modulus, b, k;
+
+    for ( k = 0; k < SQUARE_FILTER_STAGES; k++ )
+    {
+        modulus = moduli[k];
+        b = lanes->residues[(size_t) k * lanes->capacity + index];
+
+        pass &= (int) ((bitmaps[k] >> ((sums[k] + b) % modulus)) & 1) * SQUARE_FILTER_SUM
+                | (int) ((bitmaps[k] >> ((differences[k] + b) % modulus)) & 1) * SQUARE_FILTER_DIFFERENCE_A
+                | (int) ((bitmaps[k] >> ((sums[k] + modulus - b) % modulus)) & 1) * SQUARE_FILTER_DIFFERENCE_B
+                | (int) ((bitmaps[k] >> ((differences[k] + modulus - b) % modulus)) & 1) * SQUARE_FILTER_DIFFERENCE;
+        passed[k] += __builtin_popcount(pass);
+    }
+
+    return pass;
+}
+
+
+#ifdef __SSSE3__
+/** \brief Reduces sixteen residues below twice the modulus to residues below the modulus.
+ *
+ * x - m wraps around to a byte bigger than x if x < m.
+ *
+ * \param x __m128i The residues.
+ * \param modulus __m128i The modulus in every byte.
+ * \return __m128i The reduced residues.
+ */
+static inline __m128i square_filter_reduce(__m128i x, __m128i modulus)
+{
+    return _mm_min_epu8(x, _mm_sub_epi8(x, modulus));
+}
+
+
+/** \brief Looks up sixteen residues below 64 in the bitmap of a stage.
+ *
+ * The byte r / 8 of the bitmap and the bit r % 8 of that byte are both
+ * picked by a byte shuffle.
+ *
+ * \param x __m128i The residues.
+ * \param bitmap __m128i The bitmap of the stage in the low eight bytes.
+ * \return __m128i 0xff for the quadratic residues, 0 for the others.
+ */
+static inline __m128i square_filter_lookup(__m128i x, __m128i bitmap)
+{
+    const __m128i seven = _mm_set1_epi8(7);
+    const __m128i bits = _mm_setr_epi8(1, 2, 4, 8, 16, 32, 64, -128, 0, 0, 0, 0, 0, 0, 0, 0);
+    __m128i bytes = _mm_shuffle_epi8(bitmap, _mm_and_si128(_mm_srli_epi16(x, 3), seven));
+    __m128i bit = _mm_shuffle_epi8(bits, _mm_and_si128(x, seven));
+
+    return _mm_cmpeq_epi8(_mm_and_si128(bytes, bit), bit);
+}
+#endif
+
+
+void square_filter_batch(const square_filter_lanes_t * lanes, uint64_t c, uint64_t a, int from, int to, uint8_t * masks, uint64_t * passed)
+{
+    static const int moduli[SQUARE_FILTER_STAGES] = SQUARE_FILTER_MODULI;
+    int sums[SQUARE_FILTER_STAGES];
+    int differences[SQUARE_FILTER_STAGES];
+    int index = from;
+    int k;
+
+    for ( k = 0; k < SQUARE_FILTER_STAGES; k++ )
+    {
+        sums[k] = (int) ((c + a) % moduli[k]);
+        differences[k] = (int) ((c % moduli[k] + moduli[k] - a % moduli[k]) % moduli[k]);
+    }
+
+#ifdef __SSSE3__
+    {
+        static const uint64_t bitmaps[SQUARE_FILTER_STAGES] = SQUARE_FILTER_BITMAPS;
+        __m128i modulus[SQUARE_FILTER_STAGES], bitmap[SQUARE_FILTER_STAGES];
+        __m128i sum[SQUARE_FILTER_STAGES], difference[SQUARE_FILTER_STAGES];
+        __m128i b, negative, passSum, passDifferenceA, passDifferenceB, passDifference;
+        const uint8_t * row;
+
+        for ( k = 0; k < SQUARE_FILTER_STAGES; k++ )
+        {
+            modulus[k] = _mm_set1_epi8((char) moduli[k]);
+            bitmap[k] = _mm_set_epi64x(0, (long long) bitmaps[k]);
+            sum[k] = _mm_set1_epi8((char) sums[k]);
+            difference[k] = _mm_set1_epi8((char) differences[k]);
+        }
+
+        for ( ; index + 16 <= to; index += 16 )
+        {
+            passSum = _mm_set1_epi8(-1);
+            passDifferenceA = passSum;
+            passDifferenceB = passSum;
+            passDifference = passSum;
+
+            for ( k = 0; k < SQUARE_FILTER_STAGES; k++ )
+            {
+                row = lanes->residues + (size_t) k * lanes->capacity;
+                b = _mm_loadu_si128((const __m128i *) (row + index));
+                negative = _mm_sub_epi8(modulus[k], b);
+
+                passSum = _mm_and_si128(passSum, square_filter_lookup(square_filter_reduce(_mm_add_epi8(sum[k], b), modulus[k]), bitmap[k]));
+                passDifferenceA = _mm_and_si128(passDifferenceA, square_filter_lookup(square_filter_reduce(_mm_add_epi8(difference[k], b), modulus[k]), bitmap[k]));
+                passDifferenceB = _mm_and_si128(passDifferenceB, square_filter_lookup(square_filter_reduce(_mm_add_epi8(sum[k], negative), modulus[k]), bitmap[k]));
+                passDifference = _mm_and_si128(passDifference, square_filter_lookup(square_filter_reduce(_mm_add_epi8(difference[k], negative), modulus[k]), bitmap[k]));
+
+                passed[k] += __builtin_popcount(_mm_movemask_epi8(passSum))
+                             + __builtin_popcount(_mm_movemask_epi8(passDifferenceA))
+                             + __builtin_popcount(_mm_movemask_epi8(passDifferenceB))
+                             + __builtin_popcount(_mm_movemask_epi8(passDifference));
+            }
+
+            _mm_storeu_si128((__m128i *) (masks + index),
+                             _mm_or_si128(_mm_or_si128(_mm_and_si128(passSum, _mm_set1_epi8(SQUARE_FILTER_SUM)),
+                                                       _mm_and_si128(passDifferenceA, _mm_set1_epi8(SQUARE_FILTER_DIFFERENCE_A))),
+                                          _mm_or_si128(_mm_and_si128(passDifferenceB, _mm_set1_epi8(SQUARE_FILTER_DIFFERENCE_B)),
+                                                       _mm_and_si128(passDifference, _mm_set1_epi8(SQUARE_FILTER_DIFFERENCE)))));
+        }
+    }
+#endif
+
+    // The numbers left (all of them without SSSE3).
+    for ( ; index < to; index++ )
+    {
+        masks[index] = (uint8_t) square_filter_batch_one(lanes, sums, differences, index, passed);
+    }
+}
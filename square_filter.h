@@ -0,0 +1,146 @@
+#ifndef SQUARE_FILTER_H_INCLUDED
+#define SQUARE_FILTER_H_INCLUDED
+
+#include <stdint.h>
+#include <stddef.h>
+
+
+/** \brief The product 53 * 43 * 41 * 47 of the moduli of the square filter.
+ *
+ * The residues of the numbers to test are kept modulo this product, so that
+ * the residues of sums and differences can be calculated from the residues
+ * of their terms without touching the big numbers.
+ *
+ * Powers of 2 and 3 are of no use: every distance is a multiple of 24 and
+ * the center is 1 (mod 24), so all candidates are 1 (mod 24) and pass any
+ * such test. Small primes p = 1 (mod 4) often divide the center and pass
+ * too many candidates as well.
+ */
+#define SQUARE_FILTER_MODULUS 4391633ULL
+
+/** \brief The number of stages of the square filter, one per modulus. */
+#define SQUARE_FILTER_STAGES 4
+
+/** \brief The moduli of the stages in the order they are tested. */
+#define SQUARE_FILTER_MODULI {53, 43, 41, 47}
+
+/** \brief The quadratic residues of the moduli of the stages, bit r is set if r is one. */
+#define SQUARE_FILTER_BITMAPS {0x0012dd703303aed3ULL, 0x0000035883a3ee53ULL, 0x000001b382b50737ULL, 0x000004351b2753dfULL}
+
+
+/** \brief Tests a residue against the quadratic residues of one modulus.
+ *
+ * The stages are evaluated without branches: every second non-square is
+ * rejected by a stage, so a branch per stage would be mispredicted half of
+ * the time.
+ */
+#define SQUARE_FILTER_STAGE(stage, modulus, mask) \
+    pass &= (int) (((mask) >> (residue % (modulus))) & 1); \
+    passed[stage] += pass;
+
+
+/** \brief Checks whether a number can be a perfect square number by its residues.
+ *
+ * The residue is tested against the quadratic residues modulo 53, 43, 41 and
+ * 47 in that order. Every stage rejects about half of the non-squares. The
+ * counter of every stage passed is incremented.
+ *
+ * \param residue uint64_t The number modulo SQUARE_FILTER_MODULUS.
+ * \param passed uint64_t* The counters, SQUARE_FILTER_STAGES items.
+ * \return int 1 if the number might be a perfect square number, 0 if it is none.
+ */
+static inline int square_filter_test(uint64_t residue, uint64_t * passed)
+{
+    int pass = 1;
+
+    SQUARE_FILTER_STAGE(0, 53, 0x0012dd703303aed3ULL)
+    SQUARE_FILTER_STAGE(1, 43, 0x0000035883a3ee53ULL)
+    SQUARE_FILTER_STAGE(2, 41, 0x000001b382b50737ULL)
+    SQUARE_FILTER_STAGE(3, 47, 0x000004351b2753dfULL)
+
+    return pass;
+}
+
+
+/** \brief The bits of the masks of square_filter_batch(), one per number tested. */
+#define SQUARE_FILTER_SUM 1
+#define SQUARE_FILTER_DIFFERENCE_A 2
+#define SQUARE_FILTER_DIFFERENCE_B 4
+#define SQUARE_FILTER_DIFFERENCE 8
+
+
+/** \brief The residues of a list of numbers modulo the moduli of the stages.
+ *
+ * The residues are stored stage by stage, so that the residues of
+ * consecutive numbers modulo one modulus are adjacent bytes and can be
+ * loaded into a vector at once.
+ */
+typedef struct square_filter_lanes
+{
+    /** \brief The residues, SQUARE_FILTER_STAGES rows of capacity bytes. */
+    uint8_t * residues;
+    /** \brief The number of numbers the rows can hold. */
+    int capacity;
+} square_filter_lanes_t;
+
+
+/** \brief Initializes the given lanes to hold no numbers.
+ *
+ * \param lanes square_filter_lanes_t* The lanes.
+ * \return void
+ */
+void square_filter_lanes_init(square_filter_lanes_t * lanes);
+
+
+/** \brief Releases the memory of the given lanes.
+ *
+ * \param lanes square_filter_lanes_t* The lanes.
+ * \return void
+ */
+void square_filter_lanes_clear(square_filter_lanes_t * lanes);
+
+
+/** \brief Makes room for the given number of numbers, the residues stored are lost.
+ *
+ * \param lanes square_filter_lanes_t* The lanes.
+ * \param length int The number of numbers.
+ * \return void
+ */
+void square_filter_lanes_reserve(square_filter_lanes_t * lanes, int length);
+
+
+/** \brief Stores the residues of a number.
+ *
+ * \param lanes square_filter_lanes_t* The lanes.
+ * \param index int The index of the number.
+ * \param residue uint64_t The number modulo SQUARE_FILTER_MODULUS.
+ * \return void
+ */
+void square_filter_lanes_set(square_filter_lanes_t * lanes, int index, uint64_t residue);
+
+
+/** \brief Screens the sums and differences of a number a with many numbers b at once.
+ *
+ * For every number b of the lanes from index from to index to - 1, the four
+ * numbers c + a + b, c - a + b, c + a - b and c - a - b are tested against
+ * the quadratic residues of every stage, as by square_filter_test(). The mask
+ * of the numbers that might be perfect square numbers is written to
+ * masks[index], with the bits SQUARE_FILTER_SUM, SQUARE_FILTER_DIFFERENCE_A,
+ * SQUARE_FILTER_DIFFERENCE_B and SQUARE_FILTER_DIFFERENCE in that order.
+ *
+ * With SSSE3 sixteen numbers b are screened by one vector per stage and
+ * number, the quadratic residues being looked up by byte shuffles.
+ *
+ * \param lanes const square_filter_lanes_t* The residues of the numbers b.
+ * \param c uint64_t The number c modulo SQUARE_FILTER_MODULUS.
+ * \param a uint64_t The number a modulo SQUARE_FILTER_MODULUS.
+ * \param from int The index of the first number b.
+ * \param to int The index after the last number b.
+ * \param masks uint8_t* Receives the masks, indexed like the lanes.
+ * \param passed uint64_t* The counters of the stages, SQUARE_FILTER_STAGES items.
+ * \return void
+ */
+void square_filter_batch(const square_filter_lanes_t * lanes, uint64_t c, uint64_t a, int from, int to, uint8_t * masks, uint64_t * passed);
+
+
+#endif // SQUARE_FILTER_H_INCLUDED
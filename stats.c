@@ -0,0 +1,85 @@
+#include "stats.h"
+
+
+/** \brief Returns the seconds passed since the report has started.
+ *
+ * \param report stats_report_t* The report.
+ * \return double The seconds.
+ */
+static double stats_report_elapsed(stats_report_t * report)
+{
+    struct timespec now;
+
+    clock_gettime(CLOCK_MONOTONIC, &now);
+
+    return (double) (now.tv_sec - report->start.tv_sec) + (now.tv_nsec - report->start.tv_nsec) / 1e9;
+}
+
+
+void stats_report_init(stats_report_t * report, FILE * stream, unsigned long interval)
+{
+    report->stream = stream;
+    report->interval = interval;
+    clock_gettime(CLOCK_MONOTONIC, &report->start);
+    report->startTicks = stats_ticks();
+    report->last = 0;
+}
+
+
+int stats_report_due(stats_report_t * report)
+{
+    long last, now;
+
+    if ( report->interval == 0 )
+    {
+        return 0;
+    }
+
+    last = __atomic_load_n(&report->last, __ATOMIC_RELAXED);
+    now = (long) stats_report_elapsed(report);
+    if ( now - last < (long) report->interval )
+    {
+        return 0;
+    }
+
+    // Only the thread swapping the second gets the report.
+    return __atomic_compare_exchange_n(&report->last, &last, now, 0, __ATOMIC_RELAXED, __ATOMIC_RELAXED);
+}
+
+
+void stats_report_begin(stats_report_t * report)
+{
+    fprintf(report->stream, "stats %.3f\n", stats_report_elapsed(report));
+}
+
+
+double stats_report_ticks_per_second(stats_report_t * report)
+{
+    double elapsed = stats_report_elapsed(report);
+
+    if ( elapsed < 1e-3 )
+    {
+        // Too short to measure, one tick per nanosecond is close enough.
+        return 1e9;
+    }
+
+    return (double) (stats_ticks() - report->startTicks) / elapsed;
+}
+
+
+void stats_report_histogram(stats_report_t * report, const char * label, const char * name, const uint64_t * histogram)
+{
+    int i;
+
+    fprintf(report->stream, "%s histogram %s", label, name);
+    for ( i = 0; i < STATS_BUCKETS; i++ )
+    {
+        if ( histogram[i] > 0 )
+        {
+            fprintf(report->stream, " %llu:%llu",
+                    i == 0 ? 0ULL : 1ULL << (i - 1),
+                    (unsigned long long) histogram[i]);
+        }
+    }
+    fprintf(report->stream, "\n");
+}
@@ -0,0 +1,133 @@
+#ifndef STATS_H_INCLUDED
+#define STATS_H_INCLUDED
+
+#include <stdio.h>
+#include <stdint.h>
+#include <time.h>
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#endif
+
+
+/** \brief The stages of the search timed by the counters, see search_stats_t.ticks.
+ *
+ * The results are written within the pair loop, so the ticks of
+ * STATS_STAGE_RESULTS are part of the ticks of STATS_STAGE_PAIRS as well.
+ */
+#define STATS_STAGE_PARSE 0
+#define STATS_STAGE_FACTOR 1
+#define STATS_STAGE_APS 2
+#define STATS_STAGE_SORT 3
+#define STATS_STAGE_PAIRS 4
+#define STATS_STAGE_RESULTS 5
+#define STATS_STAGES 6
+
+/** \brief The names of the stages, in the order of STATS_STAGE_*. */
+#define STATS_STAGE_NAMES {"parse", "factor", "aps", "sort", "pairs", "results"}
+
+/** \brief The number of buckets of a histogram, see stats_bucket(). */
+#define STATS_BUCKETS 48
+
+
+/** \brief The periodic output of the counters of a search. */
+typedef struct stats_report
+{
+    /** \brief The stream receiving the reports. */
+    FILE * stream;
+    /** \brief Report every that many seconds, 0 for the final report only. */
+    unsigned long interval;
+    /** \brief The wall clock time the search has started. */
+    struct timespec start;
+    /** \brief The ticks when the search has started. */
+    uint64_t startTicks;
+    /** \brief The second (relative to start) of the last report. */
+    long last;
+} stats_report_t;
+
+
+/** \brief Returns a cheap, monotonic tick counter.
+ *
+ * The time stamp counter of the processor on x86, nanoseconds otherwise.
+ * The ticks are converted to seconds by the reports only, see
+ * search_stats_print().
+ *
+ * \return uint64_t The ticks.
+ */
+static inline uint64_t stats_ticks(void)
+{
+#if defined(__x86_64__) || defined(__i386__)
+    return __rdtsc();
+#else
+    struct timespec now;
+
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (uint64_t) now.tv_sec * 1000000000ULL + (uint64_t) now.tv_nsec;
+#endif
+}
+
+
+/** \brief Returns the histogram bucket of a number.
+ *
+ * Bucket 0 holds the 0, bucket k > 0 the numbers 2^(k-1) to 2^k - 1.
+ *
+ * \param value uint64_t The number.
+ * \return int The bucket.
+ */
+static inline int stats_bucket(uint64_t value)
+{
+    int bucket = value == 0 ? 0 : 64 - __builtin_clzll(value);
+
+    return bucket < STATS_BUCKETS ? bucket : STATS_BUCKETS - 1;
+}
+
+
+/** \brief Initializes the given report and starts its clock.
+ *
+ * \param report stats_report_t* The report.
+ * \param stream FILE* The stream receiving the reports.
+ * \param interval unsigned long Report every that many seconds, 0 for the final report only.
+ * \return void
+ */
+void stats_report_init(stats_report_t * report, FILE * stream, unsigned long interval);
+
+
+/** \brief Checks whether the next periodic report is due.
+ *
+ * Can be called by many threads at once, only one of them gets the report.
+ *
+ * \param report stats_report_t* The report.
+ * \return int 1 if the caller has to print the report, 0 otherwise.
+ */
+int stats_report_due(stats_report_t * report);
+
+
+/** \brief Starts a report by the line "stats <seconds>".
+ *
+ * \param report stats_report_t* The report.
+ * \return void
+ */
+void stats_report_begin(stats_report_t * report);
+
+
+/** \brief Returns the ticks per second measured since the report has started.
+ *
+ * \param report stats_report_t* The report.
+ * \return double The ticks per second.
+ */
+double stats_report_ticks_per_second(stats_report_t * report);
+
+
+/** \brief Prints a histogram as "<label> histogram <name> low:count ...".
+ *
+ * Only the buckets not empty are printed, each with its lowest number.
+ *
+ * \param report stats_report_t* The report.
+ * \param label const char* The label of the line, e.g. "total".
+ * \param name const char* The name of the histogram.
+ * \param histogram const uint64_t* The STATS_BUCKETS buckets.
+ * \return void
+ */
+void stats_report_histogram(stats_report_t * report, const char * label, const char * name, const uint64_t * histogram);
+
+
+#endif // STATS_H_INCLUDED
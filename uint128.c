@@ -0,0 +1,66 @@
+#include <math.h>
+
+#include "uint128.h"
+
+
+uint64_t uint128_sqrt(uint128_t x)
+{
+    uint64_t r;
+
+    // The long double estimate is off by at most a few units, the exact
+    // square root is found by correcting it with integer arithmetic.
+    r = (uint64_t) sqrtl((long double) x);
+    while ( r > 0 && (uint128_t) r * r > x )
+    {
+        r--;
+    }
+    while ( (uint128_t) (r + 1) * (r + 1) <= x )
+    {
+        r++;
+    }
+
+    return r;
+}
+
+
+int uint128_is_square(uint128_t x)
+{
+    uint64_t r;
+
+    // A square number is 0, 1, 4, 9, 16, 17, 25, 33, 36, 41, 49 or 57 mod 64.
+    if ( ((0x0202021202030213ULL >> ((unsigned) x & 63)) & 1) == 0 )
+    {
+        return 0;
+    }
+
+    r = uint128_sqrt(x);
+
+    return (uint128_t) r * r == x;
+}
+
+
+void uint128_get_mpz(mpz_t rop, uint128_t x)
+{
+    uint64_t words[2];
+
+    words[0] = (uint64_t) x;
+    words[1] = (uint64_t) (x >> 64);
+    mpz_import(rop, 2, -1, sizeof(uint64_t), 0, 0, words);
+}
+
+
+void uint128_out_str(FILE * stream, uint128_t x)
+{
+    char buffer[40];
+    int i = sizeof buffer - 1;
+
+    buffer[i] = '\0';
+    do
+    {
+        buffer[--i] = (char) ('0' + (int) (x % 10));
+        x /= 10;
+    }
+    while ( x > 0 );
+
+    fputs(&buffer[i], stream);
+}
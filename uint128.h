@@ -0,0 +1,50 @@
+#ifndef UINT128_H_INCLUDED
+#define UINT128_H_INCLUDED
+
+#include <stdio.h>
+#include <stdint.h>
+#include <gmp.h>
+
+
+/** \brief An unsigned 128 bit number. */
+typedef unsigned __int128 uint128_t;
+
+/** \brief A signed 128 bit number. */
+typedef __int128 int128_t;
+
+
+/** \brief Calculates the integer square root of a number.
+ *
+ * \param x uint128_t The number, below 2^126.
+ * \return uint64_t The biggest r with r^2 <= x.
+ */
+uint64_t uint128_sqrt(uint128_t x);
+
+
+/** \brief Checks whether the given number is a perfect square number.
+ *
+ * \param x uint128_t The number to check, below 2^126.
+ * \return int 1 if \p x is a perfect square number, 0 otherwise.
+ */
+int uint128_is_square(uint128_t x);
+
+
+/** \brief Sets an mpz_t variable to the given number.
+ *
+ * \param rop mpz_t The variable.
+ * \param x uint128_t The number.
+ * \return void
+ */
+void uint128_get_mpz(mpz_t rop, uint128_t x);
+
+
+/** \brief Writes the given number in base 10 to a stream.
+ *
+ * \param stream FILE* The stream.
+ * \param x uint128_t The number.
+ * \return void
+ */
+void uint128_out_str(FILE * stream, uint128_t x);
+
+
+#endif // UINT128_H_INCLUDED
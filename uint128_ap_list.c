@@ -0,0 +1,246 @@
+#include "uint128_ap_list.h"
+
+
+void uint128_ap_list_init(uint128_ap_list_t * list)
+{
+    list->items = NULL;
+    list->length = 0;
+    list->capacity = 0;
+    list->limit = 0;
+    list->spill = NULL;
+    list->blocks = 0;
+    list->blockLengths = NULL;
+    list->blocksCapacity = 0;
+}
+
+
+void uint128_ap_list_clear(uint128_ap_list_t * list)
+{
+    free(list->items);
+    free(list->blockLengths);
+    if ( list->spill != NULL )
+    {
+        fclose(list->spill);
+    }
+    uint128_ap_list_init(list);
+}
+
+
+void uint128_ap_list_set_limit(uint128_ap_list_t * list, int limit)
+{
+    list->limit = limit;
+}
+
+
+void uint128_ap_list_reset(uint128_ap_list_t * list)
+{
+    list->length = 0;
+    list->blocks = 0;
+}
+
+
+/** \brief Makes sure that the given list can hold that many items.
+ *
+ * \param list uint128_ap_list_t* The list.
+ * \param capacity int The number of items.
+ * \return void
+ */
+static void uint128_ap_list_reserve(uint128_ap_list_t * list, int capacity)
+{
+    if ( capacity <= list->capacity )
+    {
+        return;
+    }
+
+    list->capacity = capacity;
+    list->items = realloc(list->items, list->capacity * sizeof(uint128_ap_t));
+}
+
+
+void uint128_ap_list_append(uint128_ap_list_t * list, uint128_t x, uint128_t z, uint128_t d)
+{
+    uint128_ap_t * item;
+
+    if ( list->limit > 0 && list->length == list->limit )
+    {
+        uint128_ap_list_spill(list);
+    }
+
+    if ( list->length == list->capacity )
+    {
+        list->capacity = list->capacity > 0 ? 2 * list->capacity : 64;
+        list->items = realloc(list->items, list->capacity * sizeof(uint128_ap_t));
+    }
+
+    item = &list->items[list->length];
+    item->x = x;
+    item->z = z;
+    item->d = d;
+    item->residue = (uint64_t) (d % SQUARE_FILTER_MODULUS);
+    item->content = 0;
+
+    list->length++;
+}
+
+
+/** \brief Compares two arithmetic progressions by their distance.
+ *
+ * \param a const void* The first arithmetic progression.
+ * \param b const void* The second arithmetic progression.
+ * \return int A negative number, zero or a positive number.
+ */
+static int uint128_ap_list_compare(const void * a, const void * b)
+{
+    uint128_t da = ((const uint128_ap_t *) a)->d;
+    uint128_t db = ((const uint128_ap_t *) b)->d;
+
+    return (da > db) - (da < db);
+}
+
+
+void uint128_ap_list_sort(uint128_ap_list_t * list)
+{
+    int i, length;
+
+    if ( list->length < 2 )
+    {
+        return;
+    }
+
+    qsort(list->items, list->length, sizeof(uint128_ap_t), uint128_ap_list_compare);
+
+    // Remove the duplicates.
+    length = 1;
+    for ( i = 1; i < list->length; i++ )
+    {
+        if ( list->items[i].d != list->items[length - 1].d )
+        {
+            list->items[length++] = list->items[i];
+        }
+    }
+    list->length = length;
+}
+
+
+void uint128_ap_list_spill(uint128_ap_list_t * list)
+{
+    if ( list->spill == NULL )
+    {
+        list->spill = tmpfile();
+        if ( list->spill == NULL )
+        {
+            // ERROR: Without a temporary file the search cannot go on.
+            fprintf(stderr, "Cannot create a temporary file for the arithmetic progressions.\n");
+            exit(5);
+        }
+    }
+
+    if ( list->blocks == list->blocksCapacity )
+    {
+        list->blocksCapacity = list->blocksCapacity > 0 ? 2 * list->blocksCapacity : 16;
+        list->blockLengths = realloc(list->blockLengths, list->blocksCapacity * sizeof(int));
+    }
+
+    uint128_ap_list_sort(list);
+
+    // Every block takes limit items in the file, the items behind its length are unused.
+    fseeko(list->spill, (off_t) list->blocks * list->limit * sizeof(uint128_ap_t), SEEK_SET);
+    if ( fwrite(list->items, sizeof(uint128_ap_t), list->length, list->spill) != (size_t) list->length )
+    {
+        // ERROR: The disk is full.
+        fprintf(stderr, "Cannot write the arithmetic progressions to a temporary file.\n");
+        exit(5);
+    }
+
+    list->blockLengths[list->blocks] = list->length;
+    list->blocks++;
+    list->length = 0;
+}
+
+
+void uint128_ap_list_load(uint128_ap_list_t * list, uint128_ap_list_t * source, int block)
+{
+    int length = source->blockLengths[block];
+
+    uint128_ap_list_reserve(list, length);
+
+    fflush(source->spill);
+    fseeko(source->spill, (off_t) block * source->limit * sizeof(uint128_ap_t), SEEK_SET);
+    if ( fread(list->items, sizeof(uint128_ap_t), length, source->spill) != (size_t) length )
+    {
+        // ERROR: The temporary file has been damaged.
+        fprintf(stderr, "Cannot read the arithmetic progressions from a temporary file.\n");
+        exit(5);
+    }
+
+    list->length = length;
+}
+
+
+int uint128_ap_list_lower_bound(uint128_ap_list_t * list, uint128_t d)
+{
+    int low = 0;
+    int high = list->length;
+    int middle;
+
+    while ( low < high )
+    {
+        middle = low + (high - low) / 2;
+        if ( list->items[middle].d < d )
+        {
+            low = middle + 1;
+        }
+        else
+        {
+            high = middle;
+        }
+    }
+
+    return low;
+}
+
+
+int uint128_ap_list_find(uint128_ap_list_t * list, uint128_t d)
+{
+    int low = 0;
+    int high = list->length - 1;
+    int middle;
+
+    while ( low <= high )
+    {
+        middle = low + (high - low) / 2;
+        if ( list->items[middle].d == d )
+        {
+            return middle;
+        }
+
+        if ( list->items[middle].d < d )
+        {
+            low = middle + 1;
+        }
+        else
+        {
+            high = middle - 1;
+        }
+    }
+
+    return -1;
+}
+
+
+void uint128_ap_list_print(uint128_ap_list_t * list, uint128_t y)
+{
+    int i;
+
+    for ( i = 0; i < list->length; i++ )
+    {
+        uint128_out_str(stdout, list->items[i].x);
+        printf(", ");
+        uint128_out_str(stdout, y);
+        printf(", ");
+        uint128_out_str(stdout, list->items[i].z);
+        printf(" | ");
+        uint128_out_str(stdout, list->items[i].d);
+        printf("\n");
+    }
+}
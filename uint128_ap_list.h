@@ -0,0 +1,172 @@
+#ifndef UINT128_AP_LIST_H_INCLUDED
+#define UINT128_AP_LIST_H_INCLUDED
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "uint128.h"
+#include "square_filter.h"
+
+
+/** \brief An arithmetic progression of three square numbers x, y, z.
+ *
+ * The middle square number y is the same for all arithmetic progressions of a
+ * list and is therefore not stored.
+ */
+typedef struct uint128_ap
+{
+    /** \brief The small square number. */
+    uint128_t x;
+    /** \brief The big square number. */
+    uint128_t z;
+    /** \brief The distance between the middle square and the small square number. */
+    uint128_t d;
+    /** \brief The distance modulo SQUARE_FILTER_MODULUS. */
+    uint64_t residue;
+    /** \brief The prime factors of n5 dividing the square roots of x, y and z, bit i for the i-th prime (primitive mode only, 0 otherwise). */
+    uint64_t content;
+} uint128_ap_t;
+
+
+/** \brief Contiguous list of arithmetic progressions with native numbers.
+ *
+ * This is the native counterpart of mpz_ap_list_t. The arithmetic
+ * progressions are appended in any order and sorted once by
+ * uint128_ap_list_sort().
+ *
+ * A list can be limited to a number of items held in memory. Once the limit
+ * is reached, the items are sorted and spilled to a temporary file as a
+ * block, see uint128_ap_list_spill(). The blocks are loaded one by one later
+ * on by uint128_ap_list_load(), so the memory used stays bounded no matter
+ * how many arithmetic progressions a number has.
+ */
+typedef struct uint128_ap_list
+{
+    /** \brief The arithmetic progressions. */
+    uint128_ap_t * items;
+    /** \brief The number of arithmetic progressions in the list. */
+    int length;
+    /** \brief The number of allocated items. */
+    int capacity;
+    /** \brief The maximal number of items held in memory, 0 for no limit. */
+    int limit;
+    /** \brief The temporary file of the spilled blocks, NULL until needed. */
+    FILE * spill;
+    /** \brief The number of blocks spilled. */
+    int blocks;
+    /** \brief The number of items of every block spilled. */
+    int * blockLengths;
+    /** \brief The number of allocated items in blockLengths. */
+    int blocksCapacity;
+} uint128_ap_list_t;
+
+
+/** \brief Initializes the given list to the empty list.
+ *
+ * \param list uint128_ap_list_t* The list.
+ * \return void
+ */
+void uint128_ap_list_init(uint128_ap_list_t * list);
+
+
+/** \brief Clears the given list and releases all memory used by it.
+ *
+ * \param list uint128_ap_list_t* The list.
+ * \return void
+ */
+void uint128_ap_list_clear(uint128_ap_list_t * list);
+
+
+/** \brief Limits the number of items the given list holds in memory.
+ *
+ * \param list uint128_ap_list_t* The list.
+ * \param limit int The maximal number of items, 0 for no limit.
+ * \return void
+ */
+void uint128_ap_list_set_limit(uint128_ap_list_t * list, int limit);
+
+
+/** \brief Resets the given list to the empty list, dropping all spilled blocks.
+ *
+ * \param list uint128_ap_list_t* The list.
+ * \return void
+ */
+void uint128_ap_list_reset(uint128_ap_list_t * list);
+
+
+/** \brief Appends a new arithmetic progression to the end of the given list.
+ *
+ * Note that it is your duty to make sure that \p x < y < \p z and that
+ * y - \p x = \p z - y = \p d. The function would not check for that.
+ *
+ * If the list is limited and full, its items are spilled first.
+ *
+ * \param list uint128_ap_list_t* The list.
+ * \param x uint128_t The small square number.
+ * \param z uint128_t The big square number.
+ * \param d uint128_t The distance.
+ * \return void
+ */
+void uint128_ap_list_append(uint128_ap_list_t * list, uint128_t x, uint128_t z, uint128_t d);
+
+
+/** \brief Sorts the given list ascending by distance and removes duplicates.
+ *
+ * \param list uint128_ap_list_t* The list.
+ * \return void
+ */
+void uint128_ap_list_sort(uint128_ap_list_t * list);
+
+
+/** \brief Sorts the items of the given list and writes them as a new block.
+ *
+ * The list is empty afterwards.
+ *
+ * \param list uint128_ap_list_t* The list.
+ * \return void
+ */
+void uint128_ap_list_spill(uint128_ap_list_t * list);
+
+
+/** \brief Loads a block spilled by another list.
+ *
+ * \param list uint128_ap_list_t* Receives the items of the block, sorted by distance.
+ * \param source uint128_ap_list_t* The list that has spilled the block, may be \p list itself.
+ * \param block int The index of the block.
+ * \return void
+ */
+void uint128_ap_list_load(uint128_ap_list_t * list, uint128_ap_list_t * source, int block);
+
+
+/** \brief Finds the first arithmetic progression with a distance of at least the given one.
+ *
+ * The list has to be sorted by uint128_ap_list_sort().
+ *
+ * \param list uint128_ap_list_t* The list.
+ * \param d uint128_t The distance.
+ * \return int The index of the arithmetic progression or the length of the list if all distances are smaller.
+ */
+int uint128_ap_list_lower_bound(uint128_ap_list_t * list, uint128_t d);
+
+
+/** \brief Finds the arithmetic progression with the given distance.
+ *
+ * The list has to be sorted by uint128_ap_list_sort().
+ *
+ * \param list uint128_ap_list_t* The list.
+ * \param d uint128_t The distance.
+ * \return int The index of the arithmetic progression or -1 if not found.
+ */
+int uint128_ap_list_find(uint128_ap_list_t * list, uint128_t d);
+
+
+/** \brief Prints the given list of arithmetic progressions to the stdout.
+ *
+ * \param list uint128_ap_list_t* The list.
+ * \param y uint128_t The middle square number.
+ * \return void
+ */
+void uint128_ap_list_print(uint128_ap_list_t * list, uint128_t y);
+
+
+#endif // UINT128_AP_LIST_H_INCLUDED
@@ -0,0 +1,216 @@
+#include <limits.h>
+
+#include "uint128_gaussian.h"
+#include "uint64_factor.h"
+
+
+/** \brief The maximal number of powers, that is the sum of 2e + 1 over all
+ * primes p = 1 (mod 4) of a number below 2^UINT128_GAUSSIAN_BITS.
+ */
+#define UINT128_GAUSSIAN_POWERS 128
+
+
+/** \brief The data of one enumeration of the Gaussian integers of norm n^2. */
+typedef struct uint128_gaussian
+{
+    /** \brief The precomputed powers pi^a * conj(pi)^(2e - a), real parts. */
+    int128_t powersRe[UINT128_GAUSSIAN_POWERS];
+    /** \brief The precomputed powers, imaginary parts. */
+    int128_t powersIm[UINT128_GAUSSIAN_POWERS];
+    /** \brief Per prime p = 1 (mod 4) the index of its first power. */
+    int powersOffset[UINT64_FACTOR_MAX];
+    /** \brief Per prime p = 1 (mod 4) its exponent e in n. */
+    int powersExponent[UINT64_FACTOR_MAX];
+    /** \brief The partial products, real parts, one per level. */
+    int128_t levelRe[UINT64_FACTOR_MAX + 1];
+    /** \brief The partial products, imaginary parts, one per level. */
+    int128_t levelIm[UINT64_FACTOR_MAX + 1];
+    /** \brief The number of primes p = 1 (mod 4) of n. */
+    int levels;
+    /** \brief The product of q^f over all primes q = 3 (mod 4) of n. */
+    uint64_t inert;
+    /** \brief The center n^2. */
+    uint128_t numberSquared;
+    /** \brief The list receiving the arithmetic progressions. */
+    uint128_ap_list_t * list;
+} uint128_gaussian_t;
+
+
+unsigned long uint128_gaussian_count(const uint64_t * primes, const int * exponents, int length)
+{
+    unsigned long product = 1;
+    unsigned long factor;
+    int i;
+
+    for ( i = 0; i < length; i++ )
+    {
+        if ( (primes[i] & 3) != 1 )
+        {
+            continue;
+        }
+
+        factor = 2 * (unsigned long) exponents[i] + 1;
+        if ( product > ULONG_MAX / factor )
+        {
+            return ULONG_MAX;
+        }
+        product *= factor;
+    }
+
+    return (product - 1) / 2;
+}
+
+
+void uint128_gaussian_two_squares(uint64_t * a, uint64_t * b, uint64_t p)
+{
+    uint64_t c, x, y, t;
+
+    // Find a quadratic non-residue c, then x = c^((p - 1) / 4) is a square
+    // root of -1 modulo p.
+    for ( c = 2; uint64_powmod(c, (p - 1) / 2, p) != p - 1; c++ )
+    {
+    }
+    y = uint64_powmod(c, (p - 1) / 4, p);
+
+    // Run the Euclidean algorithm on p and x until the remainder drops below
+    // sqrt(p). That remainder is the first number.
+    x = p;
+    while ( (uint128_t) y * y >= p )
+    {
+        t = x % y;
+        x = y;
+        y = t;
+    }
+
+    *a = y;
+    *b = uint128_sqrt(p - y * y);
+}
+
+
+/** \brief Enumerates the Gaussian integers of norm n^2 recursively.
+ *
+ * See mpz_gaussian_enumerate(), this is the same enumeration with native
+ * numbers. All real and imaginary parts are bounded by n in absolute value,
+ * so all products fit into 128 bits.
+ *
+ * \param gaussian uint128_gaussian_t* The state.
+ * \param level int The level.
+ * \param decided int Whether an earlier level chose a != e.
+ * \return void
+ */
+static void uint128_gaussian_enumerate(uint128_gaussian_t * gaussian, int level, int decided)
+{
+    int128_t re, im;
+    uint128_t u, v, x, z;
+    int a, e, last, power;
+
+    if ( level == gaussian->levels )
+    {
+        if ( decided == 0 )
+        {
+            // This is n itself, i.e. n^2 = n^2 + 0^2.
+            return;
+        }
+
+        // u = |re| * inert, v = |im| * inert
+        u = (uint128_t) (gaussian->levelRe[level] < 0 ? -gaussian->levelRe[level] : gaussian->levelRe[level]) * gaussian->inert;
+        v = (uint128_t) (gaussian->levelIm[level] < 0 ? -gaussian->levelIm[level] : gaussian->levelIm[level]) * gaussian->inert;
+
+        // x = (u - v)^2, z = (u + v)^2
+        x = u > v ? (u - v) * (u - v) : (v - u) * (v - u);
+        z = (u + v) * (u + v);
+
+        // Append the arithmetic progression [x, n^2, z] to the list.
+        uint128_ap_list_append(gaussian->list, x, z, gaussian->numberSquared - x);
+        return;
+    }
+
+    e = gaussian->powersExponent[level];
+    last = decided ? 2 * e : e;
+    for ( a = 0; a <= last; a++ )
+    {
+        power = gaussian->powersOffset[level] + a;
+        re = gaussian->levelRe[level];
+        im = gaussian->levelIm[level];
+        gaussian->levelRe[level + 1] = re * gaussian->powersRe[power] - im * gaussian->powersIm[power];
+        gaussian->levelIm[level + 1] = re * gaussian->powersIm[power] + im * gaussian->powersRe[power];
+
+        uint128_gaussian_enumerate(gaussian, level + 1, decided || a != e);
+    }
+}
+
+
+void uint128_gaussian_aps(uint64_t number, const uint64_t * primes, const int * exponents, int length, uint128_ap_list_t * list)
+{
+    uint128_gaussian_t gaussian;
+    uint64_t a, b;
+    int128_t re, im, wRe, wIm;
+    int offset, e, k, i, f;
+
+    gaussian.levels = 0;
+    gaussian.inert = 1;
+    gaussian.numberSquared = (uint128_t) number * number;
+    gaussian.list = list;
+
+    offset = 0;
+    for ( i = 0; i < length; i++ )
+    {
+        e = exponents[i];
+
+        if ( (primes[i] & 3) != 1 )
+        {
+            // q = 3 (mod 4) stays prime in the Gaussian integers and q^e
+            // divides u and v.
+            for ( f = 0; f < e; f++ )
+            {
+                gaussian.inert *= primes[i];
+            }
+            continue;
+        }
+
+        // p = a^2 + b^2 = pi * conj(pi) with pi = a + b * i.
+        uint128_gaussian_two_squares(&a, &b, primes[i]);
+
+        gaussian.powersOffset[gaussian.levels] = offset;
+        gaussian.powersExponent[gaussian.levels] = e;
+
+        // First calculate P_k = pi^k for k in [0, 2e].
+        gaussian.powersRe[offset] = 1;
+        gaussian.powersIm[offset] = 0;
+        for ( k = 1; k <= 2 * e; k++ )
+        {
+            re = gaussian.powersRe[offset + k - 1];
+            im = gaussian.powersIm[offset + k - 1];
+            gaussian.powersRe[offset + k] = re * (int128_t) a - im * (int128_t) b;
+            gaussian.powersIm[offset + k] = re * (int128_t) b + im * (int128_t) a;
+        }
+
+        // Then replace them by W_k = P_k * conj(P_(2e - k)). Note that
+        // W_(2e - k) = conj(W_k), so the pairs can be replaced in place.
+        for ( k = 0; k <= e; k++ )
+        {
+            re = gaussian.powersRe[offset + 2 * e - k];
+            im = -gaussian.powersIm[offset + 2 * e - k];
+            wRe = gaussian.powersRe[offset + k] * re - gaussian.powersIm[offset + k] * im;
+            wIm = gaussian.powersRe[offset + k] * im + gaussian.powersIm[offset + k] * re;
+
+            gaussian.powersRe[offset + k] = wRe;
+            gaussian.powersIm[offset + k] = wIm;
+            gaussian.powersRe[offset + 2 * e - k] = wRe;
+            gaussian.powersIm[offset + 2 * e - k] = -wIm;
+        }
+
+        offset += 2 * e + 1;
+        gaussian.levels++;
+    }
+
+    if ( gaussian.levels == 0 )
+    {
+        // Without any prime p = 1 (mod 4) there is no representation.
+        return;
+    }
+
+    gaussian.levelRe[0] = 1;
+    gaussian.levelIm[0] = 0;
+    uint128_gaussian_enumerate(&gaussian, 0, 0);
+}
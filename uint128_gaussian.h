@@ -0,0 +1,53 @@
+#ifndef UINT128_GAUSSIAN_H_INCLUDED
+#define UINT128_GAUSSIAN_H_INCLUDED
+
+#include <stdint.h>
+
+#include "uint128.h"
+#include "uint128_ap_list.h"
+
+
+/** \brief The numbers n below 2^UINT128_GAUSSIAN_BITS are handled natively.
+ *
+ * Then n^2 is below 2^124 and all sums n^2 + d of the search stay below 2^126.
+ */
+#define UINT128_GAUSSIAN_BITS 62
+
+
+/** \brief Counts the arithmetic progressions of squares centered at n^2.
+ *
+ * This is the native counterpart of mpz_gaussian_count().
+ *
+ * \param primes const uint64_t* The distinct prime factors of n, n being odd.
+ * \param exponents const int* The exponents of the prime factors.
+ * \param length int The number of distinct prime factors.
+ * \return unsigned long The number of arithmetic progressions.
+ */
+unsigned long uint128_gaussian_count(const uint64_t * primes, const int * exponents, int length);
+
+
+/** \brief Finds the representation of a prime p = 1 (mod 4) as a sum of two squares.
+ *
+ * \param a uint64_t* Receives the first number.
+ * \param b uint64_t* Receives the second number.
+ * \param p uint64_t The prime p = 1 (mod 4).
+ * \return void
+ */
+void uint128_gaussian_two_squares(uint64_t * a, uint64_t * b, uint64_t p);
+
+
+/** \brief Appends all arithmetic progressions of squares centered at n^2 to the given list.
+ *
+ * This is the native counterpart of mpz_gaussian_aps().
+ *
+ * \param number uint64_t The number n, odd and below 2^UINT128_GAUSSIAN_BITS.
+ * \param primes const uint64_t* The distinct prime factors of n.
+ * \param exponents const int* The exponents of the prime factors.
+ * \param length int The number of distinct prime factors.
+ * \param list uint128_ap_list_t* The list, sorted by uint128_ap_list_sort() afterwards.
+ * \return void
+ */
+void uint128_gaussian_aps(uint64_t number, const uint64_t * primes, const int * exponents, int length, uint128_ap_list_t * list);
+
+
+#endif // UINT128_GAUSSIAN_H_INCLUDED
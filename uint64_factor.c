@@ -0,0 +1,285 @@
+#include "uint64_factor.h"
+#include "primes.h"
+
+
+/** \brief The primes below this bound are found by trial division. */
+#define UINT64_FACTOR_TRIAL_LIMIT 1024
+
+
+uint64_t uint64_powmod(uint64_t base, uint64_t exponent, uint64_t n)
+{
+    uint64_t result = 1 % n;
+
+    base %= n;
+    while ( exponent > 0 )
+    {
+        if ( exponent & 1 )
+        {
+            result = uint64_mulmod(result, base, n);
+        }
+        base = uint64_mulmod(base, base, n);
+        exponent >>= 1;
+    }
+
+    return result;
+}
+
+
+/** \brief Calculates the greatest common divisor of two numbers.
+ *
+ * \param a uint64_t The first number.
+ * \param b uint64_t The second number.
+ * \return uint64_t gcd(a, b).
+ */
+static uint64_t uint64_gcd(uint64_t a, uint64_t b)
+{
+    uint64_t t;
+
+    while ( b != 0 )
+    {
+        t = a % b;
+        a = b;
+        b = t;
+    }
+
+    return a;
+}
+
+
+int uint64_is_prime(uint64_t n)
+{
+    // These bases make the Miller-Rabin test deterministic for n < 2^64.
+    static const uint64_t bases[] = {2, 325, 9375, 28178, 450775, 9780504, 1795265022};
+    uint64_t d, x;
+    int r, s, i;
+
+    if ( n < 2 )
+    {
+        return 0;
+    }
+
+    primes_init();
+    for ( i = 0; i < 12; i++ )
+    {
+        if ( n == primesTable[i] )
+        {
+            return 1;
+        }
+
+        if ( n % primesTable[i] == 0 )
+        {
+            return 0;
+        }
+    }
+
+    // n - 1 = d * 2^s with d odd.
+    d = n - 1;
+    s = 0;
+    while ( (d & 1) == 0 )
+    {
+        d >>= 1;
+        s++;
+    }
+
+    for ( i = 0; i < 7; i++ )
+    {
+        if ( bases[i] % n == 0 )
+        {
+            continue;
+        }
+
+        x = uint64_powmod(bases[i], d, n);
+        if ( x == 1 || x == n - 1 )
+        {
+            continue;
+        }
+
+        for ( r = 1; r < s; r++ )
+        {
+            x = uint64_mulmod(x, x, n);
+            if ( x == n - 1 )
+            {
+                break;
+            }
+        }
+
+        if ( r == s )
+        {
+            return 0;
+        }
+    }
+
+    return 1;
+}
+
+
+/** \brief The polynomial f(y) = y^2 + c mod n used by the rho method.
+ *
+ * \param y uint64_t The argument.
+ * \param c uint64_t The constant.
+ * \param n uint64_t The modulus.
+ * \return uint64_t f(y).
+ */
+static inline uint64_t uint64_rho_f(uint64_t y, uint64_t c, uint64_t n)
+{
+    y = uint64_mulmod(y, y, n);
+    return y >= n - c ? y - (n - c) : y + c;
+}
+
+
+uint64_t uint64_rho(uint64_t n)
+{
+    uint64_t c, x, y, ys, q, g, r, k, i, limit;
+    const uint64_t m = 128;
+
+    if ( (n & 1) == 0 )
+    {
+        return 2;
+    }
+
+    for ( c = 1; ; c++ )
+    {
+        y = 2;
+        ys = 2;
+        x = 2;
+        q = 1;
+        g = 1;
+        r = 1;
+
+        while ( g == 1 )
+        {
+            x = y;
+            for ( i = 0; i < r; i++ )
+            {
+                y = uint64_rho_f(y, c, n);
+            }
+
+            // Multiply the differences of m steps before calculating the gcd.
+            for ( k = 0; k < r && g == 1; k += m )
+            {
+                ys = y;
+                limit = r - k < m ? r - k : m;
+                for ( i = 0; i < limit; i++ )
+                {
+                    y = uint64_rho_f(y, c, n);
+                    q = uint64_mulmod(q, x > y ? x - y : y - x, n);
+                }
+                g = uint64_gcd(q, n);
+            }
+
+            r <<= 1;
+        }
+
+        if ( g == n )
+        {
+            // The product collapsed, redo the last steps one by one.
+            do
+            {
+                ys = uint64_rho_f(ys, c, n);
+                g = uint64_gcd(x > ys ? x - ys : ys - x, n);
+            }
+            while ( g == 1 );
+        }
+
+        if ( g != n )
+        {
+            return g;
+        }
+
+        // Failed, try another polynomial.
+    }
+}
+
+
+int uint64_factor_add(uint64_t prime, int exponent, uint64_t * primes, int * exponents, int length)
+{
+    int i, j;
+
+    for ( i = 0; i < length && primes[i] < prime; i++ )
+    {
+    }
+
+    if ( i < length && primes[i] == prime )
+    {
+        exponents[i] += exponent;
+        return length;
+    }
+
+    for ( j = length; j > i; j-- )
+    {
+        primes[j] = primes[j - 1];
+        exponents[j] = exponents[j - 1];
+    }
+    primes[i] = prime;
+    exponents[i] = exponent;
+
+    return length + 1;
+}
+
+
+int uint64_factor_split(uint64_t n, uint64_t * primes, int * exponents, int length)
+{
+    uint64_t f;
+
+    if ( n == 1 )
+    {
+        return length;
+    }
+
+    if ( uint64_is_prime(n) )
+    {
+        return uint64_factor_add(n, 1, primes, exponents, length);
+    }
+
+    f = uint64_rho(n);
+    length = uint64_factor_split(f, primes, exponents, length);
+    return uint64_factor_split(n / f, primes, exponents, length);
+}
+
+
+int uint64_factor(uint64_t n, uint64_t * primes, int * exponents)
+{
+    uint64_t p;
+    int length = 0;
+    int i;
+
+    primes_init();
+
+    // Trial division by the small primes.
+    for ( i = 0; i < PRIMES_COUNT; i++ )
+    {
+        p = primesTable[i];
+        if ( p >= UINT64_FACTOR_TRIAL_LIMIT || p * p > n )
+        {
+            break;
+        }
+
+        if ( n % p == 0 )
+        {
+            primes[length] = p;
+            exponents[length] = 0;
+            do
+            {
+                n /= p;
+                exponents[length]++;
+            }
+            while ( n % p == 0 );
+            length++;
+        }
+    }
+
+    if ( n == 1 )
+    {
+        return length;
+    }
+
+    if ( n < (uint64_t) UINT64_FACTOR_TRIAL_LIMIT * UINT64_FACTOR_TRIAL_LIMIT || p * p > n )
+    {
+        // The cofactor has no prime factor below its square root.
+        primes[length] = n;
+        exponents[length] = 1;
+        return length + 1;
+    }
+
+    return uint64_factor_split(n, primes, exponents, length);
+}
@@ -0,0 +1,97 @@
+#ifndef UINT64_FACTOR_H_INCLUDED
+#define UINT64_FACTOR_H_INCLUDED
+
+#include <stdint.h>
+
+
+/** \brief The maximal number of distinct prime factors of a 64 bit number. */
+#define UINT64_FACTOR_MAX 16
+
+
+/** \brief Multiplies two numbers modulo a third one.
+ *
+ * \param a uint64_t The first factor.
+ * \param b uint64_t The second factor.
+ * \param n uint64_t The modulus.
+ * \return uint64_t a * b mod n.
+ */
+static inline uint64_t uint64_mulmod(uint64_t a, uint64_t b, uint64_t n)
+{
+    return (uint64_t) ((unsigned __int128) a * b % n);
+}
+
+
+/** \brief Raises a number to a power modulo a third one.
+ *
+ * \param base uint64_t The base.
+ * \param exponent uint64_t The exponent.
+ * \param n uint64_t The modulus.
+ * \return uint64_t base^exponent mod n.
+ */
+uint64_t uint64_powmod(uint64_t base, uint64_t exponent, uint64_t n);
+
+
+/** \brief Checks whether the given number is a prime number.
+ *
+ * The check is a deterministic Miller-Rabin test and therefore exact for all
+ * 64 bit numbers.
+ *
+ * \param n uint64_t The number.
+ * \return int 1 if \p n is a prime number, 0 otherwise.
+ */
+int uint64_is_prime(uint64_t n);
+
+
+/** \brief Finds a non trivial factor of an odd composite number.
+ *
+ * The factor is found via the Pollard-Brent rho method.
+ *
+ * \param n uint64_t The odd composite number.
+ * \return uint64_t A factor f of \p n with 1 < f < n.
+ */
+uint64_t uint64_rho(uint64_t n);
+
+
+/** \brief Factors the given number into its prime factors.
+ *
+ * The prime factors are stored in ascending order. The table of small primes
+ * is used for trial division first, the remaining cofactor is split by
+ * uint64_rho().
+ *
+ * \param n uint64_t The number, at least 1.
+ * \param primes uint64_t* Receives the distinct prime factors (at least UINT64_FACTOR_MAX items).
+ * \param exponents int* Receives the exponents of the prime factors.
+ * \return int The number of distinct prime factors.
+ */
+int uint64_factor(uint64_t n, uint64_t * primes, int * exponents);
+
+
+/** \brief Factors a number without small prime factors via the rho method.
+ *
+ * The prime factors found are added to the given sorted list of prime factors
+ * via uint64_factor_add().
+ *
+ * \param n uint64_t The number.
+ * \param primes uint64_t* The distinct prime factors found so far.
+ * \param exponents int* The exponents of the prime factors.
+ * \param length int The number of distinct prime factors found so far.
+ * \return int The new number of distinct prime factors.
+ */
+int uint64_factor_split(uint64_t n, uint64_t * primes, int * exponents, int length);
+
+
+/** \brief Adds a prime factor to a sorted list of prime factors.
+ *
+ * If the prime is already in the list, then its exponent would be increased.
+ *
+ * \param prime uint64_t The prime factor.
+ * \param exponent int The exponent.
+ * \param primes uint64_t* The distinct prime factors in ascending order.
+ * \param exponents int* The exponents of the prime factors.
+ * \param length int The number of distinct prime factors.
+ * \return int The new number of distinct prime factors.
+ */
+int uint64_factor_add(uint64_t prime, int exponent, uint64_t * primes, int * exponents, int length);
+
+
+#endif // UINT64_FACTOR_H_INCLUDED
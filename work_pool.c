@@ -0,0 +1,178 @@
+#include <stdlib.h>
+
+#include "work_pool.h"
+
+
+void work_pool_init(work_pool_t * pool, int workers, uint64_t count, uint64_t chunk)
+{
+    uint64_t slice = count / workers;
+    uint64_t extra = count % workers;
+    uint64_t begin = 0;
+    int i;
+
+    pool->ranges = malloc(workers * sizeof(work_pool_range_t));
+    pool->length = workers;
+    pool->workers = workers;
+    pool->chunk = chunk > 0 ? chunk : 1;
+
+    // Give every worker an equally sized slice of the work items. The first
+    // workers get one more work item if the count is not divisible.
+    for ( i = 0; i < workers; i++ )
+    {
+        pthread_mutex_init(&pool->ranges[i].lock, NULL);
+        pool->ranges[i].begin = begin;
+        pool->ranges[i].end = begin + slice + ((uint64_t) i < extra ? 1 : 0);
+        begin = pool->ranges[i].end;
+    }
+}
+
+
+void work_pool_init_ranges(work_pool_t * pool, int workers, const uint64_t * begins, const uint64_t * ends, int length, uint64_t chunk)
+{
+    int i;
+
+    pool->length = length > workers ? length : workers;
+    pool->ranges = malloc(pool->length * sizeof(work_pool_range_t));
+    pool->workers = workers;
+    pool->chunk = chunk > 0 ? chunk : 1;
+
+    // Workers without a range of their own start by stealing.
+    for ( i = 0; i < pool->length; i++ )
+    {
+        pthread_mutex_init(&pool->ranges[i].lock, NULL);
+        pool->ranges[i].begin = i < length ? begins[i] : 0;
+        pool->ranges[i].end = i < length ? ends[i] : 0;
+    }
+}
+
+
+void work_pool_clear(work_pool_t * pool)
+{
+    int i;
+
+    for ( i = 0; i < pool->length; i++ )
+    {
+        pthread_mutex_destroy(&pool->ranges[i].lock);
+    }
+
+    free(pool->ranges);
+    pool->ranges = NULL;
+    pool->length = 0;
+    pool->workers = 0;
+}
+
+
+/** \brief Steals the back half of the biggest range of any other worker.
+ *
+ * \param pool work_pool_t* The pool.
+ * \param worker int The index of the stealing worker.
+ * \param begin uint64_t* Receives the first stolen work item.
+ * \param end uint64_t* Receives the end of the stolen work items (exclusive).
+ * \return int 1 if work items have been stolen, 0 if there is no work left.
+ */
+static int work_pool_steal(work_pool_t * pool, int worker, uint64_t * begin, uint64_t * end)
+{
+    work_pool_range_t * victim;
+    uint64_t remaining;
+    uint64_t biggest;
+    int i, v;
+
+    while ( 1 )
+    {
+        // Search the victim having the most remaining work items. The ranges
+        // are read without locking, the actual steal would check again.
+        victim = NULL;
+        biggest = 0;
+        for ( i = 1; i < pool->length; i++ )
+        {
+            v = (worker + i) % pool->length;
+            remaining = __atomic_load_n(&pool->ranges[v].end, __ATOMIC_RELAXED)
+                        - __atomic_load_n(&pool->ranges[v].begin, __ATOMIC_RELAXED);
+            if ( remaining > UINT64_MAX / 2 )
+            {
+                // The range has been changed while reading it.
+                continue;
+            }
+            if ( remaining > biggest )
+            {
+                biggest = remaining;
+                victim = &pool->ranges[v];
+            }
+        }
+
+        if ( victim == NULL )
+        {
+            // There is no work left.
+            return 0;
+        }
+
+        pthread_mutex_lock(&victim->lock);
+        remaining = victim->end - victim->begin;
+        if ( remaining > 0 )
+        {
+            // Take the back half, the victim keeps working on the front half.
+            *end = victim->end;
+            *begin = victim->end - (remaining + 1) / 2;
+            victim->end = *begin;
+            pthread_mutex_unlock(&victim->lock);
+            return 1;
+        }
+        pthread_mutex_unlock(&victim->lock);
+
+        // Someone else was faster. Try again.
+    }
+}
+
+
+int work_pool_next(work_pool_t * pool, int worker, uint64_t * begin, uint64_t * end)
+{
+    work_pool_range_t * own = &pool->ranges[worker];
+    uint64_t stolenBegin, stolenEnd;
+
+    while ( 1 )
+    {
+        pthread_mutex_lock(&own->lock);
+        if ( own->begin < own->end )
+        {
+            // Take a chunk from the front of the own range.
+            *begin = own->begin;
+            *end = own->end - own->begin > pool->chunk ? own->begin + pool->chunk : own->end;
+            own->begin = *end;
+            pthread_mutex_unlock(&own->lock);
+            return 1;
+        }
+        pthread_mutex_unlock(&own->lock);
+
+        if ( work_pool_steal(pool, worker, &stolenBegin, &stolenEnd) == 0 )
+        {
+            return 0;
+        }
+
+        // The stolen work items become the own range.
+        pthread_mutex_lock(&own->lock);
+        own->begin = stolenBegin;
+        own->end = stolenEnd;
+        pthread_mutex_unlock(&own->lock);
+    }
+}
+
+
+int work_pool_pending(work_pool_t * pool, uint64_t * begins, uint64_t * ends)
+{
+    int length = 0;
+    int i;
+
+    for ( i = 0; i < pool->length; i++ )
+    {
+        pthread_mutex_lock(&pool->ranges[i].lock);
+        if ( pool->ranges[i].begin < pool->ranges[i].end )
+        {
+            begins[length] = pool->ranges[i].begin;
+            ends[length] = pool->ranges[i].end;
+            length++;
+        }
+        pthread_mutex_unlock(&pool->ranges[i].lock);
+    }
+
+    return length;
+}
@@ -0,0 +1,100 @@
+#ifndef WORK_POOL_H_INCLUDED
+#define WORK_POOL_H_INCLUDED
+
+#include <stdint.h>
+#include <pthread.h>
+
+
+/** \brief The range of work items [begin, end) owned by one worker. */
+typedef struct work_pool_range
+{
+    /** \brief The lock protecting begin and end. */
+    pthread_mutex_t lock;
+    /** \brief The first work item not yet taken. */
+    uint64_t begin;
+    /** \brief The end of the range (exclusive). */
+    uint64_t end;
+} work_pool_range_t;
+
+
+/** \brief A work stealing pool over the work items [0, count).
+ *
+ * Initially every worker owns an equally sized slice of the work items. A
+ * worker takes chunks from the front of its own slice. As soon as its slice is
+ * exhausted, it steals the back half of the biggest remaining slice of any
+ * other worker. That way workers that hit expensive work items would not
+ * leave the other workers idle.
+ *
+ * A pool may hold more ranges than workers, e.g. the pending intervals of a
+ * checkpoint. The ranges beyond the workers are only ever stolen.
+ */
+typedef struct work_pool
+{
+    /** \brief The ranges, the first ones owned by the workers. */
+    work_pool_range_t * ranges;
+    /** \brief The number of ranges, at least the number of workers. */
+    int length;
+    /** \brief The number of workers. */
+    int workers;
+    /** \brief The maximal number of work items taken at once. */
+    uint64_t chunk;
+} work_pool_t;
+
+
+/** \brief Initializes the given pool.
+ *
+ * \param pool work_pool_t* The pool.
+ * \param workers int The number of workers.
+ * \param count uint64_t The number of work items.
+ * \param chunk uint64_t The maximal number of work items taken at once.
+ * \return void
+ */
+void work_pool_init(work_pool_t * pool, int workers, uint64_t count, uint64_t chunk);
+
+
+/** \brief Initializes the given pool with the given ranges of work items.
+ *
+ * \param pool work_pool_t* The pool.
+ * \param workers int The number of workers.
+ * \param begins const uint64_t* The first work items of the ranges.
+ * \param ends const uint64_t* The ends of the ranges (exclusive).
+ * \param length int The number of ranges.
+ * \param chunk uint64_t The maximal number of work items taken at once.
+ * \return void
+ */
+void work_pool_init_ranges(work_pool_t * pool, int workers, const uint64_t * begins, const uint64_t * ends, int length, uint64_t chunk);
+
+
+/** \brief Clears the given pool and releases all memory used by it.
+ *
+ * \param pool work_pool_t* The pool.
+ * \return void
+ */
+void work_pool_clear(work_pool_t * pool);
+
+
+/** \brief Takes the next chunk of work items for the given worker.
+ *
+ * \param pool work_pool_t* The pool.
+ * \param worker int The index of the worker.
+ * \param begin uint64_t* Receives the first work item of the chunk.
+ * \param end uint64_t* Receives the end of the chunk (exclusive).
+ * \return int 1 if a chunk has been taken, 0 if there is no work left.
+ */
+int work_pool_next(work_pool_t * pool, int worker, uint64_t * begin, uint64_t * end);
+
+
+
+/** \brief Gets the ranges of work items not yet taken.
+ *
+ * No worker must be taking work items meanwhile.
+ *
+ * \param pool work_pool_t* The pool.
+ * \param begins uint64_t* Receives the first work items, pool->length items.
+ * \param ends uint64_t* Receives the ends (exclusive), pool->length items.
+ * \return int The number of non-empty ranges.
+ */
+int work_pool_pending(work_pool_t * pool, uint64_t * begins, uint64_t * ends);
+
+
+#endif // WORK_POOL_H_INCLUDED